@@ -0,0 +1,91 @@
+#!/bin/sh
+# run_bench.sh
+# 用固定 seed 產生合成 VCD, 跑 APB_Recognizer, 比對預期報表並記錄執行時間
+#
+# 用法: bench/run_bench.sh <build_dir> [work_dir] [small|large]
+#   small (預設): 幾 MB 的輸入, 適合每次修改後跑
+#   large       : GB 等級的輸入與 50k 訊號, 需要大量磁碟空間
+set -e
+
+BUILD_DIR=${1:?usage: $0 <build_dir> [work_dir] [small|large]}
+WORK_DIR=${2:-bench_work}
+SUITE=${3:-small}
+GEN="$BUILD_DIR/apb_vcd_gen"
+RECOGNIZER="$BUILD_DIR/APB_Recognizer"
+mkdir -p "$WORK_DIR"
+RESULTS="$WORK_DIR/results.csv"
+echo "case,vcd_bytes,wall_seconds,status" > "$RESULTS"
+FAILED=0
+
+# CPU 時間每次都不同, 比對時略過
+strip_cpu_line() {
+    grep -v '^CPU Elapsed Time' "$1"
+}
+
+run_case() {
+    name=$1
+    shift
+    vcd="$WORK_DIR/$name.vcd"
+    if [ ! -f "$vcd" ] || [ ! -f "$WORK_DIR/$name.expected.txt" ]; then
+        "$GEN" -o "$vcd" --expected "$WORK_DIR/$name.expected.txt" "$@" 2>/dev/null
+    fi
+    start=$(date +%s.%N)
+    "$RECOGNIZER" "$vcd" -o "$WORK_DIR/$name.txt" > /dev/null
+    end=$(date +%s.%N)
+    strip_cpu_line "$WORK_DIR/$name.expected.txt" > "$WORK_DIR/$name.expected.nocpu"
+    if strip_cpu_line "$WORK_DIR/$name.txt" | cmp -s - "$WORK_DIR/$name.expected.nocpu"; then
+        status=ok
+    else
+        status=MISMATCH
+        FAILED=1
+    fi
+    seconds=$(awk "BEGIN { print $end - $start }")
+    echo "$name,$(wc -c < "$vcd"),$seconds,$status" >> "$RESULTS"
+    printf '%-24s %12s bytes %10.3f s  %s\n' "$name" "$(wc -c < "$vcd")" "$seconds" "$status"
+}
+
+# checkpoint 之後 resume 的結果必須與一次分析完全相同:
+# 前半段分別在行尾與一行 vector 值的中間截斷 (模擬還在寫入的檔案), 存 checkpoint 後對完整檔案 resume
+check_resume() {
+    name=$1
+    vcd="$WORK_DIR/$name.vcd"
+    size=$(wc -c < "$vcd")
+    # 檔案中間之後第一個 "b..." 行的開頭; 截在它後面 4 個字元就是值的一部分
+    vector_line=$(awk -v mid=$((size / 2)) 'n >= mid && /^b/ { print n; exit } { n += length($0) + 1 }' "$vcd")
+    for cut in "$vector_line" $((vector_line + 4)); do
+        head -c "$cut" "$vcd" > "$WORK_DIR/$name.prefix.vcd"
+        rm -f "$WORK_DIR/$name.ckpt"
+        if "$RECOGNIZER" "$WORK_DIR/$name.prefix.vcd" -o "$WORK_DIR/$name.prefix.txt" --checkpoint "$WORK_DIR/$name.ckpt" > /dev/null &&
+           "$RECOGNIZER" "$vcd" -o "$WORK_DIR/$name.resumed.txt" --resume "$WORK_DIR/$name.ckpt" > /dev/null &&
+           strip_cpu_line "$WORK_DIR/$name.resumed.txt" | cmp -s - "$WORK_DIR/$name.expected.nocpu"; then
+            status=ok
+        else
+            status=MISMATCH
+            FAILED=1
+        fi
+        echo "${name}_resume_at_$cut,$size,0,$status" >> "$RESULTS"
+        printf '%-24s %12s bytes %12s  %s\n' "${name}_resume" "$cut" "" "$status"
+    done
+    # 只留下完整的 .vcd, apb_bench 才能直接掃描 work_dir
+    rm -f "$WORK_DIR/$name.prefix.vcd"
+}
+
+if [ "$SUITE" = "large" ]; then
+    run_case large_1g       --seed 101 --size 1G --utilization 0.5
+    run_case large_waits    --seed 102 --size 1G --utilization 0.9 --wait-ratio 0.8 --max-wait 12
+    run_case large_signals  --seed 103 --size 1G --signals 50000 --filler-activity 0.01
+    run_case large_limit    --seed 104 --transactions 100000000 --utilization 0.9
+    run_case large_errors   --seed 105 --transactions 5000000 --timeouts 1000 --out-of-range 1000 --mirroring 1000 --short spi:d15
+else
+    run_case baseline       --seed 1 --transactions 20000
+    run_case busy_waits     --seed 2 --transactions 20000 --utilization 0.9 --wait-ratio 0.8 --max-wait 12
+    run_case many_signals   --seed 3 --transactions 5000 --signals 5000 --filler-activity 0.02
+    run_case errors         --seed 4 --transactions 20000 --timeouts 10 --out-of-range 10 --mirroring 10
+    run_case shorts         --seed 5 --transactions 20000 --short uart:a3 --short gpio:d7
+    run_case single_spi     --seed 6 --transactions 20000 --completers spi
+    check_resume baseline
+    check_resume errors
+fi
+
+echo "results written to $RESULTS"
+exit $FAILED
@@ -0,0 +1,538 @@
+// analysis_session.cpp
+#include "analysis_session.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include "checkpoint.hpp"
+#include "report_generator.hpp"
+#include "value_change_feed.hpp"
+
+namespace APBSystem {
+
+namespace {
+// 取樣視窗往前找訊號值的範圍上限; 更早才寫入的角色使用檔案開頭的狀態
+// 控制訊號 (m_shard_sync_roles) 最多找 SAMPLE_RESYNC_SCAN_BYTES, 其餘角色 (PRESETn, PREADY...) 很少變動, 只找最近一段
+const uint64_t SAMPLE_RESYNC_SCAN_BYTES = 16 << 20;
+const uint64_t SAMPLE_RESYNC_DATA_SCAN_BYTES = 1 << 20;
+}  // namespace
+
+AnalysisSession::AnalysisSession()
+    : m_statistics(&m_arena), m_analyzer(m_statistics), m_start_time(std::chrono::high_resolution_clock::now()) {
+    m_var_def_cb = [this](const VcdVarDefinition& definition) { on_var_definition(definition); };
+    m_time_cb = [this](uint64_t vcd_time_ps) { on_timestamp(vcd_time_ps); };
+    m_val_change_cb = [this](const char* id, std::size_t id_len, const char* value_ptr, std::size_t value_len) {
+        on_value_change(id, id_len, value_ptr, value_len);
+    };
+    m_end_def_cb = [this]() { on_end_definitions(); };
+    m_parser.begin_stream(m_var_def_cb, m_time_cb, m_val_change_cb, m_end_def_cb);
+}
+
+void AnalysisSession::on_var_definition(const VcdVarDefinition& definition) {
+    m_signal_manager.register_var(definition);
+}
+
+void AnalysisSession::on_timestamp(uint64_t vcd_time_ps) {
+    // 上一段的 value change 要用上一段的時間評估
+    if (m_signal_manager.has_staged_changes())
+        flush_coalesced_changes();
+    // 時間切片結尾的 #timestamp 行 (上面剛套用的暫存值仍屬於這個切片)
+    if (m_shard_end_offset != 0 && !m_shard_past_end && m_parser.get_consumed_bytes() > m_shard_end_offset) {
+        m_shard_past_end = true;
+        // 掃描與還沒開始分析的 worker 到這裡結束; 分析中的 worker 繼續到下一個 idle edge
+        if (m_shard_phase != ShardPhase::ANALYZE) {
+            m_parser.request_stop();
+            return;
+        }
+    }
+    m_current_signal_snapshot.timestamp = vcd_time_ps;
+    m_last_processed_vcd_timestamp = vcd_time_ps;
+}
+
+void AnalysisSession::on_value_change(const char* id, std::size_t id_len, const char* value_ptr, std::size_t value_len) {
+    if (m_analyzer.get_completed_transaction_count() >= TRANSACTION_LIMIT) {
+        return;
+    }
+    if (m_coalescing != TimestampCoalescing::OFF) {
+        m_signal_manager.stage_signal_change(id, id_len, value_ptr, value_len);
+        return;
+    }
+    bool pclk_did_rise = m_signal_manager.update_state_on_signal_change(
+        id, id_len, value_ptr, value_len,
+        m_current_signal_snapshot,
+        m_previous_pclk_val_for_edge_detection);
+
+    if (pclk_did_rise)
+        on_pclk_rising_edge();
+}
+
+void AnalysisSession::on_pclk_rising_edge() {
+    m_pclk_rising_edge_counter++;
+    if (m_shard_phase != ShardPhase::NONE) {
+        on_shard_pclk_rising_edge();
+        return;
+    }
+    m_analyzer.analyze_on_pclk_rising_edge(m_current_signal_snapshot, m_pclk_rising_edge_counter);
+}
+
+void AnalysisSession::on_shard_pclk_rising_edge() {
+    if (m_shard_phase == ShardPhase::SCAN || m_shard_stopped_at_idle_edge)
+        return;
+    const bool idle_edge = ApbAnalyzer::is_idle_edge(m_current_signal_snapshot);
+    if (m_shard_phase == ShardPhase::WARM_UP) {
+        // 這個 edge 與之前的 edge 由前一個切片處理
+        if (idle_edge && (m_signal_manager.get_written_roles() & m_shard_sync_roles) == m_shard_sync_roles) {
+            m_shard_phase = ShardPhase::ANALYZE;
+            m_shard_first_analyzed_edge = m_pclk_rising_edge_counter;
+            m_shard_first_analyzed_timestamp = m_current_signal_snapshot.timestamp;
+            m_analyzer.start_after_idle_edge(m_pclk_rising_edge_counter);
+        }
+        return;
+    }
+    m_analyzer.analyze_on_pclk_rising_edge(m_current_signal_snapshot, m_pclk_rising_edge_counter);
+    // 超過切片結尾之後的第一個 idle edge 由這個切片處理完, 下一個切片從它之後開始
+    if (m_shard_past_end && idle_edge) {
+        m_shard_stopped_at_idle_edge = true;
+        m_parser.request_stop();
+    }
+}
+
+void AnalysisSession::flush_coalesced_changes() {
+    if (m_coalescing == TimestampCoalescing::SAMPLE_BEFORE_EDGE) {
+        bool pclk_did_rise = m_signal_manager.commit_staged_clock(m_current_signal_snapshot, m_previous_pclk_val_for_edge_detection);
+        if (pclk_did_rise)
+            on_pclk_rising_edge();
+        m_signal_manager.commit_staged_signals(m_current_signal_snapshot, m_previous_pclk_val_for_edge_detection);
+    } else {
+        m_signal_manager.commit_staged_signals(m_current_signal_snapshot, m_previous_pclk_val_for_edge_detection);
+        bool pclk_did_rise = m_signal_manager.commit_staged_clock(m_current_signal_snapshot, m_previous_pclk_val_for_edge_detection);
+        if (pclk_did_rise)
+            on_pclk_rising_edge();
+    }
+    m_signal_manager.clear_staged_changes();
+}
+
+void AnalysisSession::on_end_definitions() {
+    // resume 時 bus 寬度與 bit activity 已經由 checkpoint 還原
+    if (!m_resumed_from_checkpoint)
+        m_statistics.set_bus_widths(m_signal_manager.get_paddr_width(), m_signal_manager.get_pwdata_width());
+    // 取樣視窗: 標頭解析完才知道每個角色的 VCD id
+    if (m_sample_history_end != nullptr) {
+        m_shard_sync_roles &= m_signal_manager.get_registered_roles() & ~resync_from_sample_history();
+        m_signal_manager.reset_written_roles();
+    }
+}
+
+bool AnalysisSession::parse_file(const std::string& vcd_path) {
+    if (FstReader::is_fst_file(vcd_path))
+        return parse_fst_file(vcd_path);
+    bool ok = m_parser.parse_file(vcd_path, m_var_def_cb, m_time_cb, m_val_change_cb, m_end_def_cb);
+    // 檔案結尾沒有下一個 #time, 最後一段在這裡處理
+    if (m_signal_manager.has_staged_changes())
+        flush_coalesced_changes();
+    return ok;
+}
+
+bool AnalysisSession::parse_fst_file(const std::string& fst_path) {
+    m_fst_input = true;
+    FstReader reader;
+    reader.set_threads(m_input_threads);
+    return reader.read_file(
+        fst_path,
+        [this](uint32_t signal_index, const std::string& type_str, int width, const std::string& name) {
+            return m_signal_manager.register_indexed_signal(signal_index, type_str, width, name);
+        },
+        [this]() { on_end_definitions(); },
+        [this](uint64_t time, const FstValueChange* changes, std::size_t count) { apply_fst_time_step(time, changes, count); });
+}
+
+void AnalysisSession::apply_fst_time_step(uint64_t time, const FstValueChange* changes, std::size_t count) {
+    if (count == 0) {
+        if (time != m_last_processed_vcd_timestamp)
+            on_timestamp(time);
+        return;
+    }
+    // FST 不保留同一時間點內的順序, 依 timestamp 合併的語意決定 PCLK 先或後套用
+    // (預設與 SAMPLE_BEFORE_EDGE 相同: 上升緣看到的是這個時間點之前的值)
+    const bool clock_first = m_coalescing != TimestampCoalescing::SAMPLE_AFTER_EDGE;
+    for (int pass = 0; pass < 2; ++pass) {
+        const bool want_clock = (pass == 0) == clock_first;
+        for (std::size_t i = 0; i < count; ++i) {
+            if (m_signal_manager.is_indexed_clock(changes[i].signal_index) == want_clock)
+                apply_value_change(time, changes[i].signal_index, changes[i].value, changes[i].xmask);
+        }
+    }
+}
+
+bool AnalysisSession::follow_file(const std::string& vcd_path,
+                                  const VcdParser::FollowOptions& options,
+                                  VcdParser::FollowPollCallback on_poll) {
+    bool ok = m_parser.follow_file(vcd_path, options, m_var_def_cb, m_time_cb, m_val_change_cb, m_end_def_cb, on_poll);
+    if (m_signal_manager.has_staged_changes())
+        flush_coalesced_changes();
+    return ok;
+}
+
+void AnalysisSession::feed(const char* data, std::size_t len) {
+    if (m_finalized)
+        return;
+    m_parser.feed(data, len);
+}
+
+void AnalysisSession::finish() {
+    if (m_finalized)
+        return;
+    m_parser.finish();
+    if (m_signal_manager.has_staged_changes())
+        flush_coalesced_changes();
+    finalize();
+}
+
+void AnalysisSession::apply_value_change(uint64_t time_ps, uint32_t signal_index, uint32_t value, uint32_t xmask) {
+    if (time_ps != m_last_processed_vcd_timestamp)
+        on_timestamp(time_ps);
+    if (signal_index == FEED_TIME_ONLY_INDEX || m_analyzer.get_completed_transaction_count() >= TRANSACTION_LIMIT)
+        return;
+    if (m_signal_manager.update_state_from_decoded_value(signal_index, value, xmask,
+                                                         m_current_signal_snapshot,
+                                                         m_previous_pclk_val_for_edge_detection))
+        on_pclk_rising_edge();
+}
+
+bool AnalysisSession::ingest_value_change_feed(int fd) {
+    ValueChangeFeedReader reader(fd);
+    return reader.run(
+        [this](uint32_t signal_index, const std::string& type_str, int width, const std::string& name) {
+            m_signal_manager.register_indexed_signal(signal_index, type_str, width, name);
+        },
+        [this]() { on_end_definitions(); },
+        [this](const ValueChangeRecord* records, std::size_t count) {
+            for (std::size_t i = 0; i < count; ++i)
+                apply_value_change(records[i].time_ps, records[i].signal_index, records[i].value, records[i].xmask);
+        });
+}
+
+bool AnalysisSession::resume_from_checkpoint(const std::string& checkpoint_path, const std::string& vcd_path) {
+    if (FstReader::is_fst_file(vcd_path)) {
+        std::cerr << "Error: Checkpoint/resume is not supported for FST input" << std::endl;
+        return false;
+    }
+    PipelineCheckpointState resume_state;
+    if (!load_checkpoint_file(checkpoint_path, resume_state, m_analyzer, m_statistics)) {
+        return false;
+    }
+    if (compute_vcd_prefix_hash(vcd_path, resume_state.parser_byte_offset) != resume_state.vcd_prefix_hash) {
+        std::cerr << "Error: " << vcd_path << " does not match checkpoint " << checkpoint_path << std::endl;
+        return false;
+    }
+    m_current_signal_snapshot = resume_state.signal_state;
+    m_previous_pclk_val_for_edge_detection = resume_state.previous_pclk;
+    m_pclk_rising_edge_counter = resume_state.pclk_rising_edge_count;
+    m_last_processed_vcd_timestamp = resume_state.last_timestamp;
+    m_parser.set_resume_offset(resume_state.parser_byte_offset);
+    m_resumed_from_checkpoint = true;
+    return true;
+}
+
+bool AnalysisSession::save_checkpoint(const std::string& checkpoint_path, const std::string& vcd_path) const {
+    // checkpoint 必須在 finalize 之前保存, finalize 會修改分析狀態
+    if (m_finalized) {
+        std::cerr << "Error: Cannot checkpoint a finalized analysis" << std::endl;
+        return false;
+    }
+    if (m_fst_input) {
+        std::cerr << "Error: Checkpoint/resume is not supported for FST input" << std::endl;
+        return false;
+    }
+    // 暫存的 value change 已經被 parser 計入 offset, 但還沒有進入分析狀態
+    if (m_signal_manager.has_staged_changes()) {
+        std::cerr << "Error: Cannot checkpoint in the middle of a coalesced timestamp" << std::endl;
+        return false;
+    }
+    PipelineCheckpointState save_state;
+    save_state.parser_byte_offset = m_parser.get_consumed_bytes();
+    save_state.vcd_prefix_hash = compute_vcd_prefix_hash(vcd_path, save_state.parser_byte_offset);
+    save_state.signal_state = m_current_signal_snapshot;
+    save_state.previous_pclk = m_previous_pclk_val_for_edge_detection;
+    save_state.pclk_rising_edge_count = m_pclk_rising_edge_counter;
+    save_state.last_timestamp = m_last_processed_vcd_timestamp;
+    return save_checkpoint_file(checkpoint_path, save_state, m_analyzer, m_statistics);
+}
+
+namespace {
+const uint32_t SHARD_RESULT_MAGIC = 0x53504141;  // "AAPS"
+
+struct ShardResultHeader {
+    bool analyzed = false;              // 找到了開始分析的 idle edge
+    bool stopped_at_idle_edge = false;  // false: 分析到檔案結尾
+    bool unmergeable = false;
+    uint64_t first_analyzed_edge = 0;
+    uint64_t first_analyzed_timestamp = 0;
+    uint64_t final_edge = 0;
+    uint64_t last_timestamp = 0;
+    uint64_t completed_transactions = 0;
+};
+
+bool read_shard_result_header(CheckpointReader& r, ShardResultHeader& h) {
+    uint32_t magic = 0;
+    return r.read_pod(magic) && magic == SHARD_RESULT_MAGIC &&
+           r.read_pod(h.analyzed) && r.read_pod(h.stopped_at_idle_edge) && r.read_pod(h.unmergeable) &&
+           r.read_pod(h.first_analyzed_edge) && r.read_pod(h.first_analyzed_timestamp) && r.read_pod(h.final_edge) && r.read_pod(h.last_timestamp) &&
+           r.read_pod(h.completed_transactions);
+}
+}  // namespace
+
+ShardBoundaryState ShardScanSummary::advance(const ShardBoundaryState& start) const {
+    ShardBoundaryState next = start;
+    SignalManager::copy_role_fields(written_roles, end_state, next.signal_state);
+    const bool pclk_written = (written_roles & (1u << static_cast<int>(VcdSignalPhysicalType::PCLK))) != 0;
+    next.pclk_rising_edge_count += pclk_rising_edges;
+    if (pclk_written) {
+        // 掃描時假設切片前 PCLK 為 0; 實際為 1 時第一次寫入的 1 不是上升緣
+        if (first_pclk_value && start.previous_pclk)
+            next.pclk_rising_edge_count--;
+        next.previous_pclk = end_state.test(STATE_PCLK);
+    }
+    next.last_timestamp = last_timestamp;
+    next.signal_state.timestamp = last_timestamp;
+    return next;
+}
+
+bool AnalysisSession::scan_shard(const std::string& vcd_path, uint64_t begin_offset, uint64_t end_offset, ShardScanSummary& summary) {
+    m_shard_phase = ShardPhase::SCAN;
+    m_shard_end_offset = end_offset;
+    m_parser.set_resume_offset(begin_offset);
+    m_signal_manager.reset_written_roles();
+    if (!parse_file(vcd_path))
+        return false;
+    summary.written_roles = m_signal_manager.get_written_roles();
+    summary.first_pclk_value = m_signal_manager.get_first_pclk_value();
+    summary.pclk_rising_edges = m_pclk_rising_edge_counter;
+    summary.end_state = m_current_signal_snapshot;
+    summary.last_timestamp = m_last_processed_vcd_timestamp;
+    return true;
+}
+
+bool AnalysisSession::analyze_shard(const std::string& vcd_path, uint64_t begin_offset, uint64_t end_offset, const ShardBoundaryState* start) {
+    m_statistics.set_shard_mode(true);
+    m_shard_end_offset = end_offset;
+    if (start == nullptr) {
+        m_shard_phase = ShardPhase::ANALYZE;
+    } else {
+        m_shard_phase = ShardPhase::WARM_UP;
+        m_current_signal_snapshot = start->signal_state;
+        m_previous_pclk_val_for_edge_detection = start->previous_pclk;
+        m_pclk_rising_edge_counter = start->pclk_rising_edge_count;
+        m_last_processed_vcd_timestamp = start->last_timestamp;
+        m_parser.set_resume_offset(begin_offset);
+    }
+    return parse_file(vcd_path);
+}
+
+void AnalysisSession::save_shard_result(CheckpointWriter& w) const {
+    w.write_pod(SHARD_RESULT_MAGIC);
+    w.write_pod<bool>(m_shard_phase == ShardPhase::ANALYZE);
+    w.write_pod(m_shard_stopped_at_idle_edge);
+    w.write_pod(m_statistics.is_shard_unmergeable());
+    w.write_pod(m_shard_first_analyzed_edge);
+    w.write_pod(m_shard_first_analyzed_timestamp);
+    w.write_pod(m_pclk_rising_edge_counter);
+    w.write_pod(m_last_processed_vcd_timestamp);
+    w.write_pod(m_analyzer.get_completed_transaction_count());
+    m_analyzer.save_state(w);
+    m_statistics.save_state(w);
+    m_statistics.save_shard_handoff(w);
+}
+
+bool AnalysisSession::check_shard_results(const std::vector<std::string>& results, std::string& reason) const {
+    bool open = true;        // 前一個切片停在 idle edge, 之後還有資料
+    uint64_t next_edge = 0;  // 下一個有分析的切片必須從這個 edge 之後開始
+    uint64_t transactions = 0;
+    for (std::size_t k = 0; k < results.size(); ++k) {
+        std::istringstream in(results[k]);
+        CheckpointReader r(in);
+        ShardResultHeader h;
+        if (!read_shard_result_header(r, h)) {
+            reason = "shard " + std::to_string(k) + " returned a truncated result";
+            return false;
+        }
+        // 整段都在前一個切片的範圍內 (切片中沒有 idle edge)
+        if (!h.analyzed)
+            continue;
+        if (!open || (k > 0 && h.first_analyzed_edge != next_edge)) {
+            reason = "shard " + std::to_string(k) + " does not start where the previous shard stopped";
+            return false;
+        }
+        if (h.unmergeable) {
+            reason = "shard " + std::to_string(k) + " has a partial PSTRB write to an address written by an earlier shard";
+            return false;
+        }
+        transactions += h.completed_transactions;
+        open = h.stopped_at_idle_edge;
+        next_edge = h.final_edge;
+    }
+    if (open) {
+        reason = "the last shard did not reach the end of the file";
+        return false;
+    }
+    if (transactions >= TRANSACTION_LIMIT) {
+        reason = "the transaction limit was reached";
+        return false;
+    }
+    return true;
+}
+
+bool AnalysisSession::merge_shard_results(const std::vector<std::string>& results) {
+    for (const auto& result : results) {
+        std::istringstream in(result);
+        CheckpointReader r(in);
+        ShardResultHeader h;
+        if (!read_shard_result_header(r, h))
+            return false;
+        if (!h.analyzed)
+            continue;
+        Statistics shard_statistics;
+        ApbAnalyzer shard_analyzer(shard_statistics);
+        if (!shard_analyzer.load_state(r) || !shard_statistics.load_state(r) || !shard_statistics.load_shard_handoff(r)) {
+            std::cerr << "Error: Corrupted shard result" << std::endl;
+            return false;
+        }
+        m_statistics.merge_shard(shard_statistics);
+        m_analyzer.merge_shard(shard_analyzer);
+        m_pclk_rising_edge_counter = h.final_edge;
+        m_last_processed_vcd_timestamp = h.last_timestamp;
+    }
+    return true;
+}
+
+uint32_t AnalysisSession::resync_from_sample_history() {
+    const uint32_t wanted = m_signal_manager.get_registered_roles() &
+                            ~((1u << static_cast<int>(VcdSignalPhysicalType::PARAMETER)) | (1u << static_cast<int>(VcdSignalPhysicalType::OTHER)));
+    const uint32_t control = wanted & m_shard_sync_roles;
+    const uint64_t history_bytes = m_sample_history_end - m_sample_history_begin;
+    const char* const limit = m_sample_history_end - std::min<uint64_t>(SAMPLE_RESYNC_SCAN_BYTES, history_bytes);
+    const char* const data_limit = m_sample_history_end - std::min<uint64_t>(SAMPLE_RESYNC_DATA_SCAN_BYTES, history_bytes);
+    uint32_t resolved = 0;
+    const char* line_end = m_sample_history_end;
+    std::string id;
+    while (line_end > limit && resolved != wanted && (line_end > data_limit || (resolved & control) != control)) {
+        const char* nl = static_cast<const char*>(memrchr(limit, '\n', line_end - limit));
+        // 掃描範圍的第一行可能不完整
+        if (nl == nullptr && limit != m_sample_history_begin)
+            break;
+        const char* line = nl == nullptr ? limit : nl + 1;
+        const char* end = line_end;
+        line_end = nl == nullptr ? limit : nl;
+        while (end > line && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r'))
+            --end;
+        // 與 VcdParser 相同的格式: "<0|1|x|z><id>" 或 "<b|r><value> <id>"; #timestamp 與 $keyword 略過
+        if (end <= line || *line == '#' || *line == '$')
+            continue;
+        const char* value_end = line + 1;
+        const char* id_begin = value_end;
+        if (*line == 'b' || *line == 'B' || *line == 'r' || *line == 'R') {
+            while (value_end < end && *value_end != ' ' && *value_end != '\t')
+                ++value_end;
+            id_begin = value_end;
+            while (id_begin < end && (*id_begin == ' ' || *id_begin == '\t'))
+                ++id_begin;
+        }
+        if (id_begin >= end)
+            continue;
+        id.assign(id_begin, end - id_begin);
+        const VcdSignalInfo* info = m_signal_manager.get_signal_info_by_vcd_id(id);
+        if (info == nullptr)
+            continue;
+        const uint32_t role = 1u << static_cast<int>(info->type);
+        // 每個角色只套用最後一次 (也就是最先找到的) 寫入
+        if ((wanted & ~resolved & role) == 0)
+            continue;
+        resolved |= role;
+        m_signal_manager.update_state_on_signal_change(id.data(), id.size(), line, value_end - line, m_current_signal_snapshot,
+                                                       m_previous_pclk_val_for_edge_detection);
+    }
+    return resolved;
+}
+
+bool AnalysisSession::analyze_sample_window(const std::string& vcd_path, uint64_t begin_offset, uint64_t end_offset, const SignalState& baseline,
+                                            const char* history_begin, const char* history_end) {
+    m_statistics.set_shard_mode(true);
+    m_shard_sync_roles = (1u << static_cast<int>(VcdSignalPhysicalType::PCLK)) | (1u << static_cast<int>(VcdSignalPhysicalType::PSEL)) |
+                         (1u << static_cast<int>(VcdSignalPhysicalType::PENABLE)) | (1u << static_cast<int>(VcdSignalPhysicalType::PWRITE)) |
+                         (1u << static_cast<int>(VcdSignalPhysicalType::PADDR));
+    m_shard_phase = ShardPhase::WARM_UP;
+    m_shard_end_offset = end_offset;
+    m_current_signal_snapshot = baseline;
+    m_previous_pclk_val_for_edge_detection = baseline.test(STATE_PCLK);
+    m_last_processed_vcd_timestamp = baseline.timestamp;
+    m_sample_history_begin = history_begin;
+    m_sample_history_end = history_end;
+    m_parser.set_resume_offset(begin_offset);
+    if (!parse_file(vcd_path))
+        return false;
+    m_statistics.resolve_deferred_mirroring_locally();
+    return true;
+}
+
+bool AnalysisSession::merge_sample_results(const std::vector<std::string>& results, std::vector<SampleWindowStats>& windows) {
+    for (std::size_t k = 0; k < results.size() && k < windows.size(); ++k) {
+        std::istringstream in(results[k]);
+        CheckpointReader r(in);
+        ShardResultHeader h;
+        if (!read_shard_result_header(r, h))
+            return false;
+        if (!h.analyzed)
+            continue;
+        Statistics window_statistics;
+        ApbAnalyzer window_analyzer(window_statistics);
+        if (!window_analyzer.load_state(r) || !window_statistics.load_state(r) || !window_statistics.load_shard_handoff(r)) {
+            std::cerr << "Error: Corrupted sample window result" << std::endl;
+            return false;
+        }
+        SampleWindowStats& w = windows[k];
+        w.analyzed = true;
+        w.first_timestamp = h.first_analyzed_timestamp;
+        w.last_timestamp = h.last_timestamp;
+        w.pclk_edges = h.final_edge - h.first_analyzed_edge;
+        w.active_edges = window_statistics.get_bus_active_pclk_edges();
+        w.reads = window_statistics.get_read_transactions_no_wait() + window_statistics.get_read_transactions_with_wait();
+        w.writes = window_statistics.get_write_transactions_no_wait() + window_statistics.get_write_transactions_with_wait();
+        w.read_cycles = window_statistics.get_average_read_cycle_duration() * w.reads;
+        w.write_cycles = window_statistics.get_average_write_cycle_duration() * w.writes;
+        m_statistics.merge_shard(window_statistics);
+        m_analyzer.merge_shard(window_analyzer);
+        // 視窗之間不連續, 報表的 edge 計數只涵蓋分析過的 edge
+        m_pclk_rising_edge_counter += w.pclk_edges;
+        m_last_processed_vcd_timestamp = h.last_timestamp;
+    }
+    return true;
+}
+
+void AnalysisSession::refresh_running_statistics() {
+    m_statistics.set_total_pclk_rising_edges(m_pclk_rising_edge_counter);
+    m_statistics.set_first_valid_pclk_edge_for_stats(m_analyzer.get_first_valid_pclk_edge_for_stats());
+}
+
+void AnalysisSession::finalize() {
+    if (m_finalized)
+        return;
+    m_finalized = true;
+    m_statistics.set_total_pclk_rising_edges(m_pclk_rising_edge_counter);
+    m_analyzer.finalize_analysis(m_last_processed_vcd_timestamp);
+
+    std::chrono::duration<double, std::milli> elapsed_ms = std::chrono::high_resolution_clock::now() - m_start_time;
+    m_statistics.set_cpu_elapsed_time_ms(elapsed_ms.count());
+}
+
+void AnalysisSession::write_report(std::ostream& out) const {
+    ReportGenerator report_generator;
+    report_generator.generate_apb_transaction_report(m_statistics, out);
+}
+
+std::string AnalysisSession::get_report() const {
+    std::ostringstream oss;
+    write_report(oss);
+    return oss.str();
+}
+
+}  // namespace APBSystem
@@ -0,0 +1,190 @@
+// analysis_session.hpp
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "apb_analyzer.hpp"
+#include "apb_types.hpp"
+#include "fst_reader.hpp"
+#include "monotonic_arena.hpp"
+#include "signal_manager.hpp"
+#include "statistics.hpp"
+#include "vcd_parser.hpp"
+
+namespace APBSystem {
+
+class CheckpointWriter;
+
+// 同一個 #time 內的 value change 怎麼對應到 PCLK 上升緣
+enum class TimestampCoalescing {
+    OFF,                 // 逐行套用, 看到 PCLK 上升就立刻評估 (結果取決於模擬器輸出的行順序)
+    SAMPLE_BEFORE_EDGE,  // 合併整段後評估; 上升緣看到的是這個 timestamp 之前的值 (flip-flop 的取樣語意)
+    SAMPLE_AFTER_EDGE    // 合併整段後評估; 上升緣看到的是這個 timestamp 結束時的值
+};
+
+// --- 時間切片 (見 shard_runner.hpp) ---
+// 切片開始時的 pipeline 狀態; 由前面每個切片的 ShardScanSummary 依序組合而成
+struct ShardBoundaryState {
+    SignalState signal_state;
+    bool previous_pclk = false;
+    uint64_t pclk_rising_edge_count = 0;
+    uint64_t last_timestamp = 0;
+};
+// 一個切片只追蹤訊號值 (不做分析) 的結果
+struct ShardScanSummary {
+    uint32_t written_roles = 0;      // bit i: VcdSignalPhysicalType i 在切片內被寫入過
+    bool first_pclk_value = false;   // 切片內第一次寫入的 PCLK 值
+    uint64_t pclk_rising_edges = 0;  // 假設切片開始前 PCLK 為 0 的上升緣數
+    SignalState end_state;
+    uint64_t last_timestamp = 0;
+
+    // 接在 start 之後, 回傳下一個切片開始時的狀態
+    ShardBoundaryState advance(const ShardBoundaryState& start) const;
+};
+
+// --- 取樣分析 (見 shard_runner.hpp) ---
+// 一個取樣視窗的計數; 視窗內找不到同步點時 analyzed 為 false
+struct SampleWindowStats {
+    uint64_t window_begin_ps = 0;  // 要求的時間範圍
+    uint64_t window_end_ps = 0;
+    bool analyzed = false;
+    uint64_t first_timestamp = 0;  // 實際分析的範圍: 同步的 idle edge 到結束的 idle edge
+    uint64_t last_timestamp = 0;
+    uint64_t pclk_edges = 0;
+    uint64_t active_edges = 0;
+    uint64_t reads = 0;
+    uint64_t writes = 0;
+    double read_cycles = 0.0;
+    double write_cycles = 0.0;
+};
+struct SampleSummary {
+    uint64_t trace_begin_ps = 0;  // 檔案中第一個與最後一個 #timestamp
+    uint64_t trace_end_ps = 0;
+    bool random_placement = false;
+    uint64_t seed = 0;
+    std::vector<SampleWindowStats> windows;  // 依時間排序
+};
+
+// 一次完整分析所需的 pipeline (VcdParser -> SignalManager -> ApbAnalyzer -> Statistics)
+// 可以從檔案讀取, 也可以把記憶體中的 VCD 資料分段 feed 進來 (不需要任何檔案 I/O)
+class AnalysisSession {
+   public:
+    AnalysisSession();
+    AnalysisSession(const AnalysisSession&) = delete;
+    AnalysisSession& operator=(const AnalysisSession&) = delete;
+
+    // --- 輸入 ---
+    // 檔案開頭是 FST header 時改用 FstReader, 其他一律當作 VCD 文字
+    bool parse_file(const std::string& vcd_path);
+    bool parse_fst_file(const std::string& fst_path);
+    bool follow_file(const std::string& vcd_path,
+                     const VcdParser::FollowOptions& options,
+                     VcdParser::FollowPollCallback on_poll);
+    void feed(const char* data, std::size_t len);
+    // 處理 feed 剩下的不完整行並 finalize
+    void finish();
+    // 從二進位 value-change feed (見 value_change_feed.hpp) 讀到 END_OF_STREAM
+    bool ingest_value_change_feed(int fd);
+    void apply_value_change(uint64_t time_ps, uint32_t signal_index, uint32_t value, uint32_t xmask);
+
+    // 要在開始解析之前設定; 只影響 VCD 文字輸入
+    void set_timestamp_coalescing(TimestampCoalescing mode) { m_coalescing = mode; }
+    // FST value change block 的解壓縮執行緒數
+    void set_input_threads(unsigned threads) { m_input_threads = threads > 0 ? threads : 1; }
+
+    // --- Checkpoint ---
+    // 要保存 checkpoint 時在解析之前呼叫: 檔尾不完整的行留給 resume 處理
+    void set_hold_unterminated_tail(bool hold) { m_parser.set_hold_unterminated_tail(hold); }
+    bool resume_from_checkpoint(const std::string& checkpoint_path, const std::string& vcd_path);
+    bool save_checkpoint(const std::string& checkpoint_path, const std::string& vcd_path) const;
+
+    // --- 時間切片 worker (在 fork 出來、尚未解析任何資料的 session 上呼叫) ---
+    // [begin_offset, end_offset) 從 #timestamp 行開始; end_offset 為 0 表示到檔案結尾
+    bool scan_shard(const std::string& vcd_path, uint64_t begin_offset, uint64_t end_offset, ShardScanSummary& summary);
+    // start 為 nullptr 表示第一個切片 (從頭分析); 其他切片在第一個 idle edge 之後才開始分析,
+    // 超過 end_offset 之後繼續分析到下一個 idle edge
+    bool analyze_shard(const std::string& vcd_path, uint64_t begin_offset, uint64_t end_offset, const ShardBoundaryState* start);
+    void save_shard_result(CheckpointWriter& w) const;
+    // parent: 依切片順序合併; check 失敗 (例如需要前面切片的 shadow memory) 時 reason 說明原因, session 不會被修改
+    bool check_shard_results(const std::vector<std::string>& results, std::string& reason) const;
+    bool merge_shard_results(const std::vector<std::string>& results);
+
+    // --- 取樣 worker ---
+    // history 是視窗之前 (標頭之後) 的檔案內容: 從視窗開頭往前找每個 APB 角色最後一次寫入的值,
+    // 找不到的角色以 baseline 為初值; 找不到的控制訊號 (PCLK/PSEL/PENABLE/PWRITE/PADDR) 要先在視窗內寫入過,
+    // 之後的第一個 idle edge 才開始分析, 超過 end_offset 之後分析到下一個 idle edge
+    bool analyze_sample_window(const std::string& vcd_path, uint64_t begin_offset, uint64_t end_offset, const SignalState& baseline,
+                               const char* history_begin, const char* history_end);
+    // parent: 依時間順序合併各視窗的結果, 並填入 windows 中每個視窗的計數
+    bool merge_sample_results(const std::vector<std::string>& results, std::vector<SampleWindowStats>& windows);
+
+    // --- 結果 ---
+    // finalize 只會執行一次; 之後不能再 feed
+    void finalize();
+    bool is_finalized() const { return m_finalized; }
+    // 讓 follow 模式的快照可以在 finalize 前讀取 bus utilization
+    void refresh_running_statistics();
+    void write_report(std::ostream& out) const;
+    std::string get_report() const;
+
+    Statistics& statistics() { return m_statistics; }
+    const Statistics& statistics() const { return m_statistics; }
+    ApbAnalyzer& analyzer() { return m_analyzer; }
+    const ApbAnalyzer& analyzer() const { return m_analyzer; }
+    uint64_t get_last_timestamp() const { return m_last_processed_vcd_timestamp; }
+    uint64_t get_pclk_rising_edge_count() const { return m_pclk_rising_edge_counter; }
+
+   private:
+    void on_var_definition(const VcdVarDefinition& definition);
+    void on_timestamp(uint64_t vcd_time_ps);
+    void on_value_change(const char* id, std::size_t id_len, const char* value_ptr, std::size_t value_len);
+    void on_end_definitions();
+    void on_pclk_rising_edge();
+    // 套用目前 timestamp 暫存的 value change 並評估 PCLK 上升緣
+    void flush_coalesced_changes();
+    void apply_fst_time_step(uint64_t time, const FstValueChange* changes, std::size_t count);
+    void on_shard_pclk_rising_edge();
+    // 回傳在 history 中找到值的角色
+    uint32_t resync_from_sample_history();
+
+    static const uint64_t TRANSACTION_LIMIT = 1000000;
+
+    VcdParser m_parser;
+    VcdParser::VarDefinitionCallback m_var_def_cb;
+    VcdParser::TimestampCallback m_time_cb;
+    VcdParser::ValueChangeCallback m_val_change_cb;
+    VcdParser::EndDefinitionsCallback m_end_def_cb;
+    SignalManager m_signal_manager;
+    // 分析期間的容器都從這裡配置, session 結束時整批釋放; 必須宣告在 m_statistics 之前
+    MonotonicArena m_arena;
+    Statistics m_statistics;
+    ApbAnalyzer m_analyzer;
+
+    SignalState m_current_signal_snapshot;
+    bool m_previous_pclk_val_for_edge_detection = false;
+    uint64_t m_pclk_rising_edge_counter = 0;
+    uint64_t m_last_processed_vcd_timestamp = 0;
+    TimestampCoalescing m_coalescing = TimestampCoalescing::OFF;
+    unsigned m_input_threads = 1;
+    bool m_fst_input = false;
+    bool m_resumed_from_checkpoint = false;
+    bool m_finalized = false;
+    std::chrono::high_resolution_clock::time_point m_start_time;
+
+    // 時間切片 worker: SCAN 只追蹤訊號值; WARM_UP 等待第一個 idle edge; ANALYZE 正常分析
+    enum class ShardPhase : uint8_t { NONE, SCAN, WARM_UP, ANALYZE };
+    ShardPhase m_shard_phase = ShardPhase::NONE;
+    uint64_t m_shard_end_offset = 0;
+    bool m_shard_past_end = false;
+    bool m_shard_stopped_at_idle_edge = false;
+    uint64_t m_shard_first_analyzed_edge = 0;  // 從這個 edge 之後開始分析
+    uint64_t m_shard_first_analyzed_timestamp = 0;
+    uint32_t m_shard_sync_roles = 0;  // WARM_UP 結束前必須寫入過的角色 (取樣視窗)
+    const char* m_sample_history_begin = nullptr;
+    const char* m_sample_history_end = nullptr;
+};
+
+}  // namespace APBSystem
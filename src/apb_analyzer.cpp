@@ -1,53 +1,160 @@
 #include "apb_analyzer.hpp"
+#include <array>
 #include <iomanip>
 #include <iostream>
+#include "checkpoint.hpp"
 
 namespace APBSystem {
 
+namespace {
+// FSM 轉移表: 以 (目前狀態, PSEL/PENABLE/PREADY 與其 X 旗標) 為索引, 每個 edge 只查一次表
+enum FsmAction : uint8_t {
+    FSM_BUS_ACTIVE = 1u << 0,
+    FSM_START = 1u << 1,
+    FSM_ENTER_ACCESS = 1u << 2,
+    FSM_WAIT = 1u << 3,
+    FSM_COMPLETE = 1u << 4,
+    FSM_ABORT = 1u << 5,
+    FSM_CHECK_STABLE = 1u << 6
+};
+struct FsmTransition {
+    uint8_t actions;
+    ApbFsmState next_state;
+    ProtocolViolationKind violation;
+};
+const int FSM_STATE_COUNT = 3;
+const int FSM_CONTROL_COMBINATIONS = STATE_FSM_CONTROL_MASK + 1;
+using FsmTable = std::array<FsmTransition, FSM_STATE_COUNT * FSM_CONTROL_COMBINATIONS>;
+
+FsmTransition make_transition(ApbFsmState state, uint32_t c) {
+    const bool psel_valid = (c & (STATE_PSEL | STATE_PSEL_X)) == STATE_PSEL;
+    const bool penable_valid = (c & (STATE_PENABLE | STATE_PENABLE_X)) == STATE_PENABLE;
+    const bool penable_low = (c & (STATE_PENABLE | STATE_PENABLE_X)) == 0;
+    const bool pready_valid = (c & (STATE_PREADY | STATE_PREADY_X)) == STATE_PREADY;
+    const bool control_x = (c & (STATE_PSEL_X | STATE_PENABLE_X | STATE_PREADY_X)) != 0;
+    FsmTransition t = {static_cast<uint8_t>(psel_valid ? FSM_BUS_ACTIVE : 0), state, ProtocolViolationKind::NONE};
+    // PSEL 失效時用來區分是 X 還是確定為 0
+    const ProtocolViolationKind psel_lost = (c & STATE_PSEL_X) ? ProtocolViolationKind::CONTROL_X_IN_TRANSFER : ProtocolViolationKind::PSEL_DROPPED_IN_ACCESS;
+    const ProtocolViolationKind penable_lost = (c & STATE_PENABLE_X) ? ProtocolViolationKind::CONTROL_X_IN_TRANSFER : ProtocolViolationKind::PENABLE_DROPPED_IN_ACCESS;
+    switch (state) {
+        case ApbFsmState::IDLE:
+            if ((c & (STATE_PSEL | STATE_PSEL_X | STATE_PENABLE)) == STATE_PSEL) {
+                t.actions |= FSM_START;
+                t.next_state = ApbFsmState::SETUP;
+            } else if (penable_valid) {
+                t.violation = ProtocolViolationKind::PENABLE_IN_IDLE;
+            }
+            break;
+        case ApbFsmState::SETUP:
+            if (!psel_valid) {
+                t.actions |= FSM_ABORT;
+                t.next_state = ApbFsmState::IDLE;
+                t.violation = (c & STATE_PSEL_X) ? ProtocolViolationKind::CONTROL_X_IN_TRANSFER : ProtocolViolationKind::SETUP_ABORTED;
+            } else if (penable_valid) {
+                // 進入 ACCESS 的同一個 edge 就判斷 PREADY
+                t.actions |= FSM_ENTER_ACCESS | FSM_CHECK_STABLE | (pready_valid ? FSM_COMPLETE : FSM_WAIT);
+                t.next_state = pready_valid ? ApbFsmState::IDLE : ApbFsmState::ACCESS;
+                if (control_x)
+                    t.violation = ProtocolViolationKind::CONTROL_X_IN_TRANSFER;
+            } else {
+                t.actions |= FSM_CHECK_STABLE;
+                t.violation = control_x ? ProtocolViolationKind::CONTROL_X_IN_TRANSFER : ProtocolViolationKind::SETUP_NOT_FOLLOWED_BY_ACCESS;
+            }
+            break;
+        case ApbFsmState::ACCESS:
+            if (pready_valid) {
+                // PREADY 有效時一律完成交易, 但 PSEL/PENABLE 已失效仍記為違規
+                t.actions |= FSM_COMPLETE | (psel_valid ? FSM_CHECK_STABLE : 0);
+                t.next_state = ApbFsmState::IDLE;
+                if (!psel_valid)
+                    t.violation = psel_lost;
+                else if (!penable_valid)
+                    t.violation = penable_lost;
+            } else if (!psel_valid || penable_low) {
+                t.actions |= FSM_ABORT;
+                t.next_state = ApbFsmState::IDLE;
+                t.violation = !psel_valid ? psel_lost : ProtocolViolationKind::PENABLE_DROPPED_IN_ACCESS;
+            } else {
+                t.actions |= FSM_WAIT | FSM_CHECK_STABLE;
+                if (control_x)
+                    t.violation = ProtocolViolationKind::CONTROL_X_IN_TRANSFER;
+            }
+            break;
+    }
+    return t;
+}
+FsmTable build_fsm_table() {
+    FsmTable table;
+    for (int s = 0; s < FSM_STATE_COUNT; ++s)
+        for (int c = 0; c < FSM_CONTROL_COMBINATIONS; ++c)
+            table[s * FSM_CONTROL_COMBINATIONS + c] = make_transition(static_cast<ApbFsmState>(s), static_cast<uint32_t>(c));
+    return table;
+}
+const FsmTable FSM_TRANSITION_TABLE = build_fsm_table();
+}  // namespace
+
 ApbAnalyzer::ApbAnalyzer(Statistics& statistics /*, std::ostream& debug_stream*/)
-    : m_statistics(statistics) /*, m_debug_stream(debug_stream)*/, m_current_apb_fsm_state(ApbFsmState::IDLE), m_current_pclk_edge_count(0), m_system_out_of_reset(false), m_first_valid_pclk_edge_for_stats(0), m_transaction_cycle_counter(0), m_completed_transaction_count(0) {
+    : m_statistics(statistics) /*, m_debug_stream(debug_stream)*/, m_current_apb_fsm_state(ApbFsmState::IDLE), m_current_pclk_edge_count(0), m_system_out_of_reset(false), m_first_valid_pclk_edge_for_stats(0), m_transaction_cycle_counter(0), m_completed_transactions(ArenaAllocator<char>(statistics.get_arena())), m_completed_transaction_count(0), m_preliminary_oor_errors(ArenaAllocator<char>(statistics.get_arena())), m_preliminary_overlap_errors(ArenaAllocator<char>(statistics.get_arena())) {
     m_current_transaction.reset();
 }
 void ApbAnalyzer::analyze_on_pclk_rising_edge(const SignalState& snapshot, uint64_t pclk_edge_count) {
     m_current_pclk_edge_count = pclk_edge_count;
     if (!m_system_out_of_reset) {
-        if (snapshot.presetn) {
+        if (snapshot.presetn()) {
             m_system_out_of_reset = true;
             m_first_valid_pclk_edge_for_stats = pclk_edge_count;
         } else
             return;
     }
-    if (m_current_transaction.active)
+    m_statistics.record_timeline_pclk_edge(pclk_edge_count, snapshot.timestamp);
+    if (m_current_transaction.active())
         m_transaction_cycle_counter++;
     if (check_for_timeout(snapshot))
         return;
-    if (snapshot.psel && !snapshot.psel_has_x)
+    const FsmTransition& tr = FSM_TRANSITION_TABLE[static_cast<int>(m_current_apb_fsm_state) * FSM_CONTROL_COMBINATIONS +
+                                                   (snapshot.flags & STATE_FSM_CONTROL_MASK)];
+    if (tr.actions & FSM_BUS_ACTIVE)
         m_statistics.record_bus_active_pclk_edge();
-    ApbFsmState state_before = m_current_apb_fsm_state;
-    if (state_before == ApbFsmState::IDLE) {
-        handle_idle_state(snapshot);
-    } else if (state_before == ApbFsmState::SETUP) {
-        handle_setup_state(snapshot);
-    }
-    if (m_current_apb_fsm_state == ApbFsmState::ACCESS) {
-        handle_access_state(snapshot);
+    if (tr.violation != ProtocolViolationKind::NONE)
+        record_protocol_violation(tr.violation, snapshot);
+    if (tr.actions & FSM_CHECK_STABLE)
+        check_transfer_stability(snapshot);
+    if (tr.actions & FSM_START) {
+        start_transaction(snapshot);
+    } else if (tr.actions & FSM_ABORT) {
+        abort_current_transaction();
+    } else {
+        if (tr.actions & FSM_ENTER_ACCESS) {
+            m_current_transaction.pwdata_val = snapshot.pwdata();
+            m_current_transaction.set(TXN_PWDATA_X, snapshot.pwdata_has_x());
+        }
+        if (tr.actions & FSM_WAIT)
+            m_current_transaction.flags |= TXN_HAD_WAIT;
+        if (tr.actions & FSM_COMPLETE)
+            process_transaction_completion(snapshot);
     }
+    m_current_apb_fsm_state = tr.next_state;
 }
-void ApbAnalyzer::handle_idle_state(const SignalState& snapshot) {
-    if (!snapshot.psel || snapshot.psel_has_x || snapshot.penable)
-        return;
-    m_current_apb_fsm_state = ApbFsmState::SETUP;
-    m_current_transaction.active = true;
+void ApbAnalyzer::start_transaction(const SignalState& snapshot) {
+    uint32_t flags = TXN_ACTIVE;
+    if (snapshot.match(STATE_PWRITE | STATE_PWRITE_X, STATE_PWRITE))
+        flags |= TXN_WRITE;
+    if (snapshot.paddr_has_x())
+        flags |= TXN_PADDR_X;
+    if (snapshot.pwdata_has_x())
+        flags |= TXN_PWDATA_X;
+    if (snapshot.test(STATE_PSTRB_X))
+        flags |= TXN_PSTRB_X;
+    // PSTRB / PPROT 在 SETUP 取樣, 位元位置與 SignalState 相同可以直接複製
+    flags |= snapshot.flags & (APB4_PSTRB_MASK | APB4_PPROT_MASK);
+    m_current_transaction.flags = flags;
     m_current_transaction.start_pclk_edge_count = m_current_pclk_edge_count;
     m_current_transaction.transaction_start_time_ps = snapshot.timestamp;
-    m_current_transaction.is_write = snapshot.pwrite && !snapshot.pwrite_has_x;
-    m_current_transaction.paddr = snapshot.paddr;
-    m_current_transaction.paddr_val_has_x = snapshot.paddr_has_x;
-    m_current_transaction.pwdata_val = snapshot.pwdata;
-    m_current_transaction.pwdata_val_has_x = snapshot.pwdata_has_x;
+    m_current_transaction.paddr = snapshot.paddr();
+    m_current_transaction.pwdata_val = snapshot.pwdata();
     m_transaction_cycle_counter = 1;
-    m_current_transaction.target_completer = snapshot.paddr_has_x ? CompleterID::UNKNOWN_COMPLETER : get_completer_id_from_paddr(snapshot.paddr);
-    if (m_current_transaction.is_write) {
+    m_current_transaction.target_completer = snapshot.paddr_has_x() ? CompleterID::UNKNOWN_COMPLETER : get_completer_id_from_paddr(snapshot.paddr());
+    if (m_current_transaction.is_write()) {
         m_pending_writes[m_current_transaction.paddr] = {snapshot.timestamp, m_current_pclk_edge_count};
     } else {
         auto it = m_pending_writes.find(m_current_transaction.paddr);
@@ -55,88 +162,108 @@ void ApbAnalyzer::handle_idle_state(const SignalState& snapshot) {
             m_preliminary_overlap_errors.push_back({{snapshot.timestamp, m_current_transaction.paddr},
                                                     it->second.start_time_ps,
                                                     it->first});
+            if (m_live_error_cb)
+                m_live_error_cb(LiveErrorKind::READ_WRITE_OVERLAP, snapshot.timestamp, m_current_transaction.paddr);
         }
     }
 }
-void ApbAnalyzer::handle_setup_state(const SignalState& snapshot) {
-    if (!m_current_transaction.active) {
-        m_current_apb_fsm_state = ApbFsmState::IDLE;
-        return;
+void ApbAnalyzer::check_transfer_stability(const SignalState& snapshot) {
+    TransactionInfo& txn = m_current_transaction;
+    if (!txn.test(TXN_PADDR_CHANGED) && (snapshot.paddr() != txn.paddr || snapshot.paddr_has_x() != txn.paddr_has_x())) {
+        txn.flags |= TXN_PADDR_CHANGED;
+        record_protocol_violation(ProtocolViolationKind::PADDR_CHANGED_IN_TRANSFER, snapshot);
     }
-    if (!snapshot.psel || snapshot.psel_has_x) {
-        if (m_current_transaction.is_write)
-            m_pending_writes.erase(m_current_transaction.paddr);
-        m_current_transaction.reset();
-        m_current_apb_fsm_state = ApbFsmState::IDLE;
-        return;
-    }
-    if (snapshot.penable && !snapshot.penable_has_x) {
-        m_current_apb_fsm_state = ApbFsmState::ACCESS;
-        m_current_transaction.pwdata_val = snapshot.pwdata;
-        m_current_transaction.pwdata_val_has_x = snapshot.pwdata_has_x;
+    if (!txn.test(TXN_PWRITE_CHANGED) && snapshot.match(STATE_PWRITE | STATE_PWRITE_X, STATE_PWRITE) != txn.is_write()) {
+        txn.flags |= TXN_PWRITE_CHANGED;
+        record_protocol_violation(ProtocolViolationKind::PWRITE_CHANGED_IN_TRANSFER, snapshot);
     }
 }
-void ApbAnalyzer::handle_access_state(const SignalState& snapshot) {
-    if (!m_current_transaction.active) {
-        m_current_apb_fsm_state = ApbFsmState::IDLE;
-        return;
-    }
-    if (snapshot.pready && !snapshot.pready_has_x) {
-        process_transaction_completion(snapshot);
-        return;
-    }
-    if (!snapshot.psel || snapshot.psel_has_x || (!snapshot.penable && !snapshot.penable_has_x)) {
-        if (m_current_transaction.is_write)
-            m_pending_writes.erase(m_current_transaction.paddr);
-        m_current_transaction.reset();
-        m_current_apb_fsm_state = ApbFsmState::IDLE;
-        return;
-    }
-    m_current_transaction.had_wait_state = true;
+void ApbAnalyzer::record_protocol_violation(ProtocolViolationKind kind, const SignalState& snapshot) {
+    // 交易進行中回報 SETUP 時的位址, 否則回報當下的 PADDR
+    uint32_t paddr = m_current_transaction.active() ? m_current_transaction.paddr : snapshot.paddr();
+    m_statistics.record_protocol_violation({snapshot.timestamp, paddr, kind});
 }
-bool ApbAnalyzer::check_for_timeout(const SignalState& snapshot) {
-    if (!m_current_transaction.active || m_transaction_cycle_counter <= 1000)
-        return false;
-    m_statistics.record_timeout_error({m_current_transaction.transaction_start_time_ps, m_current_transaction.paddr});
-    if (m_current_transaction.is_write)
+void ApbAnalyzer::abort_current_transaction() {
+    if (m_current_transaction.is_write())
         m_pending_writes.erase(m_current_transaction.paddr);
     m_current_transaction.reset();
     m_current_apb_fsm_state = ApbFsmState::IDLE;
+}
+bool ApbAnalyzer::check_for_timeout(const SignalState& snapshot) {
+    if (!m_current_transaction.active() || m_transaction_cycle_counter <= 1000)
+        return false;
+    m_statistics.record_timeout_error({m_current_transaction.transaction_start_time_ps, m_current_transaction.paddr});
+    if (m_live_error_cb)
+        m_live_error_cb(LiveErrorKind::TIMEOUT, m_current_transaction.transaction_start_time_ps, m_current_transaction.paddr);
+    abort_current_transaction();
     return true;
 }
 void ApbAnalyzer::process_transaction_completion(const SignalState& snapshot) {
-    if (!m_current_transaction.active)
+    if (!m_current_transaction.active())
         return;
+    const TransactionInfo& txn = m_current_transaction;
+    const bool is_write = txn.is_write();
+    const bool paddr_has_x = txn.paddr_has_x();
     m_completed_transaction_count++;
-    if (m_current_transaction.is_write)
-        m_pending_writes.erase(m_current_transaction.paddr);
-    m_statistics.record_accessed_completer(m_current_transaction.target_completer);
-    if (!m_current_transaction.paddr_val_has_x) {
-        m_statistics.record_paddr_for_corruption_analysis(m_current_transaction.target_completer, m_current_transaction.paddr);
+    if (is_write)
+        m_pending_writes.erase(txn.paddr);
+    m_statistics.record_accessed_completer(txn.target_completer);
+    if (!paddr_has_x) {
+        m_statistics.record_paddr_for_corruption_analysis(txn.target_completer, txn.paddr);
     }
-    if (m_current_transaction.is_write && !snapshot.pwdata_has_x) {
-        m_statistics.record_pwdata_for_corruption_analysis(m_current_transaction.target_completer, snapshot.pwdata);
+    if (is_write && !snapshot.pwdata_has_x()) {
+        m_statistics.record_pwdata_for_corruption_analysis(txn.target_completer, snapshot.pwdata());
     }
     preliminary_check_for_out_of_range(snapshot);
-    uint64_t duration = m_current_pclk_edge_count - m_current_transaction.start_pclk_edge_count + 1;
-    if (m_current_transaction.is_write)
-        m_statistics.record_write_transaction(m_current_transaction.had_wait_state, duration);
+    uint64_t duration = m_current_pclk_edge_count - txn.start_pclk_edge_count + 1;
+    if (is_write)
+        m_statistics.record_write_transaction(txn.had_wait_state(), duration, txn.target_completer);
     else
-        m_statistics.record_read_transaction(m_current_transaction.had_wait_state, duration);
-    if (!m_current_transaction.is_out_of_range) {
-        if (m_current_transaction.is_write && !m_current_transaction.paddr_val_has_x && !snapshot.pwdata_has_x) {
-            m_statistics.update_shadow_memory(m_current_transaction.target_completer, m_current_transaction.paddr, snapshot.pwdata, snapshot.timestamp);
-        } else if (!m_current_transaction.is_write && !m_current_transaction.paddr_val_has_x && !snapshot.prdata_has_x) {
-            m_statistics.check_for_data_mirroring(m_current_transaction.target_completer, m_current_transaction.paddr, snapshot.prdata, snapshot.timestamp);
+        m_statistics.record_read_transaction(txn.had_wait_state(), duration, txn.target_completer);
+    m_statistics.record_register_access(txn.target_completer, txn.paddr, is_write, duration, txn.transaction_start_time_ps);
+    // PSLVERR 回應的寫入不一定有生效, 讀回的資料也不可信, 都不參與 shadow memory 比對
+    const bool slave_error = snapshot.match(STATE_PSLVERR | STATE_PSLVERR_X, STATE_PSLVERR);
+    if (slave_error) {
+        m_current_transaction.flags |= TXN_SLVERR;
+        m_statistics.record_slave_error(txn.target_completer);
+    }
+    if (!txn.is_out_of_range() && !slave_error) {
+        if (is_write && !paddr_has_x && !snapshot.pwdata_has_x() && !txn.test(TXN_PSTRB_X)) {
+            m_statistics.update_shadow_memory(txn.target_completer, txn.paddr, snapshot.pwdata(), snapshot.timestamp, txn.pstrb());
+        } else if (!is_write && !paddr_has_x && !snapshot.prdata_has_x()) {
+            uint64_t mirroring_before = m_statistics.get_mirroring_error_count();
+            m_statistics.check_for_data_mirroring(txn.target_completer, txn.paddr, snapshot.prdata(), snapshot.timestamp);
+            if (m_live_error_cb && m_statistics.get_mirroring_error_count() != mirroring_before)
+                m_live_error_cb(LiveErrorKind::DATA_MIRRORING, snapshot.timestamp, txn.paddr);
         }
     }
-    m_completed_transactions.push_back(m_current_transaction);
+    if (m_transaction_cb) {
+        TransactionRecord record;
+        record.start_time_ps = txn.transaction_start_time_ps;
+        record.end_time_ps = snapshot.timestamp;
+        record.paddr = txn.paddr;
+        record.wait_cycles = duration > 2 ? static_cast<uint32_t>(duration - 2) : 0;
+        record.flags = txn.flags & ~(TXN_ACTIVE | TXN_PWDATA_X);
+        if (is_write) {
+            record.pwdata = snapshot.pwdata();
+            if (snapshot.pwdata_has_x())
+                record.flags |= TXN_PWDATA_X;
+        } else {
+            record.prdata = snapshot.prdata();
+            if (snapshot.prdata_has_x())
+                record.flags |= TXN_PRDATA_X;
+        }
+        record.completer = txn.target_completer;
+        m_transaction_cb(record);
+    }
+    if (m_keep_completed_transactions)
+        m_completed_transactions.push_back(m_current_transaction);
     m_current_transaction.reset();
     m_current_apb_fsm_state = ApbFsmState::IDLE;
 }
 void ApbAnalyzer::finalize_analysis(uint64_t final_ts) {
-    if (m_current_transaction.active) {
-        if (m_current_transaction.is_write)
+    if (m_current_transaction.active()) {
+        if (m_current_transaction.is_write())
             m_pending_writes.erase(m_current_transaction.paddr);
         m_current_transaction.reset();
     }
@@ -168,11 +295,88 @@ void ApbAnalyzer::filter_and_commit_errors() {
     }
 }
 void ApbAnalyzer::preliminary_check_for_out_of_range(const SignalState& snapshot) {
-    if (!m_current_transaction.active || m_current_transaction.paddr_val_has_x)
+    if (!m_current_transaction.active() || m_current_transaction.paddr_has_x())
         return;
     if (m_current_transaction.target_completer == CompleterID::UNKNOWN_COMPLETER) {
         m_preliminary_oor_errors.push_back({snapshot.timestamp, m_current_transaction.paddr});
+        if (m_live_error_cb)
+            m_live_error_cb(LiveErrorKind::OUT_OF_RANGE, snapshot.timestamp, m_current_transaction.paddr);
+    }
+}
+
+void ApbAnalyzer::start_after_idle_edge(uint64_t pclk_edge_count) {
+    m_current_pclk_edge_count = pclk_edge_count;
+    m_system_out_of_reset = true;
+    m_current_apb_fsm_state = ApbFsmState::IDLE;
+    m_current_transaction.reset();
+    m_transaction_cycle_counter = 0;
+    m_pending_writes.clear();
+}
+void ApbAnalyzer::merge_shard(const ApbAnalyzer& later) {
+    // 離開 reset 的 edge 只會出現在第一個分析到它的切片
+    if (!m_system_out_of_reset && later.m_system_out_of_reset) {
+        m_system_out_of_reset = true;
+        m_first_valid_pclk_edge_for_stats = later.m_first_valid_pclk_edge_for_stats;
+    }
+    m_current_apb_fsm_state = later.m_current_apb_fsm_state;
+    m_current_transaction = later.m_current_transaction;
+    m_current_pclk_edge_count = later.m_current_pclk_edge_count;
+    m_transaction_cycle_counter = later.m_transaction_cycle_counter;
+    m_pending_writes = later.m_pending_writes;
+    m_completed_transactions.insert(m_completed_transactions.end(), later.m_completed_transactions.begin(), later.m_completed_transactions.end());
+    m_completed_transaction_count += later.m_completed_transaction_count;
+    m_preliminary_oor_errors.insert(m_preliminary_oor_errors.end(), later.m_preliminary_oor_errors.begin(), later.m_preliminary_oor_errors.end());
+    m_preliminary_overlap_errors.insert(m_preliminary_overlap_errors.end(), later.m_preliminary_overlap_errors.begin(), later.m_preliminary_overlap_errors.end());
+}
+
+void ApbAnalyzer::save_state(CheckpointWriter& w) const {
+    w.write_pod(m_current_apb_fsm_state);
+    write_transaction_info(w, m_current_transaction);
+    w.write_pod(m_current_pclk_edge_count);
+    w.write_pod(m_system_out_of_reset);
+    w.write_pod(m_first_valid_pclk_edge_for_stats);
+    w.write_pod(m_transaction_cycle_counter);
+    w.write_pod<uint64_t>(m_pending_writes.size());
+    for (const auto& kv : m_pending_writes) {
+        w.write_pod(kv.first);
+        w.write_pod(kv.second);
+    }
+    w.write_pod<uint64_t>(m_completed_transactions.size());
+    for (const auto& t : m_completed_transactions)
+        write_transaction_info(w, t);
+    w.write_pod(m_completed_transaction_count);
+    w.write_pod_vector(m_preliminary_oor_errors);
+    w.write_pod_vector(m_preliminary_overlap_errors);
+}
+bool ApbAnalyzer::load_state(CheckpointReader& r) {
+    if (!r.read_enum(m_current_apb_fsm_state, ApbFsmState::ACCESS) || !read_transaction_info(r, m_current_transaction) ||
+        !r.read_pod(m_current_pclk_edge_count) || !r.read_bool(m_system_out_of_reset) ||
+        !r.read_pod(m_first_valid_pclk_edge_for_stats) || !r.read_pod(m_transaction_cycle_counter))
+        return false;
+    uint64_t n = 0;
+    if (!r.read_pod(n) || !r.fits(n, sizeof(uint32_t) + sizeof(PendingWriteInfo)))
+        return false;
+    m_pending_writes.clear();
+    for (uint64_t i = 0; i < n; ++i) {
+        uint32_t paddr = 0;
+        PendingWriteInfo info{};
+        if (!r.read_pod(paddr) || !r.read_pod(info))
+            return false;
+        m_pending_writes[paddr] = info;
+    }
+    if (!r.read_pod(n) || !r.fits(n, TRANSACTION_INFO_BYTES))
+        return false;
+    m_completed_transactions.clear();
+    m_completed_transactions.reserve(n);
+    for (uint64_t i = 0; i < n; ++i) {
+        TransactionInfo t;
+        if (!read_transaction_info(r, t))
+            return false;
+        m_completed_transactions.push_back(t);
     }
+    return r.read_pod(m_completed_transaction_count) &&
+           r.read_pod_vector(m_preliminary_oor_errors) &&
+           r.read_pod_vector(m_preliminary_overlap_errors);
 }
 
 }  // namespace APBSystem
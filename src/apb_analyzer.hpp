@@ -1,14 +1,23 @@
 // apb_analyzer.hpp
 #pragma once
 
+#include <functional>
 #include <map>
 #include <vector>
 #include "apb_types.hpp"
 #include "statistics.hpp"
 namespace APBSystem {
 
+class CheckpointWriter;
+class CheckpointReader;
+
 class ApbAnalyzer {
    public:
+    // 錯誤一被偵測到就通知; OUT_OF_RANGE / READ_WRITE_OVERLAP 在 finalize 時仍可能被過濾掉
+    using LiveErrorCallback = std::function<void(LiveErrorKind kind, uint64_t timestamp, uint32_t paddr)>;
+    // 每筆完成的交易 (依完成順序); 被 timeout 中止的交易不會送出
+    using TransactionCallback = std::function<void(const TransactionRecord& record)>;
+
     explicit ApbAnalyzer(Statistics& statistics /* std::ostream& debug_stream*/);
 
     void analyze_on_pclk_rising_edge(const SignalState& current_snapshot, uint64_t pclk_edge_count);
@@ -16,11 +25,43 @@ class ApbAnalyzer {
     uint64_t get_completed_transaction_count() const {
         return m_completed_transaction_count;
     }
+    const ArenaVector<TransactionInfo>& get_completed_transactions() const {
+        return m_completed_transactions;
+    }
+    uint64_t get_first_valid_pclk_edge_for_stats() const {
+        return m_first_valid_pclk_edge_for_stats;
+    }
+    void set_live_error_callback(LiveErrorCallback cb) {
+        m_live_error_cb = cb;
+    }
+    void set_transaction_callback(TransactionCallback cb) {
+        m_transaction_cb = cb;
+    }
+    // 關閉後不保留完成的交易 (只透過 callback 使用交易時, 記憶體不隨 trace 長度成長)
+    void set_keep_completed_transactions(bool keep) {
+        m_keep_completed_transactions = keep;
+    }
+
+    // --- 時間切片 ---
+    // PRESETN=1 且 PSEL 確定為 0 的 PCLK 上升緣: 不論之前的狀態, 這個 edge 之後 FSM 一定回到 IDLE,
+    // 沒有進行中的交易, 也沒有 pending write
+    static bool is_idle_edge(const SignalState& snapshot) {
+        return snapshot.presetn() && snapshot.match(STATE_PSEL | STATE_PSEL_X, 0);
+    }
+    // 從一個 idle edge 之後開始分析 (這個 edge 與之前的 edge 由前一個切片處理)
+    void start_after_idle_edge(uint64_t pclk_edge_count);
+    // later 是緊接在後面的切片
+    void merge_shard(const ApbAnalyzer& later);
+
+    // --- Checkpoint (FSM 狀態、進行中交易、pending writes 與計數器) ---
+    void save_state(CheckpointWriter& w) const;
+    bool load_state(CheckpointReader& r);
 
    private:
-    void handle_idle_state(const SignalState& snapshot);
-    void handle_setup_state(const SignalState& snapshot);
-    void handle_access_state(const SignalState& snapshot);
+    void start_transaction(const SignalState& snapshot);
+    void abort_current_transaction();
+    void check_transfer_stability(const SignalState& snapshot);
+    void record_protocol_violation(ProtocolViolationKind kind, const SignalState& snapshot);
 
     void process_transaction_completion(const SignalState& snapshot_at_completion);
 
@@ -42,9 +83,10 @@ class ApbAnalyzer {
         uint64_t start_time_ps;
         uint64_t start_pclk_edge_count;
     };
+    // 每筆 write 都會 insert / erase: arena 不會回收刪除的節點, 所以放在一般的 heap
     std::map<uint32_t, PendingWriteInfo> m_pending_writes;
 
-    std::vector<TransactionInfo> m_completed_transactions;
+    ArenaVector<TransactionInfo> m_completed_transactions;
     uint64_t m_completed_transaction_count;
 
     struct PreliminaryOverlapInfo {
@@ -52,8 +94,11 @@ class ApbAnalyzer {
         uint64_t write_start_time;
         uint32_t write_paddr;
     };
-    std::vector<OutOfRangeAccessDetail> m_preliminary_oor_errors;
-    std::vector<PreliminaryOverlapInfo> m_preliminary_overlap_errors;
+    ArenaVector<OutOfRangeAccessDetail> m_preliminary_oor_errors;
+    ArenaVector<PreliminaryOverlapInfo> m_preliminary_overlap_errors;
+    LiveErrorCallback m_live_error_cb;
+    TransactionCallback m_transaction_cb;
+    bool m_keep_completed_transactions = true;
     // std::ostream& m_debug_stream;
 };
 
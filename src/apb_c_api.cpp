@@ -0,0 +1,69 @@
+// apb_c_api.cpp
+#include "apb_c_api.h"
+#include <exception>
+#include <iostream>
+#include <string>
+#include "analysis_session.hpp"
+
+struct apb_session {
+    APBSystem::AnalysisSession session;
+    std::string report;
+};
+
+extern "C" {
+
+apb_session* apb_session_create(void) {
+    // AnalysisSession 的建構也會配置記憶體, 例外不能穿過 extern "C"
+    try {
+        return new apb_session();
+    } catch (const std::exception& e) {
+        std::cerr << "Error: apb_session_create: " << e.what() << std::endl;
+        return nullptr;
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void apb_session_destroy(apb_session* session) {
+    delete session;
+}
+
+// 任何例外都不能穿過 extern "C", 一律轉成 -1
+int apb_session_feed(apb_session* session, const char* data, size_t len) {
+    if (session == nullptr || (data == nullptr && len > 0) || session->session.is_finalized())
+        return -1;
+    try {
+        session->session.feed(data, len);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: apb_session_feed: " << e.what() << std::endl;
+        return -1;
+    } catch (...) {
+        return -1;
+    }
+    return 0;
+}
+
+int apb_session_finish(apb_session* session) {
+    if (session == nullptr)
+        return -1;
+    try {
+        session->session.finish();
+        session->report = session->session.get_report();
+    } catch (const std::exception& e) {
+        std::cerr << "Error: apb_session_finish: " << e.what() << std::endl;
+        return -1;
+    } catch (...) {
+        return -1;
+    }
+    return 0;
+}
+
+const char* apb_session_get_report(apb_session* session, size_t* out_len) {
+    if (session == nullptr || !session->session.is_finalized())
+        return nullptr;
+    if (out_len != nullptr)
+        *out_len = session->report.size();
+    return session->report.c_str();
+}
+
+}  // extern "C"
@@ -0,0 +1,30 @@
+/* apb_c_api.h - 給 C / DPI 呼叫端使用的 APB 分析介面 */
+#ifndef APB_C_API_H
+#define APB_C_API_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct apb_session apb_session;
+
+/* 建立一個新的分析 session, 失敗時回傳 NULL */
+apb_session* apb_session_create(void);
+void apb_session_destroy(apb_session* session);
+
+/* 餵入任意切塊的 VCD 文字資料 (不需要以換行結尾); 成功回傳 0 */
+int apb_session_feed(apb_session* session, const char* data, size_t len);
+
+/* 結束輸入並完成分析; 成功回傳 0 */
+int apb_session_finish(apb_session* session);
+
+/* 取得報表文字 (需先呼叫 apb_session_finish); 指標在 session 銷毀前有效 */
+const char* apb_session_get_report(apb_session* session, size_t* out_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* APB_C_API_H */
@@ -1,10 +1,12 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
 #include <cstdint>
 #include <map>
 #include <string>
 #include <vector>
+#include "monotonic_arena.hpp"
 
 namespace APBSystem {
 
@@ -17,60 +19,136 @@ enum class CompleterID { UART,
                          SPI_MASTER,
                          UNKNOWN_COMPLETER,
                          NONE };
+inline const char* completer_id_name(CompleterID id) {
+    switch (id) {
+        case CompleterID::UART:
+            return "UART";
+        case CompleterID::GPIO:
+            return "GPIO";
+        case CompleterID::SPI_MASTER:
+            return "SPI_MASTER";
+        case CompleterID::UNKNOWN_COMPLETER:
+            return "UNKNOWN";
+        default:
+            return "NONE";
+    }
+}
+// follow 模式下即時回報的錯誤種類
+enum class LiveErrorKind { TIMEOUT,
+                           OUT_OF_RANGE,
+                           READ_WRITE_OVERLAP,
+                           DATA_MIRRORING };
 const uint32_t UART_BASE_ADDR = 0x1A100000;
 const uint32_t UART_END_ADDR = 0x1A100FFF;
 const uint32_t GPIO_BASE_ADDR = 0x1A101000;
 const uint32_t GPIO_END_ADDR = 0x1A101FFF;
 const uint32_t SPI_MASTER_BASE_ADDR = 0x1A102000;
 const uint32_t SPI_MASTER_END_ADDR = 0x1A102FFF;
+// completer 的位址空間是 4KB, 同一個 completer 的 PADDR 只有 a0-a11 會改變
+const int PADDR_OFFSET_BITS = 12;
 
 // --- 交易與訊號狀態結構  ---
+// 布林欄位集中成一個 bitmask, 讓每個 edge 的複製與 FSM 判斷都只需要少數幾次 mask 比較
+enum TransactionFlag : uint32_t {
+    TXN_ACTIVE = 1u << 0,
+    TXN_WRITE = 1u << 1,
+    TXN_PADDR_X = 1u << 2,
+    TXN_PWDATA_X = 1u << 3,
+    TXN_HAD_WAIT = 1u << 4,
+    TXN_OUT_OF_RANGE = 1u << 5,
+    // 同一筆交易的 PADDR/PWRITE 變動只回報一次
+    TXN_PADDR_CHANGED = 1u << 6,
+    TXN_PWRITE_CHANGED = 1u << 7,
+    TXN_PSTRB_X = 1u << 8,
+    TXN_SLVERR = 1u << 9,
+    // 只用在 TransactionRecord: 完成時 PRDATA 含 X/Z
+    TXN_PRDATA_X = 1u << 10
+};
+// APB4 的 PSTRB / PPROT 值放在 flags 的高位元, SignalState 與 TransactionInfo 使用相同位置
+const uint32_t APB4_PSTRB_SHIFT = 16;
+const uint32_t APB4_PSTRB_MASK = 0xFFu << APB4_PSTRB_SHIFT;
+const uint32_t APB4_PPROT_SHIFT = 24;
+const uint32_t APB4_PPROT_MASK = 0x7u << APB4_PPROT_SHIFT;
 struct TransactionInfo {
-    bool active = false;
     uint64_t start_pclk_edge_count = 0;
     uint64_t transaction_start_time_ps = 0;
-    uint64_t end_time_ps = 0;
-    bool is_write = false;
     uint32_t paddr = 0;
-    bool paddr_val_has_x = false;
     uint32_t pwdata_val = 0;
-    bool pwdata_val_has_x = false;
-    bool had_wait_state = false;
+    uint32_t flags = 0;
     CompleterID target_completer = CompleterID::NONE;
-    bool is_out_of_range = false;
-    void reset() {
-        active = false;
-        start_pclk_edge_count = 0;
-        transaction_start_time_ps = 0;
-        is_write = false;
-        paddr = 0;
-        paddr_val_has_x = false;
-        pwdata_val = 0;
-        pwdata_val_has_x = false;
-        had_wait_state = false;
-        target_completer = CompleterID::NONE;
-        is_out_of_range = false;
-    }
+
+    bool test(uint32_t mask) const { return (flags & mask) != 0; }
+    void set(uint32_t mask, bool on) { flags = on ? (flags | mask) : (flags & ~mask); }
+    bool active() const { return test(TXN_ACTIVE); }
+    bool is_write() const { return test(TXN_WRITE); }
+    bool paddr_has_x() const { return test(TXN_PADDR_X); }
+    bool pwdata_has_x() const { return test(TXN_PWDATA_X); }
+    bool had_wait_state() const { return test(TXN_HAD_WAIT); }
+    bool is_out_of_range() const { return test(TXN_OUT_OF_RANGE); }
+    bool slave_error() const { return test(TXN_SLVERR); }
+    uint32_t pstrb() const { return (flags & APB4_PSTRB_MASK) >> APB4_PSTRB_SHIFT; }
+    uint32_t pprot() const { return (flags & APB4_PPROT_MASK) >> APB4_PPROT_SHIFT; }
+    void reset() { *this = TransactionInfo(); }
 };
+// 一筆已完成的交易, 提供給下游工具 (transaction stream 匯出等)
+struct TransactionRecord {
+    uint64_t start_time_ps = 0;
+    uint64_t end_time_ps = 0;   // 完成 (PREADY=1) 的 PCLK 上升緣
+    uint32_t paddr = 0;
+    uint32_t pwdata = 0;        // 讀取時為 0
+    uint32_t prdata = 0;        // 寫入時為 0
+    uint32_t wait_cycles = 0;   // ACCESS 之後等待 PREADY 的 cycle 數
+    uint32_t flags = 0;         // TransactionFlag (不含 TXN_ACTIVE) 與 PSTRB / PPROT
+    CompleterID completer = CompleterID::NONE;
+
+    bool is_write() const { return (flags & TXN_WRITE) != 0; }
+};
+
+// SignalState::flags 的位元: 最低 6 位元是 FSM 轉移表的索引 (PSEL/PENABLE/PREADY 與其 X 旗標),
+// 其餘為其他 1-bit 訊號的值與 bus 的 X/Z 旗標, 最高的 16 位元是 PSTRB / PPROT
+enum SignalStateFlag : uint32_t {
+    STATE_PSEL = 1u << 0,
+    STATE_PENABLE = 1u << 1,
+    STATE_PREADY = 1u << 2,
+    STATE_PSEL_X = 1u << 3,
+    STATE_PENABLE_X = 1u << 4,
+    STATE_PREADY_X = 1u << 5,
+    STATE_PCLK = 1u << 6,
+    STATE_PRESETN = 1u << 7,
+    STATE_PWRITE = 1u << 8,
+    STATE_PWRITE_X = 1u << 9,
+    STATE_PADDR_X = 1u << 10,
+    STATE_PWDATA_X = 1u << 11,
+    STATE_PRDATA_X = 1u << 12,
+    STATE_PSLVERR = 1u << 13,
+    STATE_PSLVERR_X = 1u << 14,
+    STATE_PSTRB_X = 1u << 15
+};
+const uint32_t STATE_FSM_CONTROL_MASK = 0x3F;
+enum SignalValueIndex { VALUE_PADDR,
+                        VALUE_PWDATA,
+                        VALUE_PRDATA,
+                        VALUE_COUNT };
 struct SignalState {
     uint64_t timestamp = 0;
-    bool pclk = false;
-    bool presetn = true;
-    uint32_t paddr = 0;
-    bool paddr_has_x = false;
-    bool pwrite = false;
-    bool pwrite_has_x = false;
-    bool psel = false;
-    bool psel_has_x = false;
-    bool penable = false;
-    bool penable_has_x = false;
-    uint32_t pwdata = 0;
-    bool pwdata_has_x = false;
-    uint32_t prdata = 0;
-    bool prdata_has_x = false;
-    bool pready = false;
-    bool pready_has_x = false;
-    SignalState() {}
+    uint32_t values[VALUE_COUNT];
+    // 沒有 PSTRB 訊號 (APB3) 時所有 byte lane 都視為有效
+    uint32_t flags = STATE_PRESETN | APB4_PSTRB_MASK;
+    SignalState() : values{0, 0, 0} {}
+
+    bool test(uint32_t mask) const { return (flags & mask) != 0; }
+    // mask 中的位元恰好等於 expected (例如 PSEL=1 且 PSEL_X=0)
+    bool match(uint32_t mask, uint32_t expected) const { return (flags & mask) == expected; }
+    void set(uint32_t mask, bool on) { flags = on ? (flags | mask) : (flags & ~mask); }
+    uint32_t paddr() const { return values[VALUE_PADDR]; }
+    uint32_t pwdata() const { return values[VALUE_PWDATA]; }
+    uint32_t prdata() const { return values[VALUE_PRDATA]; }
+    bool presetn() const { return test(STATE_PRESETN); }
+    bool paddr_has_x() const { return test(STATE_PADDR_X); }
+    bool pwdata_has_x() const { return test(STATE_PWDATA_X); }
+    bool prdata_has_x() const { return test(STATE_PRDATA_X); }
+    uint32_t pstrb() const { return (flags & APB4_PSTRB_MASK) >> APB4_PSTRB_SHIFT; }
+    uint32_t pprot() const { return (flags & APB4_PPROT_MASK) >> APB4_PPROT_SHIFT; }
 };
 enum class VcdSignalPhysicalType { PCLK,
                                    PRESETN,
@@ -81,6 +159,9 @@ enum class VcdSignalPhysicalType { PCLK,
                                    PWDATA,
                                    PRDATA,
                                    PREADY,
+                                   PSTRB,
+                                   PPROT,
+                                   PSLVERR,
                                    PARAMETER,
                                    OTHER };
 struct VcdSignalInfo {
@@ -91,28 +172,80 @@ struct VcdSignalInfo {
 
 // --- 位元狀態與錯誤結構 ---
 enum class BitConnectionStatus { CORRECT,
-                                 SHORTED };
+                                 SHORTED,
+                                 STUCK_AT_0,
+                                 STUCK_AT_1 };
 
 struct BitDetailStatus {
     BitConnectionStatus status = BitConnectionStatus::CORRECT;
     int shorted_with_bit_index = -1;
 };
 
+using BitPairMatrix = ArenaVector<ArenaVector<std::array<int, 4>>>;
+
+// 一條 bus 的短路 / stuck-at 判定進度. 一組 pair 只要出現過 01 或 10 就不可能是短路,
+// 增量模式下只更新還沒有這個證據的 pair
+struct PairVerdictTracker {
+    ArenaVector<uint32_t> undecided;  // undecided[i] 的第 j 位元: (i, j) 還可能是短路
+    uint32_t undecided_rows = 0;      // undecided[i] 不為 0 的列
+    uint32_t width_mask = 0;
+    uint32_t seen_ones = 0;
+    uint32_t seen_zeros = 0;
+    uint64_t samples = 0;
+    bool incremental = false;
+    explicit PairVerdictTracker(const ArenaAllocator<char>& alloc = ArenaAllocator<char>()) : undecided(alloc) {}
+    // tracked_width: 需要追蹤 pair 的低位元數; 超過 32 bit 的 bus 只能用完整計數
+    void reset(int tracked_width, int width, bool incremental_mode) {
+        incremental = incremental_mode && width <= 32;
+        width_mask = width >= 32 ? 0xFFFFFFFFu : (1u << width) - 1;
+        seen_ones = seen_zeros = 0;
+        samples = 0;
+        tracked_width = std::min(tracked_width, 32);
+        const uint32_t tracked_mask = tracked_width >= 32 ? 0xFFFFFFFFu : (1u << tracked_width) - 1;
+        undecided.assign(tracked_width, 0);
+        undecided_rows = 0;
+        for (int i = 0; i < tracked_width; ++i) {
+            undecided[i] = tracked_mask & ~((2u << i) - 1);
+            if (undecided[i])
+                undecided_rows |= 1u << i;
+        }
+    }
+    void observe(uint32_t value) {
+        seen_ones |= value & width_mask;
+        seen_zeros |= ~value & width_mask;
+        samples++;
+    }
+};
+
 struct CompleterBitActivity {
-    std::vector<std::vector<std::array<int, 4>>> paddr_combinations;
-    std::vector<std::vector<std::array<int, 4>>> pwdata_combinations;
-    std::vector<BitDetailStatus> paddr_bit_details;
-    std::vector<BitDetailStatus> pwdata_bit_details;
-    void resize(int paddr_width, int pwdata_width) {
+    BitPairMatrix paddr_combinations;
+    BitPairMatrix pwdata_combinations;
+    ArenaVector<BitDetailStatus> paddr_bit_details;
+    ArenaVector<BitDetailStatus> pwdata_bit_details;
+    PairVerdictTracker paddr_tracker;
+    PairVerdictTracker pwdata_tracker;
+    explicit CompleterBitActivity(const ArenaAllocator<char>& alloc = ArenaAllocator<char>())
+        : paddr_combinations(alloc), pwdata_combinations(alloc), paddr_bit_details(alloc), pwdata_bit_details(alloc), paddr_tracker(alloc), pwdata_tracker(alloc) {}
+    void resize(int paddr_width, int pwdata_width, bool incremental) {
         if (paddr_bit_details.size() != paddr_width) {
-            paddr_combinations.assign(paddr_width, std::vector<std::array<int, 4>>(paddr_width, {0, 0, 0, 0}));
+            assign_matrix(paddr_combinations, paddr_width);
             paddr_bit_details.assign(paddr_width, BitDetailStatus());
+            // a12 以上在同一個 completer 內固定不變, 不可能成為短路候選
+            paddr_tracker.reset(std::min(paddr_width, PADDR_OFFSET_BITS), paddr_width, incremental);
         }
         if (pwdata_bit_details.size() != pwdata_width) {
-            pwdata_combinations.assign(pwdata_width, std::vector<std::array<int, 4>>(pwdata_width, {0, 0, 0, 0}));
+            assign_matrix(pwdata_combinations, pwdata_width);
             pwdata_bit_details.assign(pwdata_width, BitDetailStatus());
+            pwdata_tracker.reset(pwdata_width, pwdata_width, incremental);
         }
     }
+    // 每一列都用同一個 arena
+    static void assign_matrix(BitPairMatrix& m, int width) {
+        m.clear();
+        m.reserve(width);
+        for (int i = 0; i < width; ++i)
+            m.emplace_back(width, std::array<int, 4>{{0, 0, 0, 0}}, m.get_allocator());
+    }
 };
 
 struct OutOfRangeAccessDetail {
@@ -130,6 +263,22 @@ struct ReverseWriteInfo {
     uint32_t address;
     uint64_t timestamp;
 };
+// APB 協定違規 (不影響主報告, 另外輸出)
+enum class ProtocolViolationKind : uint8_t { NONE,
+                                             PENABLE_IN_IDLE,
+                                             SETUP_ABORTED,
+                                             SETUP_NOT_FOLLOWED_BY_ACCESS,
+                                             PSEL_DROPPED_IN_ACCESS,
+                                             PENABLE_DROPPED_IN_ACCESS,
+                                             CONTROL_X_IN_TRANSFER,
+                                             PADDR_CHANGED_IN_TRANSFER,
+                                             PWRITE_CHANGED_IN_TRANSFER,
+                                             COUNT };
+struct ProtocolViolationDetail {
+    uint64_t timestamp;
+    uint32_t paddr;
+    ProtocolViolationKind kind;
+};
 struct TransactionTimeoutDetail {
     uint64_t start_timestamp;
     uint32_t paddr;
@@ -0,0 +1,134 @@
+// checkpoint.cpp
+#include "checkpoint.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include "apb_analyzer.hpp"
+#include "statistics.hpp"
+
+namespace APBSystem {
+
+namespace {
+const uint32_t CHECKPOINT_MAGIC = 0x4B435041;  // "APCK"
+const uint32_t CHECKPOINT_VERSION = 9;
+const uint64_t PREFIX_HASH_BLOCK = 64 * 1024;
+
+void hash_file_range(std::ifstream& in, uint64_t begin, uint64_t end, uint64_t& hash) {
+    std::vector<char> buf(static_cast<size_t>(end - begin));
+    in.clear();
+    in.seekg(static_cast<std::streamoff>(begin));
+    in.read(buf.data(), buf.size());
+    for (std::streamsize i = 0; i < in.gcount(); ++i) {
+        hash ^= static_cast<unsigned char>(buf[i]);
+        hash *= 1099511628211ULL;
+    }
+}
+}  // namespace
+
+void write_signal_state(CheckpointWriter& w, const SignalState& s) {
+    w.write_pod(s.timestamp);
+    for (int i = 0; i < VALUE_COUNT; ++i)
+        w.write_pod(s.values[i]);
+    w.write_pod(s.flags);
+}
+
+bool read_signal_state(CheckpointReader& r, SignalState& s) {
+    return r.read_pod(s.timestamp) && r.read_pod(s.values[VALUE_PADDR]) &&
+           r.read_pod(s.values[VALUE_PWDATA]) && r.read_pod(s.values[VALUE_PRDATA]) &&
+           r.read_pod(s.flags);
+}
+
+void write_transaction_info(CheckpointWriter& w, const TransactionInfo& t) {
+    w.write_pod(t.start_pclk_edge_count);
+    w.write_pod(t.transaction_start_time_ps);
+    w.write_pod(t.paddr);
+    w.write_pod(t.pwdata_val);
+    w.write_pod(t.flags);
+    w.write_pod(t.target_completer);
+}
+
+bool read_transaction_info(CheckpointReader& r, TransactionInfo& t) {
+    return r.read_pod(t.start_pclk_edge_count) && r.read_pod(t.transaction_start_time_ps) &&
+           r.read_pod(t.paddr) && r.read_pod(t.pwdata_val) &&
+           r.read_pod(t.flags) && r.read_enum(t.target_completer, CompleterID::NONE);
+}
+
+uint64_t compute_vcd_prefix_hash(const std::string& vcd_path, uint64_t length) {
+    std::ifstream in(vcd_path, std::ios::binary);
+    uint64_t hash = 1469598103934665603ULL;
+    if (!in.is_open())
+        return hash;
+    // 開頭 (標頭) 與 resume 位置之前的最後一段; 同樣標頭重新產生的 VCD 通常在後段就不同
+    const uint64_t head_end = std::min(length, PREFIX_HASH_BLOCK);
+    hash_file_range(in, 0, head_end, hash);
+    hash_file_range(in, std::max(head_end, length > PREFIX_HASH_BLOCK ? length - PREFIX_HASH_BLOCK : 0), length, hash);
+    return hash;
+}
+
+bool save_checkpoint_file(const std::string& path,
+                          const PipelineCheckpointState& pipeline,
+                          const ApbAnalyzer& analyzer,
+                          const Statistics& statistics) {
+    // 先寫入暫存檔再 rename, 避免中途失敗留下損毀的 checkpoint
+    const std::string tmp_path = path + ".tmp";
+    std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not open checkpoint file: " << tmp_path << std::endl;
+        return false;
+    }
+    CheckpointWriter w(out);
+    w.write_pod(CHECKPOINT_MAGIC);
+    w.write_pod(CHECKPOINT_VERSION);
+    w.write_pod(pipeline.parser_byte_offset);
+    w.write_pod(pipeline.vcd_prefix_hash);
+    write_signal_state(w, pipeline.signal_state);
+    w.write_pod(pipeline.previous_pclk);
+    w.write_pod(pipeline.pclk_rising_edge_count);
+    w.write_pod(pipeline.last_timestamp);
+    analyzer.save_state(w);
+    statistics.save_state(w);
+    out.close();
+    if (!out) {
+        std::cerr << "Error: Failed to write checkpoint file: " << tmp_path << std::endl;
+        return false;
+    }
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::cerr << "Error: Could not rename checkpoint file to: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool load_checkpoint_file(const std::string& path,
+                          PipelineCheckpointState& pipeline,
+                          ApbAnalyzer& analyzer,
+                          Statistics& statistics) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        std::cerr << "Error: Could not open checkpoint file: " << path << std::endl;
+        return false;
+    }
+    CheckpointReader r(in);
+    uint32_t magic = 0, version = 0;
+    if (!r.read_pod(magic) || !r.read_pod(version) || magic != CHECKPOINT_MAGIC || version != CHECKPOINT_VERSION) {
+        std::cerr << "Error: Unsupported checkpoint format: " << path << std::endl;
+        return false;
+    }
+    bool ok = r.read_pod(pipeline.parser_byte_offset) &&
+              r.read_pod(pipeline.vcd_prefix_hash) &&
+              read_signal_state(r, pipeline.signal_state) &&
+              r.read_bool(pipeline.previous_pclk) &&
+              r.read_pod(pipeline.pclk_rising_edge_count) &&
+              r.read_pod(pipeline.last_timestamp) &&
+              analyzer.load_state(r) &&
+              statistics.load_state(r);
+    if (!ok) {
+        std::cerr << "Error: Truncated or corrupted checkpoint file: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+}  // namespace APBSystem
@@ -0,0 +1,150 @@
+// checkpoint.hpp
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include "apb_types.hpp"
+
+namespace APBSystem {
+
+class ApbAnalyzer;
+class Statistics;
+
+// --- 二進位序列化工具 ---
+// 以本機位元組序寫入, checkpoint 只保證在同一平台/同一版本的程式間可還原
+class CheckpointWriter {
+   public:
+    explicit CheckpointWriter(std::ostream& out) : m_out(out) {}
+
+    template <typename T>
+    void write_pod(const T& value) {
+        m_out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+    template <typename Container>
+    void write_pod_vector(const Container& values) {
+        write_pod<uint64_t>(values.size());
+        for (const auto& v : values)
+            write_pod(v);
+    }
+    void write_string(const std::string& s) {
+        write_pod<uint64_t>(s.size());
+        m_out.write(s.data(), s.size());
+    }
+    bool good() const { return m_out.good(); }
+
+   private:
+    std::ostream& m_out;
+};
+
+class CheckpointReader {
+   public:
+    // 可 seek 的串流 (檔案與字串) 先算出剩餘長度, 檔案中的元素數量超過它就是損毀,
+    // 不能拿來配置記憶體
+    explicit CheckpointReader(std::istream& in) : m_in(in) {
+        const std::istream::pos_type start = m_in.tellg();
+        if (start != std::istream::pos_type(-1) && m_in.seekg(0, std::ios::end)) {
+            const std::istream::pos_type end = m_in.tellg();
+            m_in.seekg(start);
+            if (end != std::istream::pos_type(-1) && end >= start)
+                m_remaining = static_cast<uint64_t>(end - start);
+        }
+        m_in.clear();
+    }
+
+    template <typename T>
+    bool read_pod(T& value) {
+        m_in.read(reinterpret_cast<char*>(&value), sizeof(T));
+        if (!m_in.good())
+            return false;
+        m_remaining -= std::min<uint64_t>(m_remaining, sizeof(T));
+        return true;
+    }
+    // 以 1 byte 寫入的 bool 只能是 0 或 1
+    bool read_bool(bool& value) {
+        uint8_t raw = 0;
+        if (!read_pod(raw) || raw > 1)
+            return false;
+        value = raw != 0;
+        return true;
+    }
+    // 列舉值必須在 [0, last]
+    template <typename E>
+    bool read_enum(E& value, E last) {
+        typename std::underlying_type<E>::type raw;
+        // 負值轉成 uint64_t 之後一定大於 last
+        if (!read_pod(raw) || static_cast<uint64_t>(raw) > static_cast<uint64_t>(last))
+            return false;
+        value = static_cast<E>(raw);
+        return true;
+    }
+    // count 個至少 element_size bytes 的元素是否還放得下
+    bool fits(uint64_t count, uint64_t element_size) const {
+        return count <= m_remaining / element_size;
+    }
+    template <typename Container>
+    bool read_pod_vector(Container& values) {
+        uint64_t n = 0;
+        if (!read_pod(n) || !fits(n, sizeof(typename Container::value_type)))
+            return false;
+        values.clear();
+        for (uint64_t i = 0; i < n; ++i) {
+            typename Container::value_type v;
+            if (!read_pod(v))
+                return false;
+            values.push_back(v);
+        }
+        return true;
+    }
+    bool read_string(std::string& s) {
+        uint64_t n = 0;
+        if (!read_pod(n) || !fits(n, 1))
+            return false;
+        s.resize(n);
+        if (n > 0)
+            m_in.read(&s[0], n);
+        if (!m_in.good())
+            return false;
+        m_remaining -= n;
+        return true;
+    }
+    bool good() const { return m_in.good(); }
+
+   private:
+    std::istream& m_in;
+    uint64_t m_remaining = UINT64_MAX;  // 無法 seek 的串流不限制
+};
+
+void write_signal_state(CheckpointWriter& w, const SignalState& s);
+bool read_signal_state(CheckpointReader& r, SignalState& s);
+// write_transaction_info 每筆寫入的位元組數
+const uint64_t TRANSACTION_INFO_BYTES = 2 * sizeof(uint64_t) + 3 * sizeof(uint32_t) + sizeof(CompleterID);
+void write_transaction_info(CheckpointWriter& w, const TransactionInfo& t);
+bool read_transaction_info(CheckpointReader& r, TransactionInfo& t);
+
+// --- 整條 pipeline 的 checkpoint (VCD 讀取位置 + 分析狀態) ---
+struct PipelineCheckpointState {
+    uint64_t parser_byte_offset = 0;   // 已完整處理的 VCD 位元組數
+    uint64_t vcd_prefix_hash = 0;      // 用來確認 resume 時是同一份 (被附加的) VCD
+    SignalState signal_state;
+    bool previous_pclk = false;
+    uint64_t pclk_rising_edge_count = 0;
+    uint64_t last_timestamp = 0;
+};
+
+// VCD 檔案前 length 位元組中開頭 64KB 與最後 64KB 的 FNV-1a hash (不讀整段, resume 不必重新讀過已分析的部分)
+uint64_t compute_vcd_prefix_hash(const std::string& vcd_path, uint64_t length);
+
+bool save_checkpoint_file(const std::string& path,
+                          const PipelineCheckpointState& pipeline,
+                          const ApbAnalyzer& analyzer,
+                          const Statistics& statistics);
+bool load_checkpoint_file(const std::string& path,
+                          PipelineCheckpointState& pipeline,
+                          ApbAnalyzer& analyzer,
+                          Statistics& statistics);
+
+}  // namespace APBSystem
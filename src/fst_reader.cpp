@@ -0,0 +1,683 @@
+// fst_reader.cpp
+#include "fst_reader.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include "lz4_block.hpp"
+#include "value_change_feed.hpp"
+
+namespace APBSystem {
+
+namespace {
+const char* const FST_VAR_TYPE_NAMES[FST_VT_MAX + 1] = {
+    "event", "integer", "parameter", "real", "parameter", "reg", "supply0", "supply1",
+    "time", "tri", "triand", "trior", "trireg", "tri0", "tri1", "wand",
+    "wire", "wor", "port", "sparray", "realtime", "string", "bit", "logic",
+    "int", "shortint", "longint", "byte", "enum", "shortreal"};
+const uint8_t FST_VT_VCD_WIRE = 16;
+const uint8_t FST_VT_VCD_REAL = 3;
+// 1-bit 訊號非 0/1 值的編碼順序
+const char FST_SCALAR_CODES[] = "xzhuwl-?";
+
+inline uint64_t read_be64(const unsigned char* p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; ++i)
+        v = (v << 8) | p[i];
+    return v;
+}
+
+// 有邊界檢查的讀取游標; 任何越界都讓 ok 變成 false, 之後的讀取一律回傳 0
+struct ByteCursor {
+    const unsigned char* p;
+    const unsigned char* end;
+    bool ok;
+
+    ByteCursor(const unsigned char* begin, const unsigned char* limit) : p(begin), end(limit), ok(begin <= limit) {}
+    uint64_t varint() {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (p >= end) {
+                ok = false;
+                return 0;
+            }
+            unsigned char b = *p++;
+            v |= static_cast<uint64_t>(b & 0x7F) << shift;
+            if (!(b & 0x80))
+                return v;
+        }
+        ok = false;
+        return 0;
+    }
+    int64_t svarint() {
+        uint64_t v = 0;
+        int shift = 0;
+        unsigned char b = 0;
+        do {
+            if (p >= end || shift >= 64) {
+                ok = false;
+                return 0;
+            }
+            b = *p++;
+            v |= static_cast<uint64_t>(b & 0x7F) << shift;
+            shift += 7;
+        } while (b & 0x80);
+        if (shift < 64 && (b & 0x40))
+            v |= ~0ULL << shift;
+        return static_cast<int64_t>(v);
+    }
+    uint8_t byte() {
+        if (p >= end) {
+            ok = false;
+            return 0;
+        }
+        return *p++;
+    }
+    const char* cstring() {
+        const unsigned char* nul = static_cast<const unsigned char*>(std::memchr(p, 0, end - p));
+        if (nul == nullptr) {
+            ok = false;
+            p = end;
+            return "";
+        }
+        const char* s = reinterpret_cast<const char*>(p);
+        p = nul + 1;
+        return s;
+    }
+    bool skip(uint64_t n) {
+        if (n > static_cast<uint64_t>(end - p)) {
+            ok = false;
+            return false;
+        }
+        p += n;
+        return true;
+    }
+};
+
+bool zlib_uncompress(const unsigned char* src, uint64_t src_len, uint64_t dst_len, std::vector<unsigned char>& dst) {
+    dst.resize(static_cast<std::size_t>(dst_len));
+    uLongf out_len = static_cast<uLongf>(dst_len);
+    return uncompress(dst.data(), &out_len, src, static_cast<uLong>(src_len)) == Z_OK && out_len == dst_len;
+}
+
+// hierarchy block 是完整的 gzip 串流 (gzip header + deflate)
+bool gzip_uncompress(const unsigned char* src, uint64_t src_len, uint64_t dst_len, std::vector<unsigned char>& dst) {
+    dst.resize(static_cast<std::size_t>(dst_len));
+    z_stream zs;
+    std::memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, 15 + 32) != Z_OK)
+        return false;
+    zs.next_in = const_cast<unsigned char*>(src);
+    zs.avail_in = static_cast<uInt>(src_len);
+    zs.next_out = dst.data();
+    zs.avail_out = static_cast<uInt>(dst_len);
+    int rc = inflate(&zs, Z_FINISH);
+    bool ok = (rc == Z_STREAM_END || rc == Z_OK) && zs.total_out == dst_len;
+    inflateEnd(&zs);
+    return ok;
+}
+
+// 低 32 bit 與 X 遮罩; 寬度超過 32 時只保留最後 32 個位元 (與 VCD 路徑相同)
+inline void decode_packed_bits(const unsigned char* bytes, uint32_t width, uint32_t& value, uint32_t& xmask) {
+    uint64_t acc = 0;
+    const uint32_t byte_count = (width + 7) / 8;
+    for (uint32_t i = 0; i < byte_count; ++i)
+        acc = (acc << 8) | bytes[i];
+    value = static_cast<uint32_t>(acc >> ((8 - (width & 7)) & 7));
+    xmask = 0;
+}
+// 走訪一個 handle 的波形資料, 對每個變化呼叫 sink(time_index, value, xmask)
+// DecodeValues 為 false 時只解出時間 (計數用), 不解碼值
+template <bool DecodeValues, typename Sink>
+bool walk_wave(const unsigned char* data, uint64_t length, uint32_t width, uint64_t time_count, Sink sink) {
+    ByteCursor c(data, data + length);
+    uint64_t time_index = 0;
+    uint32_t value = 0, xmask = 0;
+    while (c.p < c.end) {
+        uint64_t v = c.varint();
+        if (width == 1) {
+            if (!(v & 1)) {
+                time_index += v >> 2;
+                value = (v >> 1) & 1;
+                xmask = 0;
+            } else {
+                time_index += v >> 4;
+                if (DecodeValues)
+                    decode_vcd_value(&FST_SCALAR_CODES[(v >> 1) & 7], 1, value, xmask);
+            }
+        } else {
+            time_index += v >> 1;
+            const unsigned char* payload = c.p;
+            if (v & 1) {
+                if (!c.skip(width))
+                    return false;
+                if (DecodeValues)
+                    decode_vcd_value(reinterpret_cast<const char*>(payload), width, value, xmask);
+            } else {
+                if (!c.skip((width + 7) / 8))
+                    return false;
+                if (DecodeValues)
+                    decode_packed_bits(payload, width, value, xmask);
+            }
+        }
+        if (!c.ok || time_index >= time_count)
+            return false;
+        sink(time_index, value, xmask);
+    }
+    return true;
+}
+}  // namespace
+
+const char* fst_var_type_name(uint8_t var_type) {
+    return var_type <= FST_VT_MAX ? FST_VAR_TYPE_NAMES[var_type] : nullptr;
+}
+
+uint8_t fst_var_type_from_name(const std::string& vcd_type) {
+    for (uint8_t t = 0; t <= FST_VT_MAX; ++t) {
+        // real_parameter 與 parameter 共用名稱, 以前面的 parameter 為準
+        if (vcd_type == FST_VAR_TYPE_NAMES[t])
+            return t;
+    }
+    return FST_VT_VCD_WIRE;
+}
+
+// 一個 value change block 解碼後的結果; 依時間排序, 同一時間內依 handle 排序
+// 在多個 window 之間重複使用, 避免每個 block 重新配置 (與 page fault) 大陣列
+struct FstReader::BlockResult {
+    bool ok = false;
+    std::vector<uint64_t> times;
+    std::vector<FstValueChange> frame;      // 只有第一個 block 會填
+    std::vector<uint32_t> step_end;         // 第 t 個時間點在 changes 中的結尾
+    std::vector<FstValueChange> changes;
+    std::vector<std::vector<unsigned char>> wave_buffers;  // 解壓縮後的波形資料
+};
+
+FstReader::FstReader() : m_threads(1), m_block_count(0), m_decoded_change_count(0) {}
+
+bool FstReader::is_fst_file(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+        return false;
+    unsigned char head[9];
+    ssize_t n = ::read(fd, head, sizeof(head));
+    close(fd);
+    if (n != static_cast<ssize_t>(sizeof(head)))
+        return false;
+    return (head[0] == FST_BL_HDR && read_be64(head + 1) == FST_HDR_SECTION_BYTES) || head[0] == FST_BL_ZWRAPPER;
+}
+
+bool FstReader::read_file(const std::string& path,
+                          SignalCallback on_signal,
+                          EndDefinitionsCallback on_end_definitions,
+                          TimeStepCallback on_time_step) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        std::cerr << "Error: cannot open " << path << "\n";
+        return false;
+    }
+    struct stat sb{};
+    if (fstat(fd, &sb) == -1 || sb.st_size < 9) {
+        close(fd);
+        std::cerr << "Error: " << path << " is not an FST file" << std::endl;
+        return false;
+    }
+    const std::size_t size = sb.st_size;
+    unsigned char* file = static_cast<unsigned char*>(mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0));
+    close(fd);
+    if (file == MAP_FAILED)
+        return false;
+    bool ok;
+    if (file[0] == FST_BL_ZWRAPPER) {
+        // 整個檔案被 gzip 包起來 (fstapi 的 compress 選項): 先解壓縮到記憶體
+        uint64_t section_length = read_be64(file + 1);
+        std::vector<unsigned char> image;
+        ok = section_length >= 16 && section_length + 1 <= size &&
+             gzip_uncompress(file + 17, section_length - 16, read_be64(file + 9), image) &&
+             read_image(image.data(), image.size(), on_signal, on_end_definitions, on_time_step);
+    } else {
+        ok = read_image(file, size, on_signal, on_end_definitions, on_time_step);
+    }
+    munmap(file, size);
+    return ok;
+}
+
+bool FstReader::read_image(const unsigned char* data,
+                           std::size_t size,
+                           SignalCallback& on_signal,
+                           EndDefinitionsCallback& on_end_definitions,
+                           TimeStepCallback& on_time_step) {
+    struct BlockRef {
+        uint8_t type;
+        const unsigned char* section;  // 指向 section length 欄位
+        uint64_t length;
+    };
+    std::vector<BlockRef> value_blocks;
+    const unsigned char* geometry = nullptr;
+    uint64_t geometry_length = 0, geometry_handles = 0;
+    std::vector<BlockRef> hierarchy_blocks;
+
+    // 第一輪只看 block 的類型與長度, 不解壓縮任何東西
+    std::size_t pos = 0;
+    while (pos + 9 <= size) {
+        uint8_t type = data[pos];
+        uint64_t length = read_be64(data + pos + 1);
+        if (length < 8 || length > size - pos - 1) {
+            // 寫入中斷的檔案最後一個 block 可能不完整, 之前的 block 仍然有效
+            std::cerr << "Warning: FST block at offset " << pos << " is truncated; ignoring the rest of the file" << std::endl;
+            break;
+        }
+        BlockRef ref = {type, data + pos + 1, length};
+        switch (type) {
+            case FST_BL_HDR:
+                if (pos != 0 || length != FST_HDR_SECTION_BYTES) {
+                    std::cerr << "Error: Unexpected FST header block" << std::endl;
+                    return false;
+                }
+                break;
+            case FST_BL_VCDATA:
+            case FST_BL_VCDATA_DYN_ALIAS:
+            case FST_BL_VCDATA_DYN_ALIAS2:
+                value_blocks.push_back(ref);
+                break;
+            case FST_BL_GEOM:
+                // 訊號數量增加時會有多個 geometry block, 以涵蓋最多 handle 的為準
+                if (length >= 24 && read_be64(ref.section + 16) >= geometry_handles) {
+                    geometry = ref.section;
+                    geometry_length = length;
+                    geometry_handles = read_be64(ref.section + 16);
+                }
+                break;
+            case FST_BL_HIER:
+            case FST_BL_HIER_LZ4:
+            case FST_BL_HIER_LZ4DUO:
+                hierarchy_blocks.push_back(ref);
+                break;
+            default:
+                break;  // blackout / skip
+        }
+        pos += 1 + length;
+    }
+    if (size < 9 || data[0] != FST_BL_HDR) {
+        std::cerr << "Error: Missing FST header block" << std::endl;
+        return false;
+    }
+    if (geometry == nullptr || hierarchy_blocks.empty()) {
+        std::cerr << "Error: FST file has no geometry or hierarchy block" << std::endl;
+        return false;
+    }
+    if (!read_geometry(geometry, geometry_length))
+        return false;
+    for (const BlockRef& ref : hierarchy_blocks) {
+        if (!read_hierarchy(ref.section, ref.length, ref.type, on_signal))
+            return false;
+    }
+    if (on_end_definitions)
+        on_end_definitions();
+
+    m_wanted_handles.clear();
+    for (uint32_t h = 0; h < m_wanted.size(); ++h) {
+        if (m_wanted[h])
+            m_wanted_handles.push_back(h);
+    }
+
+    // 一次解碼 threads * 2 個 block, 依檔案順序送出; 限制同時存在於記憶體中的結果數量
+    const std::size_t window = std::max<std::size_t>(1, m_threads * 2);
+    std::vector<BlockResult> results(std::min(window, value_blocks.size()));
+    uint64_t last_time = 0;
+    bool have_time = false;
+    for (std::size_t first = 0; first < value_blocks.size(); first += window) {
+        const std::size_t count = std::min(window, value_blocks.size() - first);
+        auto decode_at = [&](std::size_t i) {
+            const BlockRef& ref = value_blocks[first + i];
+            results[i].ok = false;
+            results[i].frame.clear();
+            results[i].ok = decode_block(ref.section, ref.length, ref.type, first + i == 0, results[i]);
+        };
+        const unsigned worker_count = static_cast<unsigned>(std::min<std::size_t>(m_threads, count));
+        if (worker_count <= 1) {
+            for (std::size_t i = 0; i < count; ++i)
+                decode_at(i);
+        } else {
+            std::atomic<std::size_t> next(0);
+            std::vector<std::thread> workers;
+            for (unsigned t = 0; t < worker_count; ++t) {
+                workers.emplace_back([&]() {
+                    for (std::size_t i = next++; i < count; i = next++)
+                        decode_at(i);
+                });
+            }
+            for (auto& w : workers)
+                w.join();
+        }
+        for (std::size_t i = 0; i < count; ++i) {
+            const BlockResult& r = results[i];
+            if (!r.ok) {
+                std::cerr << "Error: Corrupt FST value change block " << (first + i) << std::endl;
+                return false;
+            }
+            if (!r.frame.empty())
+                on_time_step(0, r.frame.data(), r.frame.size());
+            uint32_t begin = 0;
+            for (std::size_t t = 0; t < r.times.size(); ++t) {
+                const uint32_t end = r.step_end[t];
+                if (end > begin)
+                    on_time_step(r.times[t], r.changes.data() + begin, end - begin);
+                begin = end;
+            }
+            if (!r.times.empty()) {
+                last_time = r.times.back();
+                have_time = true;
+            }
+            m_decoded_change_count += r.changes.size() + r.frame.size();
+        }
+        m_block_count += count;
+    }
+    // 讓分析看到檔案的結束時間 (之後沒有 APB 變化的 timestamp 也算在內)
+    if (have_time)
+        on_time_step(last_time, nullptr, 0);
+    return true;
+}
+
+bool FstReader::read_geometry(const unsigned char* block, uint64_t section_length) {
+    const uint64_t uncompressed_length = read_be64(block + 8);
+    const uint64_t max_handle = read_be64(block + 16);
+    const uint64_t compressed_length = section_length - 24;
+    std::vector<unsigned char> buffer;
+    const unsigned char* table = block + 24;
+    if (compressed_length != uncompressed_length) {
+        if (!zlib_uncompress(table, compressed_length, uncompressed_length, buffer)) {
+            std::cerr << "Error: Corrupt FST geometry block" << std::endl;
+            return false;
+        }
+        table = buffer.data();
+    }
+    ByteCursor c(table, table + uncompressed_length);
+    m_signal_widths.assign(static_cast<std::size_t>(max_handle), 0);
+    m_is_real.assign(static_cast<std::size_t>(max_handle), false);
+    m_frame_offsets.assign(static_cast<std::size_t>(max_handle) + 1, 0);
+    for (uint64_t h = 0; h < max_handle; ++h) {
+        uint64_t v = c.varint();
+        if (v == 0) {
+            m_signal_widths[h] = 8;
+            m_is_real[h] = true;
+        } else {
+            m_signal_widths[h] = v == 0xFFFFFFFFu ? 0 : static_cast<uint32_t>(v);
+        }
+        m_frame_offsets[h + 1] = m_frame_offsets[h] + m_signal_widths[h];
+    }
+    if (!c.ok) {
+        std::cerr << "Error: Corrupt FST geometry block" << std::endl;
+        return false;
+    }
+    m_wanted.assign(static_cast<std::size_t>(max_handle), false);
+    return true;
+}
+
+bool FstReader::read_hierarchy(const unsigned char* block, uint64_t section_length, uint8_t block_type, SignalCallback& on_signal) {
+    const uint64_t uncompressed_length = read_be64(block + 8);
+    std::vector<unsigned char> text;
+    bool ok;
+    if (block_type == FST_BL_HIER) {
+        ok = gzip_uncompress(block + 16, section_length - 16, uncompressed_length, text);
+    } else if (block_type == FST_BL_HIER_LZ4) {
+        ok = lz4_uncompress(block + 16, section_length - 16, uncompressed_length, text);
+    } else {
+        // LZ4DUO: 連續壓縮兩次, 中間長度以 varint 記錄
+        ByteCursor c(block + 16, block + section_length);
+        uint64_t once_length = c.varint();
+        std::vector<unsigned char> once;
+        ok = c.ok && lz4_uncompress(c.p, c.end - c.p, once_length, once) &&
+             lz4_uncompress(once.data(), once.size(), uncompressed_length, text);
+    }
+    if (!ok) {
+        std::cerr << "Error: Corrupt FST hierarchy block" << std::endl;
+        return false;
+    }
+
+    ByteCursor c(text.data(), text.data() + text.size());
+    std::vector<std::size_t> scope_lengths;  // path 在每一層 scope 之前的長度
+    std::string path;
+    uint32_t next_handle = 0;
+    while (c.ok && c.p < c.end) {
+        uint8_t tag = c.byte();
+        if (tag == FST_ST_VCD_SCOPE) {
+            c.byte();  // scope type
+            const char* name = c.cstring();
+            c.cstring();  // component
+            scope_lengths.push_back(path.size());
+            if (!path.empty())
+                path += '.';
+            path += name;
+        } else if (tag == FST_ST_VCD_UPSCOPE) {
+            if (!scope_lengths.empty()) {
+                path.resize(scope_lengths.back());
+                scope_lengths.pop_back();
+            }
+        } else if (tag == FST_ST_GEN_ATTRBEGIN) {
+            c.byte();
+            c.byte();
+            c.cstring();
+            c.varint();
+        } else if (tag == FST_ST_GEN_ATTREND) {
+        } else if (tag <= FST_VT_MAX) {
+            c.byte();  // direction
+            const char* name = c.cstring();
+            uint64_t width = c.varint();
+            uint64_t alias = c.varint();
+            uint64_t handle = alias == 0 ? ++next_handle : alias;
+            if (!c.ok || handle == 0 || handle > m_wanted.size()) {
+                std::cerr << "Error: FST variable " << name << " has an invalid handle" << std::endl;
+                return false;
+            }
+            const uint32_t index = static_cast<uint32_t>(handle - 1);
+            // alias (同一個 handle 的其他名稱) 只有在原本的名稱不是 APB 訊號時才需要回報
+            if (alias != 0 && m_wanted[index])
+                continue;
+            std::string full_name = path.empty() ? std::string(name) : path + '.' + name;
+            bool wanted = on_signal(index, fst_var_type_name(tag), static_cast<int>(width), full_name);
+            m_wanted[index] = wanted && !m_is_real[index] && tag != FST_VT_VCD_REAL && m_signal_widths[index] > 0;
+        } else {
+            std::cerr << "Error: Unknown FST hierarchy tag " << static_cast<int>(tag) << std::endl;
+            return false;
+        }
+    }
+    if (!c.ok) {
+        std::cerr << "Error: Corrupt FST hierarchy block" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool FstReader::decode_block(const unsigned char* block, uint64_t section_length, uint8_t block_type, bool with_frame, BlockResult& result) const {
+    const unsigned char* const end = block + section_length;
+    if (section_length < 32 + 24 + 8)
+        return false;
+    ByteCursor c(block + 32, end);  // section length, begin time, end time, traversal memory
+
+    // --- frame: block 開始時所有訊號的值 ---
+    const uint64_t frame_uncompressed = c.varint();
+    const uint64_t frame_compressed = c.varint();
+    const uint64_t frame_handles = c.varint();
+    const unsigned char* frame = c.p;
+    if (!c.skip(frame_compressed))
+        return false;
+    if (with_frame) {
+        std::vector<unsigned char> buffer;
+        if (frame_compressed != frame_uncompressed) {
+            if (!zlib_uncompress(frame, frame_compressed, frame_uncompressed, buffer))
+                return false;
+            frame = buffer.data();
+        }
+        for (uint32_t h : m_wanted_handles) {
+            if (h >= frame_handles || m_frame_offsets[h + 1] > frame_uncompressed)
+                break;
+            FstValueChange change = {h, 0, 0};
+            decode_vcd_value(reinterpret_cast<const char*>(frame + m_frame_offsets[h]), m_signal_widths[h], change.value, change.xmask);
+            result.frame.push_back(change);
+        }
+    }
+
+    const uint64_t vc_handles = c.varint();
+    const unsigned char* const vc_start = c.p;
+    const uint8_t pack_type = c.byte();
+    if (!c.ok)
+        return false;
+
+    // --- 時間表在 block 的最後 ---
+    const uint64_t time_uncompressed = read_be64(end - 24);
+    const uint64_t time_compressed = read_be64(end - 16);
+    const uint64_t time_count = read_be64(end - 8);
+    if (end - vc_start < 24 + 8 || time_compressed > static_cast<uint64_t>(end - 24 - 8 - vc_start))
+        return false;
+    const unsigned char* time_data = end - 24 - time_compressed;
+    std::vector<unsigned char> time_buffer;
+    if (time_compressed != time_uncompressed) {
+        if (!zlib_uncompress(time_data, time_compressed, time_uncompressed, time_buffer))
+            return false;
+        time_data = time_buffer.data();
+    }
+    ByteCursor tc(time_data, time_data + time_uncompressed);
+    result.times.resize(static_cast<std::size_t>(time_count));
+    uint64_t t = 0;
+    for (uint64_t i = 0; i < time_count; ++i) {
+        t += tc.varint();
+        result.times[i] = t;
+    }
+    if (!tc.ok)
+        return false;
+
+    // --- 每個 handle 的波形資料位置 (相對於 pack type byte) ---
+    const unsigned char* index_pointer = end - 24 - time_compressed - 8;
+    const uint64_t chain_length = read_be64(index_pointer);
+    if (chain_length > static_cast<uint64_t>(index_pointer - vc_start))
+        return false;
+    const unsigned char* chain = index_pointer - chain_length;
+    std::vector<uint64_t> positions(static_cast<std::size_t>(vc_handles) + 1, 0);
+    std::vector<int64_t> lengths(static_cast<std::size_t>(vc_handles) + 1, 0);
+    ByteCursor cc(chain, index_pointer);
+    std::size_t idx = 0;
+    uint64_t previous_position = 0;
+    int64_t previous_data_idx = -1;
+    int64_t previous_alias = 0;
+    while (cc.ok && cc.p < cc.end && idx < vc_handles) {
+        if (block_type == FST_BL_VCDATA_DYN_ALIAS2) {
+            if (*cc.p & 1) {
+                int64_t shifted = cc.svarint() >> 1;
+                if (shifted > 0) {
+                    previous_position += shifted;
+                    positions[idx] = previous_position;
+                    if (previous_data_idx >= 0)
+                        lengths[previous_data_idx] = previous_position - positions[previous_data_idx];
+                    previous_data_idx = idx++;
+                } else {
+                    // 與前一個 handle 的波形完全相同 (dynamic alias)
+                    if (shifted < 0)
+                        previous_alias = shifted;
+                    lengths[idx++] = previous_alias;
+                }
+            } else {
+                idx += cc.varint() >> 1;
+            }
+        } else {
+            uint64_t v = cc.varint();
+            if (v == 0 && block_type == FST_BL_VCDATA_DYN_ALIAS) {
+                lengths[idx++] = -static_cast<int64_t>(cc.varint());
+            } else if (v & 1) {
+                previous_position += v >> 1;
+                positions[idx] = previous_position;
+                if (previous_data_idx >= 0)
+                    lengths[previous_data_idx] = previous_position - positions[previous_data_idx];
+                previous_data_idx = idx++;
+            } else {
+                idx += v >> 1;
+            }
+        }
+    }
+    if (!cc.ok || idx > vc_handles)
+        return false;
+    if (previous_data_idx >= 0)
+        lengths[previous_data_idx] = static_cast<int64_t>(chain - vc_start) - static_cast<int64_t>(positions[previous_data_idx]);
+    for (std::size_t h = 0; h < vc_handles; ++h) {
+        if (lengths[h] < 0 && positions[h] == 0) {
+            uint64_t source = static_cast<uint64_t>(-lengths[h]) - 1;
+            if (source >= h)
+                return false;
+            positions[h] = positions[source];
+            lengths[h] = lengths[source];
+        }
+    }
+
+    // --- 只解壓縮需要的 handle; 兩輪走訪波形資料 (先計數再直接放到最終位置), 不需要中間的暫存陣列 ---
+    struct Wave {
+        uint32_t handle;
+        const unsigned char* data;
+        uint64_t length;
+    };
+    std::vector<Wave> waves;
+    std::size_t buffers_used = 0;
+    for (uint32_t h : m_wanted_handles) {
+        if (h >= vc_handles || positions[h] == 0 || lengths[h] <= 0)
+            continue;
+        if (positions[h] + static_cast<uint64_t>(lengths[h]) > static_cast<uint64_t>(chain - vc_start))
+            return false;
+        ByteCursor wc(vc_start + positions[h], vc_start + positions[h] + lengths[h]);
+        const uint64_t wave_uncompressed = wc.varint();
+        Wave wave = {h, wc.p, static_cast<uint64_t>(wc.end - wc.p)};
+        if (!wc.ok)
+            return false;
+        if (wave_uncompressed != 0) {
+            if (buffers_used == result.wave_buffers.size())
+                result.wave_buffers.emplace_back();
+            std::vector<unsigned char>& buffer = result.wave_buffers[buffers_used++];
+            bool ok;
+            if (pack_type == 'Z')
+                ok = zlib_uncompress(wave.data, wave.length, wave_uncompressed, buffer);
+            else if (pack_type == '4')
+                ok = lz4_uncompress(wave.data, wave.length, wave_uncompressed, buffer);
+            else
+                ok = false;  // FastLZ ('F') 沒有支援
+            if (!ok)
+                return false;
+            wave.data = buffer.data();
+            wave.length = wave_uncompressed;
+        }
+        waves.push_back(wave);
+    }
+
+    std::vector<uint32_t>& step_end = result.step_end;
+    step_end.assign(static_cast<std::size_t>(time_count) + 1, 0);
+    for (const Wave& w : waves) {
+        uint32_t* counts = step_end.data() + 1;
+        bool ok = walk_wave<false>(w.data, w.length, m_signal_widths[w.handle], time_count,
+                                   [counts](uint64_t time_index, uint32_t, uint32_t) { counts[time_index]++; });
+        if (!ok)
+            return false;
+    }
+    for (std::size_t i = 1; i < step_end.size(); ++i)
+        step_end[i] += step_end[i - 1];
+    const uint64_t total = step_end.back();
+    // handle 依遞增順序放入, 同一時間點內自然依 handle 排列; 放完之後 step_end[t] 變成第 t 個時間點的結尾
+    result.changes.resize(static_cast<std::size_t>(total));
+    FstValueChange* out = result.changes.data();
+    for (const Wave& w : waves) {
+        uint32_t* cursor = step_end.data();
+        const uint32_t handle = w.handle;
+        walk_wave<true>(w.data, w.length, m_signal_widths[handle], time_count,
+                        [cursor, out, handle](uint64_t time_index, uint32_t value, uint32_t xmask) {
+                            FstValueChange& change = out[cursor[time_index]++];
+                            change.signal_index = handle;
+                            change.value = value;
+                            change.xmask = xmask;
+                        });
+    }
+    step_end.pop_back();
+    return true;
+}
+
+}  // namespace APBSystem
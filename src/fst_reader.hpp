@@ -0,0 +1,87 @@
+// fst_reader.hpp
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace APBSystem {
+
+// --- GTKWave FST 格式常數 (與 fstapi 相同) ---
+enum FstBlockType : uint8_t {
+    FST_BL_HDR = 0,
+    FST_BL_VCDATA = 1,
+    FST_BL_BLACKOUT = 2,
+    FST_BL_GEOM = 3,
+    FST_BL_HIER = 4,
+    FST_BL_VCDATA_DYN_ALIAS = 5,
+    FST_BL_HIER_LZ4 = 6,
+    FST_BL_HIER_LZ4DUO = 7,
+    FST_BL_VCDATA_DYN_ALIAS2 = 8,
+    FST_BL_ZWRAPPER = 254,
+    FST_BL_SKIP = 255
+};
+enum FstHierarchyTag : uint8_t {
+    FST_ST_GEN_ATTRBEGIN = 252,
+    FST_ST_GEN_ATTREND = 253,
+    FST_ST_VCD_SCOPE = 254,
+    FST_ST_VCD_UPSCOPE = 255
+};
+const uint8_t FST_VT_MAX = 29;         // var type 0..29, 其他值是 scope / attribute 標記
+const uint64_t FST_HDR_SECTION_BYTES = 329;  // header block 的 section length (含長度欄位本身)
+const double FST_ENDIAN_TEST = 2.7182818284590452354;
+
+// FST var type 對應的 VCD 關鍵字 ("wire", "reg", "parameter" ...); 未知的類型回傳 nullptr
+const char* fst_var_type_name(uint8_t var_type);
+// 反向對應; 不認得的 VCD 類型當作 wire
+uint8_t fst_var_type_from_name(const std::string& vcd_type);
+
+// 一個 APB 訊號在某個時間點的新值 (已解碼成 uint32 + X 遮罩, 與二進位 feed 相同)
+struct FstValueChange {
+    uint32_t signal_index;  // FST handle - 1
+    uint32_t value;
+    uint32_t xmask;
+};
+
+// 讀取 FST: 先掃過所有 block 讀出階層與訊號寬度, 再多執行緒解壓縮 value change block
+// 只解碼 register callback 回傳 true 的訊號, 其他 handle 的波形資料完全不會被解壓縮
+class FstReader {
+   public:
+    // 回傳 true 表示需要這個訊號的 value change
+    using SignalCallback = std::function<bool(uint32_t signal_index, const std::string& type_str, int width, const std::string& hierarchical_name)>;
+    using EndDefinitionsCallback = std::function<void()>;
+    // 同一個時間點的所有變化 (FST 不保留同一時間點內的先後順序, 依 handle 排列)
+    // 第一個 block 的初始值 (frame) 以時間 0 送出; 最後會以檔案結束時間送出一個 count 為 0 的呼叫
+    using TimeStepCallback = std::function<void(uint64_t time, const FstValueChange* changes, std::size_t count)>;
+
+    FstReader();
+    void set_threads(unsigned threads) { m_threads = threads > 0 ? threads : 1; }
+
+    // 檔案開頭是否為 FST header block
+    static bool is_fst_file(const std::string& path);
+
+    bool read_file(const std::string& path, SignalCallback, EndDefinitionsCallback, TimeStepCallback);
+
+    uint64_t get_block_count() const { return m_block_count; }
+    uint64_t get_decoded_change_count() const { return m_decoded_change_count; }
+
+   private:
+    struct BlockResult;
+    bool read_image(const unsigned char* data, std::size_t size, SignalCallback&, EndDefinitionsCallback&, TimeStepCallback&);
+    bool read_geometry(const unsigned char* block, uint64_t section_length);
+    bool read_hierarchy(const unsigned char* block, uint64_t section_length, uint8_t block_type, SignalCallback& on_signal);
+    bool decode_block(const unsigned char* block, uint64_t section_length, uint8_t block_type, bool with_frame, BlockResult& result) const;
+
+    unsigned m_threads;
+    std::vector<uint32_t> m_signal_widths;   // 依 handle; real 訊號為 8 bytes
+    std::vector<uint64_t> m_frame_offsets;   // 每個 handle 在 frame 中的位置
+    std::vector<bool> m_is_real;
+    std::vector<uint32_t> m_wanted_handles;  // 需要解碼的 handle (0-based, 遞增)
+    std::vector<bool> m_wanted;
+    uint64_t m_block_count;
+    uint64_t m_decoded_change_count;
+};
+
+}  // namespace APBSystem
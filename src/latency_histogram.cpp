@@ -0,0 +1,110 @@
+// latency_histogram.cpp
+#include "latency_histogram.hpp"
+#include <algorithm>
+#include <cmath>
+#include "checkpoint.hpp"
+
+namespace APBSystem {
+
+LatencyHistogram::LatencyHistogram() {
+    clear();
+}
+
+void LatencyHistogram::clear() {
+    m_counts.fill(0);
+    m_total_count = 0;
+    m_min = UINT64_MAX;
+    m_max = 0;
+    m_sum = 0.0;
+}
+
+std::size_t LatencyHistogram::bucket_index(uint64_t value) {
+    if (value < 2 * SUB_BUCKET_COUNT)
+        return static_cast<std::size_t>(value);
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - SUB_BUCKET_BITS;
+    // (value >> shift) 落在 [SUB_BUCKET_COUNT, 2 * SUB_BUCKET_COUNT)
+    return static_cast<std::size_t>((shift + 1) * SUB_BUCKET_COUNT + ((value >> shift) - SUB_BUCKET_COUNT));
+}
+
+uint64_t LatencyHistogram::bucket_upper_bound(std::size_t index) {
+    if (index < 2 * SUB_BUCKET_COUNT)
+        return index;
+    uint64_t shift = index / SUB_BUCKET_COUNT - 1;
+    uint64_t sub = index % SUB_BUCKET_COUNT + SUB_BUCKET_COUNT;
+    return ((sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t value, uint64_t count) {
+    if (count == 0)
+        return;
+    m_counts[bucket_index(value)] += count;
+    m_total_count += count;
+    m_min = std::min(m_min, value);
+    m_max = std::max(m_max, value);
+    m_sum += static_cast<double>(value) * count;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    if (other.m_total_count == 0)
+        return;
+    for (std::size_t i = 0; i < BUCKET_COUNT; ++i)
+        m_counts[i] += other.m_counts[i];
+    m_total_count += other.m_total_count;
+    m_min = std::min(m_min, other.m_min);
+    m_max = std::max(m_max, other.m_max);
+    m_sum += other.m_sum;
+}
+
+double LatencyHistogram::get_mean() const {
+    return m_total_count == 0 ? 0.0 : m_sum / m_total_count;
+}
+
+uint64_t LatencyHistogram::value_at_quantile(double q) const {
+    if (m_total_count == 0)
+        return 0;
+    q = std::min(std::max(q, 0.0), 1.0);
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * m_total_count)));
+    uint64_t seen = 0;
+    for (std::size_t i = 0; i < BUCKET_COUNT; ++i) {
+        seen += m_counts[i];
+        if (seen >= rank)
+            return std::min(bucket_upper_bound(i), m_max);
+    }
+    return m_max;
+}
+
+void LatencyHistogram::save_state(CheckpointWriter& w) const {
+    // 只寫非零的 bucket
+    uint64_t used = 0;
+    for (uint64_t c : m_counts)
+        used += (c != 0);
+    w.write_pod(used);
+    for (std::size_t i = 0; i < BUCKET_COUNT; ++i) {
+        if (m_counts[i] != 0) {
+            w.write_pod<uint32_t>(static_cast<uint32_t>(i));
+            w.write_pod(m_counts[i]);
+        }
+    }
+    w.write_pod(m_total_count);
+    w.write_pod(m_min);
+    w.write_pod(m_max);
+    w.write_pod(m_sum);
+}
+
+bool LatencyHistogram::load_state(CheckpointReader& r) {
+    clear();
+    uint64_t used = 0;
+    if (!r.read_pod(used))
+        return false;
+    for (uint64_t k = 0; k < used; ++k) {
+        uint32_t index = 0;
+        uint64_t count = 0;
+        if (!r.read_pod(index) || !r.read_pod(count) || index >= BUCKET_COUNT)
+            return false;
+        m_counts[index] = count;
+    }
+    return r.read_pod(m_total_count) && r.read_pod(m_min) && r.read_pod(m_max) && r.read_pod(m_sum);
+}
+
+}  // namespace APBSystem
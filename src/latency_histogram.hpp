@@ -0,0 +1,64 @@
+// latency_histogram.hpp
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace APBSystem {
+
+class CheckpointWriter;
+class CheckpointReader;
+
+// log-linear (HDR 風格) histogram: 每個 2 的冪次區間再切成 SUB_BUCKET_COUNT 格
+// 小於 2 * SUB_BUCKET_COUNT 的值完全精確, 其餘相對誤差 < 1 / SUB_BUCKET_COUNT
+// 記憶體大小固定, 與記錄的筆數無關; 兩個 histogram 可以直接相加合併
+class LatencyHistogram {
+   public:
+    static const int SUB_BUCKET_BITS = 5;
+    static const uint64_t SUB_BUCKET_COUNT = 1ull << SUB_BUCKET_BITS;
+    static const std::size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS) * SUB_BUCKET_COUNT + SUB_BUCKET_COUNT;
+
+    LatencyHistogram();
+
+    void record(uint64_t value, uint64_t count = 1);
+    void merge(const LatencyHistogram& other);
+    void clear();
+
+    uint64_t get_count() const { return m_total_count; }
+    uint64_t get_min() const { return m_total_count == 0 ? 0 : m_min; }
+    uint64_t get_max() const { return m_max; }
+    double get_mean() const;
+    // q 介於 0 與 1; 回傳該 bucket 的上界 (不超過實際最大值)
+    uint64_t value_at_quantile(double q) const;
+
+    void save_state(CheckpointWriter& w) const;
+    bool load_state(CheckpointReader& r);
+
+   private:
+    static std::size_t bucket_index(uint64_t value);
+    static uint64_t bucket_upper_bound(std::size_t index);
+
+    std::array<uint64_t, BUCKET_COUNT> m_counts;
+    uint64_t m_total_count;
+    uint64_t m_min;
+    uint64_t m_max;
+    double m_sum;
+};
+
+// 每個 completer 的交易長度與 wait state 分佈 (讀寫分開)
+struct CompleterLatencyHistograms {
+    LatencyHistogram read_duration;
+    LatencyHistogram write_duration;
+    LatencyHistogram read_wait_states;
+    LatencyHistogram write_wait_states;
+
+    void merge(const CompleterLatencyHistograms& other) {
+        read_duration.merge(other.read_duration);
+        write_duration.merge(other.write_duration);
+        read_wait_states.merge(other.read_wait_states);
+        write_wait_states.merge(other.write_wait_states);
+    }
+};
+
+}  // namespace APBSystem
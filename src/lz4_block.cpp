@@ -0,0 +1,114 @@
+// lz4_block.cpp
+#include "lz4_block.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace APBSystem {
+
+namespace {
+void put_lz4_length(std::vector<unsigned char>& out, std::size_t extra) {
+    while (extra >= 255) {
+        out.push_back(255);
+        extra -= 255;
+    }
+    out.push_back(static_cast<unsigned char>(extra));
+}
+
+void put_lz4_sequence(std::vector<unsigned char>& out, const unsigned char* literals, std::size_t literal_len, std::size_t offset, std::size_t match_len) {
+    const std::size_t match_code = match_len >= 4 ? match_len - 4 : 0;
+    out.push_back(static_cast<unsigned char>((std::min<std::size_t>(literal_len, 15) << 4) |
+                                             (match_len ? std::min<std::size_t>(match_code, 15) : 0)));
+    if (literal_len >= 15)
+        put_lz4_length(out, literal_len - 15);
+    out.insert(out.end(), literals, literals + literal_len);
+    if (match_len == 0)
+        return;
+    out.push_back(static_cast<unsigned char>(offset));
+    out.push_back(static_cast<unsigned char>(offset >> 8));
+    if (match_code >= 15)
+        put_lz4_length(out, match_code - 15);
+}
+}  // namespace
+
+void lz4_compress(const unsigned char* src, std::size_t n, std::vector<unsigned char>& out) {
+    const std::size_t MIN_MATCH = 4, LAST_LITERALS = 5, MATCH_FIND_LIMIT = 12;
+    out.clear();
+    std::vector<int64_t> table(1 << 16, -1);
+    std::size_t anchor = 0, i = 0;
+    while (i + MATCH_FIND_LIMIT <= n) {
+        uint32_t seq;
+        std::memcpy(&seq, &src[i], 4);
+        uint32_t h = (seq * 2654435761u) >> 16;
+        int64_t candidate = table[h];
+        table[h] = static_cast<int64_t>(i);
+        uint32_t candidate_seq = 0;
+        if (candidate >= 0)
+            std::memcpy(&candidate_seq, &src[candidate], 4);
+        if (candidate >= 0 && i - candidate <= 65535 && candidate_seq == seq) {
+            std::size_t match_len = MIN_MATCH;
+            while (i + match_len < n - LAST_LITERALS && src[candidate + match_len] == src[i + match_len])
+                ++match_len;
+            put_lz4_sequence(out, &src[anchor], i - anchor, i - candidate, match_len);
+            i += match_len;
+            anchor = i;
+        } else {
+            ++i;
+        }
+    }
+    put_lz4_sequence(out, src + anchor, n - anchor, 0, 0);
+}
+
+bool lz4_uncompress(const unsigned char* src, uint64_t src_len, unsigned char* dst, uint64_t dst_len) {
+    const unsigned char* ip = src;
+    const unsigned char* const iend = src + src_len;
+    unsigned char* op = dst;
+    unsigned char* const ostart = op;
+    unsigned char* const oend = op + dst_len;
+    while (ip < iend) {
+        unsigned token = *ip++;
+        std::size_t literal_len = token >> 4;
+        if (literal_len == 15) {
+            unsigned char b;
+            do {
+                if (ip >= iend)
+                    return false;
+                b = *ip++;
+                literal_len += b;
+            } while (b == 255);
+        }
+        if (literal_len > static_cast<std::size_t>(iend - ip) || literal_len > static_cast<std::size_t>(oend - op))
+            return false;
+        std::memcpy(op, ip, literal_len);
+        op += literal_len;
+        ip += literal_len;
+        if (ip >= iend)
+            break;  // 最後一個 sequence 只有 literal
+        if (iend - ip < 2)
+            return false;
+        std::size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > static_cast<std::size_t>(op - ostart))
+            return false;
+        std::size_t match_len = token & 15;
+        if (match_len == 15) {
+            unsigned char b;
+            do {
+                if (ip >= iend)
+                    return false;
+                b = *ip++;
+                match_len += b;
+            } while (b == 255);
+        }
+        match_len += 4;
+        if (match_len > static_cast<std::size_t>(oend - op))
+            return false;
+        // match 可能與輸出重疊 (offset < match_len), 逐 byte 複製
+        const unsigned char* match = op - offset;
+        for (std::size_t i = 0; i < match_len; ++i)
+            op[i] = match[i];
+        op += match_len;
+    }
+    return op == oend;
+}
+
+}  // namespace APBSystem
@@ -0,0 +1,22 @@
+// lz4_block.hpp
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace APBSystem {
+
+// --- LZ4 block 格式 (沒有 frame header) ---
+// fstapi 的 '4' pack type / LZ4 hierarchy 與交易匯出檔使用
+
+// 簡單的 greedy 壓縮 (hash 4 bytes); out 的內容會被取代, 輸出可被任何 LZ4 block 解碼器讀取
+void lz4_compress(const unsigned char* src, std::size_t len, std::vector<unsigned char>& out);
+// 解壓縮到 dst (剛好 dst_len bytes); 資料損毀或長度不符時回傳 false
+bool lz4_uncompress(const unsigned char* src, uint64_t src_len, unsigned char* dst, uint64_t dst_len);
+inline bool lz4_uncompress(const unsigned char* src, uint64_t src_len, uint64_t dst_len, std::vector<unsigned char>& dst) {
+    dst.resize(static_cast<std::size_t>(dst_len));
+    return lz4_uncompress(src, src_len, dst.data(), dst_len);
+}
+
+}  // namespace APBSystem
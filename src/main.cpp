@@ -1,101 +1,382 @@
+#include <unistd.h>
+#include <algorithm>
 #include <chrono>
+#include <csignal>
+#include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <vector>
-#include "apb_analyzer.hpp"
+#include "analysis_session.hpp"
 #include "apb_types.hpp"
 #include "report_generator.hpp"
-#include "signal_manager.hpp"
-#include "statistics.hpp"
-#include "vcd_parser.hpp"
+#include "result_cache.hpp"
+#include "shard_runner.hpp"
+#include "trace_diff.hpp"
+#include "transaction_stream.hpp"
+#include "value_change_feed.hpp"
 
 using namespace APBSystem;
 
+static volatile std::sig_atomic_t g_stop_requested = 0;
+static void handle_stop_signal(int) {
+    g_stop_requested = 1;
+}
+
+// 結果快取中各報表的順序
+enum CachedOutput { OUTPUT_REPORT = 0, OUTPUT_LATENCY, OUTPUT_PROTOCOL, OUTPUT_TIMELINE, OUTPUT_HEATMAP, OUTPUT_HOT_REGISTERS, OUTPUT_COUNT };
+
+static bool write_text_file(const std::string& path, const std::string& content, const char* what) {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Error: Could not open " << what << " file: " << path << std::endl;
+        return false;
+    }
+    file << content;
+    return true;
+}
+
 int main(int argc, char* argv[]) {
     if (argc < 4) {
-        std::cerr << "Usage: " << argv[0] << " <input_vcd_file> -o <output_txt_file>" << std::endl;
+        std::cerr << "Usage: " << argv[0] << " <input_vcd_file> -o <output_txt_file>"
+                  << " [--checkpoint <file>] [--resume <file>]"
+                  << " [--follow [--poll-ms <ms>] [--snapshot-ms <ms>] [--follow-idle-timeout-ms <ms>]]"
+                  << " [--feed-listen] [--latency-report <file>] [--protocol-report <file>]"
+                  << " [--extended-bit-analysis] [--finalize-threads <n>] [--full-bit-counts]"
+                  << " [--coalesce-timestamps before|after] [--cache-dir <dir> [--cache-max-mb <n>]] [--input-threads <n>] [--shards <n>]"
+                  << " [--transactions-out <file.apbt> [--transactions-lz4]]"
+                  << " [--diff <dut_vcd_file> [--diff-timing] [--diff-max <n>] [--diff-context <n>]]"
+                  << " [--timeline <file.csv|file.json> [--timeline-unit edges|ps] [--timeline-width <n>]]"
+                  << " [--register-heatmap <file.csv>] [--hot-registers <file> [--hot-register-count <n>]]"
+                  << " [--sample <windows> [--sample-fraction <f>] [--sample-seed <n>]]" << std::endl;
         return 1;
     }
     std::string vcd_file_path = argv[1];
     std::string output_file_path = argv[3];
+    std::string checkpoint_save_path;
+    std::string checkpoint_resume_path;
+    std::string latency_report_path;
+    std::string protocol_report_path;
+    std::string timeline_path;
+    std::string register_heatmap_path;
+    std::string hot_registers_path;
+    std::size_t hot_register_count = 10;
+    std::string transactions_path;
+    bool transactions_lz4 = false;
+    std::string diff_dut_path;
+    TraceDiffOptions diff_options;
+    TimelineUnit timeline_unit = TimelineUnit::PCLK_EDGES;
+    uint64_t timeline_width = 10000;
+    bool extended_bit_analysis = false;
+    unsigned finalize_threads = 1;
+    unsigned input_threads = 1;
+    unsigned shard_count = 1;
+    bool sample_mode = false;
+    SampleOptions sample_options;
+    bool full_bit_counts = false;
+    TimestampCoalescing coalescing = TimestampCoalescing::OFF;
+    bool follow_mode = false;
+    bool feed_listen_mode = false;
+    VcdParser::FollowOptions follow_options;
+    uint64_t snapshot_interval_ms = 5000;
+    std::string cache_dir;
+    uint64_t cache_max_mb = 256;
+    for (int i = 4; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--checkpoint" && i + 1 < argc) {
+            checkpoint_save_path = argv[++i];
+        } else if (arg == "--resume" && i + 1 < argc) {
+            checkpoint_resume_path = argv[++i];
+        } else if (arg == "--latency-report" && i + 1 < argc) {
+            latency_report_path = argv[++i];
+        } else if (arg == "--protocol-report" && i + 1 < argc) {
+            protocol_report_path = argv[++i];
+        } else if (arg == "--timeline" && i + 1 < argc) {
+            timeline_path = argv[++i];
+        } else if (arg == "--timeline-unit" && i + 1 < argc) {
+            std::string unit = argv[++i];
+            if (unit != "edges" && unit != "ps") {
+                std::cerr << "Error: --timeline-unit must be edges or ps" << std::endl;
+                return 1;
+            }
+            timeline_unit = unit == "ps" ? TimelineUnit::PICOSECONDS : TimelineUnit::PCLK_EDGES;
+        } else if (arg == "--timeline-width" && i + 1 < argc) {
+            timeline_width = std::max<uint64_t>(1, std::strtoull(argv[++i], nullptr, 10));
+        } else if (arg == "--register-heatmap" && i + 1 < argc) {
+            register_heatmap_path = argv[++i];
+        } else if (arg == "--hot-registers" && i + 1 < argc) {
+            hot_registers_path = argv[++i];
+        } else if (arg == "--hot-register-count" && i + 1 < argc) {
+            hot_register_count = static_cast<std::size_t>(std::max(1, std::atoi(argv[++i])));
+        } else if (arg == "--extended-bit-analysis") {
+            extended_bit_analysis = true;
+        } else if (arg == "--full-bit-counts") {
+            full_bit_counts = true;
+        } else if (arg == "--coalesce-timestamps" && i + 1 < argc) {
+            // 同一個 #time 內的變化合併後才評估 PCLK 上升緣, 結果與行順序無關
+            std::string sampling = argv[++i];
+            if (sampling != "before" && sampling != "after") {
+                std::cerr << "Error: --coalesce-timestamps must be before or after" << std::endl;
+                return 1;
+            }
+            coalescing = sampling == "before" ? TimestampCoalescing::SAMPLE_BEFORE_EDGE : TimestampCoalescing::SAMPLE_AFTER_EDGE;
+        } else if (arg == "--cache-dir" && i + 1 < argc) {
+            cache_dir = argv[++i];
+        } else if (arg == "--cache-max-mb" && i + 1 < argc) {
+            cache_max_mb = std::max<uint64_t>(1, std::strtoull(argv[++i], nullptr, 10));
+        } else if (arg == "--finalize-threads" && i + 1 < argc) {
+            finalize_threads = static_cast<unsigned>(std::max(1, std::atoi(argv[++i])));
+        } else if (arg == "--input-threads" && i + 1 < argc) {
+            // FST 輸入的 block 解壓縮執行緒數
+            input_threads = static_cast<unsigned>(std::max(1, std::atoi(argv[++i])));
+        } else if (arg == "--shards" && i + 1 < argc) {
+            // 時間切片的 worker process 數
+            shard_count = static_cast<unsigned>(std::max(1, std::atoi(argv[++i])));
+        } else if (arg == "--sample" && i + 1 < argc) {
+            // 只分析幾個時間視窗, 推估整段的統計 (近似值)
+            sample_mode = true;
+            sample_options.windows = static_cast<unsigned>(std::max(1, std::atoi(argv[++i])));
+        } else if (arg == "--sample-fraction" && i + 1 < argc) {
+            double fraction = std::atof(argv[++i]);
+            if (!(fraction > 0.0 && fraction <= 1.0)) {
+                std::cerr << "Error: --sample-fraction must be in (0, 1]" << std::endl;
+                return 1;
+            }
+            sample_options.fraction = fraction;
+        } else if (arg == "--sample-seed" && i + 1 < argc) {
+            sample_options.random_placement = true;
+            sample_options.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--transactions-out" && i + 1 < argc) {
+            // 所有完成的交易寫成 columnar 二進位檔, 給下游工具使用
+            transactions_path = argv[++i];
+        } else if (arg == "--transactions-lz4") {
+            transactions_lz4 = true;
+        } else if (arg == "--diff" && i + 1 < argc) {
+            // 輸入檔當作 golden, 與這個 DUT 波形比對交易序列; 輸出檔改為比對結果
+            diff_dut_path = argv[++i];
+        } else if (arg == "--diff-timing") {
+            diff_options.compare_timing = true;
+        } else if (arg == "--diff-max" && i + 1 < argc) {
+            diff_options.max_divergences = static_cast<std::size_t>(std::max(1, std::atoi(argv[++i])));
+        } else if (arg == "--diff-context" && i + 1 < argc) {
+            diff_options.context = static_cast<std::size_t>(std::max(0, std::atoi(argv[++i])));
+        } else if (arg == "--follow") {
+            follow_mode = true;
+        } else if (arg == "--feed-listen") {
+            // 輸入改為 Unix socket 路徑, 接收二進位 value-change feed
+            feed_listen_mode = true;
+        } else if (arg == "--poll-ms" && i + 1 < argc) {
+            follow_options.poll_interval_ms = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--snapshot-ms" && i + 1 < argc) {
+            snapshot_interval_ms = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--follow-idle-timeout-ms" && i + 1 < argc) {
+            follow_options.idle_timeout_ms = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            std::cerr << "Error: Unknown option: " << arg << std::endl;
+            return 1;
+        }
+    }
+    if (shard_count > 1 && (follow_mode || feed_listen_mode || !checkpoint_save_path.empty() || !checkpoint_resume_path.empty())) {
+        std::cerr << "Error: --shards cannot be combined with --follow, --feed-listen, --checkpoint or --resume" << std::endl;
+        return 1;
+    }
+    if (shard_count > 1 && !transactions_path.empty()) {
+        std::cerr << "Error: --shards cannot be combined with --transactions-out" << std::endl;
+        return 1;
+    }
+    if (!diff_dut_path.empty() && (follow_mode || feed_listen_mode || !checkpoint_save_path.empty() || !checkpoint_resume_path.empty() ||
+                                   shard_count > 1 || !transactions_path.empty())) {
+        std::cerr << "Error: --diff cannot be combined with --follow, --feed-listen, --checkpoint, --resume, --shards or --transactions-out" << std::endl;
+        return 1;
+    }
+    if (sample_mode && (follow_mode || feed_listen_mode || !checkpoint_save_path.empty() || !checkpoint_resume_path.empty() ||
+                        shard_count > 1 || !transactions_path.empty() || !diff_dut_path.empty() || !timeline_path.empty())) {
+        std::cerr << "Error: --sample cannot be combined with --follow, --feed-listen, --checkpoint, --resume, --shards, --transactions-out, --diff or --timeline" << std::endl;
+        return 1;
+    }
     std::ofstream out_file(output_file_path);
     if (!out_file.is_open()) {
         std::cerr << "Error: Could not open output file: " << output_file_path << std::endl;
         return 1;
     }
 
+    if (!diff_dut_path.empty()) {
+        // 與 diff(1) 相同: 0 = 相同, 1 = 有差異, 2 = 錯誤
+        diff_options.coalescing = coalescing;
+        bool identical = false;
+        if (!run_trace_diff(vcd_file_path, diff_dut_path, diff_options, out_file, identical))
+            return 2;
+        return identical ? 0 : 1;
+    }
+
     /*std::ofstream debug_log_file("debug_log.txt");
     if (!debug_log_file.is_open()) {
         std::cerr << "Warning: Could not open debug_log.txt for writing." << std::endl;
     }
     */
 
-    auto R_PROGRAM_START_TIME = std::chrono::high_resolution_clock::now();
+    // 結果快取只用在一次性的檔案分析; follow / feed / checkpoint 的輸入會變動
+    // 交易匯出檔不在快取的內容中, 需要時一律重新分析
+    bool use_cache = !cache_dir.empty() && !follow_mode && !feed_listen_mode &&
+                     checkpoint_save_path.empty() && checkpoint_resume_path.empty() && transactions_path.empty();
+    ResultCache result_cache(cache_dir, cache_max_mb * 1024 * 1024);
+    uint64_t cache_key = 0;
+    if (use_cache) {
+        // 會影響輸出內容的設定都要放進 key (finalize 執行緒數不影響結果)
+        std::ostringstream config;
+        config << "ext=" << extended_bit_analysis << ";full=" << full_bit_counts
+               << ";coalesce=" << static_cast<int>(coalescing)
+               << ";latency=" << !latency_report_path.empty() << ";protocol=" << !protocol_report_path.empty()
+               << ";timeline=" << timeline_path << ";unit=" << static_cast<int>(timeline_unit) << ";width=" << timeline_width
+               << ";heatmap=" << !register_heatmap_path.empty() << ";hot=" << !hot_registers_path.empty() << ";hot_n=" << hot_register_count;
+        if (sample_mode)
+            config << ";sample=" << sample_options.windows << "," << sample_options.fraction << "," << sample_options.random_placement
+                   << "," << sample_options.seed;
+        use_cache = result_cache.compute_key(vcd_file_path, config.str(), cache_key);
+    }
+    std::vector<std::string> outputs(OUTPUT_COUNT);
+    if (use_cache && result_cache.lookup(cache_key, outputs) && outputs.size() == OUTPUT_COUNT) {
+        out_file << outputs[OUTPUT_REPORT];
+        bool ok = (latency_report_path.empty() || write_text_file(latency_report_path, outputs[OUTPUT_LATENCY], "latency report")) &&
+                  (protocol_report_path.empty() || write_text_file(protocol_report_path, outputs[OUTPUT_PROTOCOL], "protocol report")) &&
+                  (timeline_path.empty() || write_text_file(timeline_path, outputs[OUTPUT_TIMELINE], "timeline")) &&
+                  (register_heatmap_path.empty() || write_text_file(register_heatmap_path, outputs[OUTPUT_HEATMAP], "register heatmap")) &&
+                  (hot_registers_path.empty() || write_text_file(hot_registers_path, outputs[OUTPUT_HOT_REGISTERS], "hot register report"));
+        return ok ? 0 : 1;
+    }
+    outputs.assign(OUTPUT_COUNT, std::string());
 
-    VcdParser vcd_parser;
-    SignalManager signal_manager;
-    Statistics statistics;
-    ApbAnalyzer apb_analyzer(statistics /*, debug_log_file*/);
+    AnalysisSession session;
     ReportGenerator report_generator;
+    session.statistics().set_extended_bit_analysis(extended_bit_analysis);
+    session.statistics().set_finalize_threads(finalize_threads);
+    session.statistics().set_incremental_corruption_analysis(!full_bit_counts);
+    session.set_timestamp_coalescing(coalescing);
+    session.set_input_threads(input_threads);
+    if (!timeline_path.empty())
+        session.statistics().enable_timeline(timeline_unit, timeline_width, 4096);
+    if (!register_heatmap_path.empty() || !hot_registers_path.empty())
+        session.statistics().enable_register_heatmap();
 
-    SignalState current_signal_snapshot;
-    bool previous_pclk_val_for_edge_detection = false;
-    uint64_t pclk_rising_edge_counter = 0;
-    uint64_t last_processed_vcd_timestamp = 0;
-    const uint64_t TRANSACTION_LIMIT = 1000000;
-    auto var_definition_callback =
-        [&](const std::string& id_code, const std::string& type_str, int width, const std::string& hierarchical_name) {
-            signal_manager.register_signal(id_code, type_str, width, hierarchical_name);
-        };
+    if (!checkpoint_save_path.empty())
+        session.set_hold_unterminated_tail(true);
+    if (!checkpoint_resume_path.empty()) {
+        if (!session.resume_from_checkpoint(checkpoint_resume_path, vcd_file_path)) {
+            return 1;
+        }
+    }
 
-    auto timestamp_callback =
-        [&](uint64_t vcd_time_ps) {
-            current_signal_snapshot.timestamp = vcd_time_ps;
-            last_processed_vcd_timestamp = vcd_time_ps;
-        };
+    TransactionStreamWriter transaction_writer;
+    if (!transactions_path.empty()) {
+        if (!transaction_writer.open(transactions_path, transactions_lz4))
+            return 1;
+        session.analyzer().set_transaction_callback([&](const TransactionRecord& record) { transaction_writer.append(record); });
+    }
 
-    auto value_change_callback =
-        [&](char id_char, const char* value_ptr, size_t value_len) {
-            if (apb_analyzer.get_completed_transaction_count() >= TRANSACTION_LIMIT) {
-                return;
-            }
-            bool pclk_did_rise = signal_manager.update_state_on_signal_change(
-                id_char, value_ptr, value_len,
-                current_signal_snapshot,
-                previous_pclk_val_for_edge_detection);
-
-            if (pclk_did_rise) {
-                pclk_rising_edge_counter++;
-                apb_analyzer.analyze_on_pclk_rising_edge(current_signal_snapshot, pclk_rising_edge_counter);
+    bool parse_ok = false;
+    SampleSummary sample_summary;
+    if (feed_listen_mode) {
+        int listen_fd = listen_unix_socket(vcd_file_path);
+        int conn_fd = listen_fd == -1 ? -1 : accept_unix_socket(listen_fd);
+        parse_ok = conn_fd != -1 && session.ingest_value_change_feed(conn_fd);
+        if (conn_fd != -1)
+            close(conn_fd);
+        if (listen_fd != -1) {
+            close(listen_fd);
+            unlink(vcd_file_path.c_str());
+        }
+    } else if (follow_mode) {
+        // 即時回報錯誤, 並每隔 snapshot_interval_ms 輸出一次統計快照
+        session.analyzer().set_live_error_callback([&](LiveErrorKind kind, uint64_t timestamp, uint32_t paddr) {
+            report_generator.generate_live_error_line(kind, timestamp, paddr, std::cout);
+        });
+        std::signal(SIGINT, handle_stop_signal);
+        std::signal(SIGTERM, handle_stop_signal);
+        auto last_snapshot_time = std::chrono::steady_clock::now();
+        auto poll_callback = [&]() {
+            auto now = std::chrono::steady_clock::now();
+            if (snapshot_interval_ms > 0 &&
+                std::chrono::duration_cast<std::chrono::milliseconds>(now - last_snapshot_time).count() >= static_cast<int64_t>(snapshot_interval_ms)) {
+                last_snapshot_time = now;
+                session.refresh_running_statistics();
+                report_generator.generate_snapshot_line(session.statistics(), session.analyzer().get_completed_transaction_count(), session.get_last_timestamp(), std::cout);
             }
+            return g_stop_requested == 0;
         };
-    auto end_definitions_callback = [&]() {
-        statistics.set_bus_widths(signal_manager.get_paddr_width(), signal_manager.get_pwdata_width());
-    };
-
-    auto end_dumpvars_callback = []() {};
-
-    if (!vcd_parser.parse_file(vcd_file_path,
-                               var_definition_callback,
-                               timestamp_callback,
-                               value_change_callback,
-                               end_definitions_callback)) {
+        parse_ok = session.follow_file(vcd_file_path, follow_options, poll_callback);
+    } else if (sample_mode) {
+        parse_ok = run_sampled_analysis(session, vcd_file_path, sample_options, sample_summary);
+    } else if (shard_count > 1) {
+        parse_ok = run_sharded_analysis(session, vcd_file_path, shard_count);
+    } else {
+        parse_ok = session.parse_file(vcd_file_path);
+    }
+    if (!parse_ok) {
         std::cerr << "錯誤: 解析 VCD 檔案失敗: " << vcd_file_path << std::endl;
         out_file.close();
         // debug_log_file.close();
         return 1;
     }
 
-    statistics.set_total_pclk_rising_edges(pclk_rising_edge_counter);
-
-    apb_analyzer.finalize_analysis(last_processed_vcd_timestamp);
+    if (!transactions_path.empty() && !transaction_writer.close())
+        return 1;
 
-    auto R_PROGRAM_END_TIME = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double, std::milli> ELAPSED_CPU_TIME_MS = R_PROGRAM_END_TIME - R_PROGRAM_START_TIME;
-    statistics.set_cpu_elapsed_time_ms(ELAPSED_CPU_TIME_MS.count());
+    if (!checkpoint_save_path.empty()) {
+        if (!session.save_checkpoint(checkpoint_save_path, vcd_file_path)) {
+            return 1;
+        }
+    }
 
-    report_generator.generate_apb_transaction_report(statistics, out_file);
+    session.finalize();
+    std::ostringstream rendered;
+    if (sample_mode)
+        report_generator.generate_sample_report(sample_summary, session.statistics(), rendered);
+    else
+        session.write_report(rendered);
+    outputs[OUTPUT_REPORT] = rendered.str();
+    out_file << outputs[OUTPUT_REPORT];
+    if (!latency_report_path.empty()) {
+        rendered.str(std::string());
+        report_generator.generate_latency_report(session.statistics(), rendered);
+        outputs[OUTPUT_LATENCY] = rendered.str();
+        if (!write_text_file(latency_report_path, outputs[OUTPUT_LATENCY], "latency report"))
+            return 1;
+    }
+    if (!protocol_report_path.empty()) {
+        rendered.str(std::string());
+        report_generator.generate_protocol_report(session.statistics(), rendered);
+        outputs[OUTPUT_PROTOCOL] = rendered.str();
+        if (!write_text_file(protocol_report_path, outputs[OUTPUT_PROTOCOL], "protocol report"))
+            return 1;
+    }
+    if (!timeline_path.empty()) {
+        rendered.str(std::string());
+        bool as_json = timeline_path.size() >= 5 && timeline_path.compare(timeline_path.size() - 5, 5, ".json") == 0;
+        if (as_json)
+            report_generator.generate_timeline_json(session.statistics().get_timeline(), rendered);
+        else
+            report_generator.generate_timeline_csv(session.statistics().get_timeline(), rendered);
+        outputs[OUTPUT_TIMELINE] = rendered.str();
+        if (!write_text_file(timeline_path, outputs[OUTPUT_TIMELINE], "timeline"))
+            return 1;
+    }
+    if (!register_heatmap_path.empty()) {
+        rendered.str(std::string());
+        report_generator.generate_register_heatmap_csv(session.statistics().get_register_heatmap(), rendered);
+        outputs[OUTPUT_HEATMAP] = rendered.str();
+        if (!write_text_file(register_heatmap_path, outputs[OUTPUT_HEATMAP], "register heatmap"))
+            return 1;
+    }
+    if (!hot_registers_path.empty()) {
+        rendered.str(std::string());
+        report_generator.generate_hot_register_report(session.statistics().get_register_heatmap(), hot_register_count, rendered);
+        outputs[OUTPUT_HOT_REGISTERS] = rendered.str();
+        if (!write_text_file(hot_registers_path, outputs[OUTPUT_HOT_REGISTERS], "hot register report"))
+            return 1;
+    }
+    if (use_cache)
+        result_cache.store(cache_key, outputs);
 
     out_file.close();
     // debug_log_file.close();
@@ -0,0 +1,62 @@
+// monotonic_arena.cpp
+#include "monotonic_arena.hpp"
+#include <algorithm>
+
+namespace APBSystem {
+
+namespace {
+const std::size_t MAX_BLOCK_BYTES = 16 * 1024 * 1024;
+}
+
+MonotonicArena::MonotonicArena(std::size_t initial_block_bytes)
+    : m_initial_block_bytes(std::max<std::size_t>(initial_block_bytes, 1024)),
+      m_next_block_bytes(m_initial_block_bytes),
+      m_head(nullptr),
+      m_cursor(nullptr),
+      m_end(nullptr),
+      m_allocation_count(0),
+      m_block_count(0),
+      m_bytes_reserved(0) {}
+
+MonotonicArena::~MonotonicArena() {
+    release();
+}
+
+void MonotonicArena::add_block(std::size_t min_bytes) {
+    // block 大小倍增到上限; 特別大的配置直接拿一個剛好夠用的 block
+    std::size_t payload = std::max(m_next_block_bytes, min_bytes);
+    m_next_block_bytes = std::min(m_next_block_bytes * 2, MAX_BLOCK_BYTES);
+    char* raw = static_cast<char*>(::operator new(sizeof(BlockHeader) + payload));
+    BlockHeader* block = reinterpret_cast<BlockHeader*>(raw);
+    block->next = m_head;
+    m_head = block;
+    m_cursor = raw + sizeof(BlockHeader);
+    m_end = m_cursor + payload;
+    m_block_count++;
+    m_bytes_reserved += payload;
+}
+
+void* MonotonicArena::allocate(std::size_t bytes, std::size_t alignment) {
+    m_allocation_count++;
+    uintptr_t aligned = (reinterpret_cast<uintptr_t>(m_cursor) + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+    if (m_cursor == nullptr || aligned + bytes > reinterpret_cast<uintptr_t>(m_end)) {
+        add_block(bytes + alignment);
+        aligned = (reinterpret_cast<uintptr_t>(m_cursor) + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+    }
+    m_cursor = reinterpret_cast<char*>(aligned + bytes);
+    return reinterpret_cast<void*>(aligned);
+}
+
+void MonotonicArena::release() {
+    while (m_head) {
+        BlockHeader* next = m_head->next;
+        ::operator delete(m_head);
+        m_head = next;
+    }
+    m_cursor = m_end = nullptr;
+    m_next_block_bytes = m_initial_block_bytes;
+    m_block_count = 0;
+    m_bytes_reserved = 0;
+}
+
+}  // namespace APBSystem
@@ -0,0 +1,89 @@
+// monotonic_arena.hpp
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <new>
+#include <unordered_map>
+#include <vector>
+
+namespace APBSystem {
+
+// 一次分析期間使用的 monotonic arena: 只配置不釋放, 分析結束 (或 release) 時整批歸還
+// 大量檔案的 batch 模式不會因為零碎的 malloc/free 造成 allocator fragmentation
+// 只適合只增加的容器 (append 的 vector、矩陣); 經常 erase 的容器放在 arena 會隨操作次數一直成長
+class MonotonicArena {
+   public:
+    explicit MonotonicArena(std::size_t initial_block_bytes = 64 * 1024);
+    ~MonotonicArena();
+    MonotonicArena(const MonotonicArena&) = delete;
+    MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+    void* allocate(std::size_t bytes, std::size_t alignment);
+    // 釋放所有 block; 之後仍可繼續配置 (前提是沒有容器還在使用舊的記憶體)
+    void release();
+
+    uint64_t get_allocation_count() const { return m_allocation_count; }
+    uint64_t get_block_count() const { return m_block_count; }
+    uint64_t get_bytes_reserved() const { return m_bytes_reserved; }
+
+   private:
+    struct BlockHeader {
+        BlockHeader* next;
+    };
+    void add_block(std::size_t min_bytes);
+
+    const std::size_t m_initial_block_bytes;
+    std::size_t m_next_block_bytes;
+    BlockHeader* m_head;
+    char* m_cursor;
+    char* m_end;
+    uint64_t m_allocation_count;
+    uint64_t m_block_count;
+    uint64_t m_bytes_reserved;
+};
+
+// 配合標準容器的 allocator; arena 為 nullptr 時退回一般的 operator new/delete
+template <typename T>
+class ArenaAllocator {
+   public:
+    using value_type = T;
+
+    ArenaAllocator() noexcept : m_arena(nullptr) {}
+    explicit ArenaAllocator(MonotonicArena* arena) noexcept : m_arena(arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : m_arena(other.get_arena()) {}
+
+    T* allocate(std::size_t n) {
+        if (m_arena)
+            return static_cast<T*>(m_arena->allocate(n * sizeof(T), alignof(T)));
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+    void deallocate(T* p, std::size_t) noexcept {
+        if (!m_arena)
+            ::operator delete(p);
+    }
+    MonotonicArena* get_arena() const noexcept { return m_arena; }
+
+   private:
+    MonotonicArena* m_arena;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) noexcept {
+    return a.get_arena() == b.get_arena();
+}
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) noexcept {
+    return !(a == b);
+}
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+template <typename K, typename V>
+using ArenaUnorderedMap = std::unordered_map<K, V, std::hash<K>, std::equal_to<K>, ArenaAllocator<std::pair<const K, V>>>;
+template <typename K, typename V>
+using ArenaMap = std::map<K, V, std::less<K>, ArenaAllocator<std::pair<const K, V>>>;
+
+}  // namespace APBSystem
@@ -0,0 +1,56 @@
+// register_heatmap.cpp
+#include "register_heatmap.hpp"
+#include "checkpoint.hpp"
+
+namespace APBSystem {
+
+RegisterHeatmap::RegisterHeatmap() : m_enabled(false), m_unmapped_accesses(0) {}
+
+void RegisterHeatmap::enable() {
+    const RegisterCounters zero = {0, 0, 0, 0};
+    m_enabled = true;
+    m_unmapped_accesses = 0;
+    m_counters.assign(COMPLETER_COUNT * REGISTERS_PER_COMPLETER, zero);
+}
+
+bool RegisterHeatmap::is_completer_accessed(CompleterID completer) const {
+    if (!m_enabled || static_cast<int>(completer) >= COMPLETER_COUNT)
+        return false;
+    for (uint32_t i = 0; i < REGISTERS_PER_COMPLETER; ++i) {
+        if (get_counters(completer, i).accesses() != 0)
+            return true;
+    }
+    return false;
+}
+
+void RegisterHeatmap::merge(const RegisterHeatmap& later) {
+    if (!later.m_enabled)
+        return;
+    if (!m_enabled)
+        enable();
+    m_unmapped_accesses += later.m_unmapped_accesses;
+    for (std::size_t i = 0; i < m_counters.size(); ++i) {
+        RegisterCounters& c = m_counters[i];
+        const RegisterCounters& l = later.m_counters[i];
+        c.reads += l.reads;
+        c.writes += l.writes;
+        c.wait_cycles += l.wait_cycles;
+        if (l.accesses() != 0 && l.last_access_ps >= c.last_access_ps)
+            c.last_access_ps = l.last_access_ps;
+    }
+}
+
+void RegisterHeatmap::save_state(CheckpointWriter& w) const {
+    w.write_pod(m_enabled);
+    w.write_pod(m_unmapped_accesses);
+    w.write_pod_vector(m_counters);
+}
+
+bool RegisterHeatmap::load_state(CheckpointReader& r) {
+    if (!r.read_bool(m_enabled) || !r.read_pod(m_unmapped_accesses) || !r.read_pod_vector(m_counters))
+        return false;
+    // 啟用時陣列大小固定, 否則之後的索引會超出範圍
+    return !m_enabled || m_counters.size() == COMPLETER_COUNT * REGISTERS_PER_COMPLETER;
+}
+
+}  // namespace APBSystem
@@ -0,0 +1,75 @@
+// register_heatmap.hpp
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "apb_types.hpp"
+
+namespace APBSystem {
+
+class CheckpointWriter;
+class CheckpointReader;
+
+// 一個 32-bit 暫存器 (completer 視窗內 4-byte 對齊的 offset) 的存取計數
+struct RegisterCounters {
+    uint64_t reads;
+    uint64_t writes;
+    uint64_t wait_cycles;
+    uint64_t last_access_ps;  // 最後一筆交易的開始時間
+
+    uint64_t accesses() const { return reads + writes; }
+};
+
+// 各 completer 每個暫存器的讀寫次數、wait cycles 與最後存取時間
+// 所有 completer 共用一個連續陣列, 以 completer * REGISTERS_PER_COMPLETER + (paddr - base) >> 2 索引,
+// 每筆交易只有幾次陣列更新, 不需要 hash
+class RegisterHeatmap {
+   public:
+    static const int COMPLETER_COUNT = static_cast<int>(CompleterID::UNKNOWN_COMPLETER);
+    static const uint32_t REGISTERS_PER_COMPLETER = 1u << (PADDR_OFFSET_BITS - 2);
+
+    RegisterHeatmap();
+
+    void enable();
+    bool is_enabled() const { return m_enabled; }
+
+    // completer 必須是 start_transaction 時由 paddr 判定的結果, paddr 一定在該 completer 的視窗內
+    void on_transaction(CompleterID completer, uint32_t paddr, bool is_write, uint64_t wait_cycles, uint64_t start_time_ps) {
+        const int k = static_cast<int>(completer);
+        if (k >= COMPLETER_COUNT) {
+            m_unmapped_accesses++;
+            return;
+        }
+        RegisterCounters& r = m_counters[k * REGISTERS_PER_COMPLETER + ((paddr - completer_base_addr(completer)) >> 2)];
+        if (is_write)
+            r.writes++;
+        else
+            r.reads++;
+        r.wait_cycles += wait_cycles;
+        r.last_access_ps = start_time_ps;
+    }
+
+    static uint32_t completer_base_addr(CompleterID completer) {
+        static const uint32_t bases[COMPLETER_COUNT] = {UART_BASE_ADDR, GPIO_BASE_ADDR, SPI_MASTER_BASE_ADDR};
+        return bases[static_cast<int>(completer)];
+    }
+    const RegisterCounters& get_counters(CompleterID completer, uint32_t index) const {
+        return m_counters[static_cast<int>(completer) * REGISTERS_PER_COMPLETER + index];
+    }
+    bool is_completer_accessed(CompleterID completer) const;
+    // PADDR 不在任何 completer 視窗內 (或含 X/Z) 的交易數
+    uint64_t get_unmapped_accesses() const { return m_unmapped_accesses; }
+
+    // later 是之後一段時間的計數 (時間切片): 次數相加, 最後存取時間取較晚的
+    void merge(const RegisterHeatmap& later);
+
+    void save_state(CheckpointWriter& w) const;
+    bool load_state(CheckpointReader& r);
+
+   private:
+    bool m_enabled;
+    uint64_t m_unmapped_accesses;
+    std::vector<RegisterCounters> m_counters;
+};
+
+}  // namespace APBSystem
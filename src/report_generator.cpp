@@ -1,6 +1,7 @@
 // report_generator.cpp
 #include "report_generator.hpp"
 #include <algorithm>
+#include <cmath>
 #include <iomanip>
 #include <sstream>
 #include <vector>
@@ -26,25 +27,14 @@ static std::string bit_detail_status_to_report_string(const APBSystem::BitDetail
         oss << "Connected with " << prefix << detail.shorted_with_bit_index;
         return oss.str();
     }
+    if (detail.status == APBSystem::BitConnectionStatus::STUCK_AT_0)
+        return "Stuck at 0";
+    if (detail.status == APBSystem::BitConnectionStatus::STUCK_AT_1)
+        return "Stuck at 1";
     return "Correct";
 }
-void ReportGenerator::generate_apb_transaction_report(const Statistics& stats, std::ostream& out) const {
-    // Section 1: Transaction Statistics
-    out << "Number of Read Transactions with no wait states: " << stats.get_read_transactions_no_wait() << "\n";
-    out << "Number of Read Transactions with wait states: " << stats.get_read_transactions_with_wait() << "\n";
-    out << "Number of Write Transactions with no wait states: " << stats.get_write_transactions_no_wait() << "\n";
-    out << "Number of Write Transactions with wait states: " << stats.get_write_transactions_with_wait() << "\n";
-    out << std::fixed << std::setprecision(2);
-    out << "Average Read Cycle: " << stats.get_average_read_cycle_duration() << " cycles\n";
-    out << "Average Write Cycle: " << stats.get_average_write_cycle_duration() << " cycles\n";
-    out << "Bus Utilization: " << stats.get_bus_utilization_percentage() << "%\n";
-    out << std::defaultfloat << std::setprecision(0);
-    out << "Number of Idle Cycles: " << stats.get_num_idle_pclk_edges() << "\n";
-    out << "Number of Completer: " << stats.get_number_of_unique_completers_accessed() << "\n";
-    out << std::fixed << std::setprecision(2);
-    out << "CPU Elapsed Time: " << stats.get_cpu_elapsed_time_ms() << " ms\n";
-    out << std::defaultfloat << std::setprecision(6);
-
+// Section 2-4: 錯誤計數、completer 連線狀態與依時間排序的錯誤明細 (取樣報表也使用)
+static void write_error_sections(const Statistics& stats, std::ostream& out) {
     // Section 2: Error Summary
     out << "\nNumber of Transactions with Timeout: " << stats.get_timeout_error_details().size() << "\n";
     out << "Number of Out-of-Range Accesses: " << stats.get_out_of_range_details().size() << "\n";
@@ -108,4 +98,358 @@ void ReportGenerator::generate_apb_transaction_report(const Statistics& stats, s
         out << "[#" << e.timestamp << "] " << e.message << "\n";
     }
 }
-}  // namespace APBSystem
\ No newline at end of file
+void ReportGenerator::generate_apb_transaction_report(const Statistics& stats, std::ostream& out) const {
+    // Section 1: Transaction Statistics
+    out << "Number of Read Transactions with no wait states: " << stats.get_read_transactions_no_wait() << "\n";
+    out << "Number of Read Transactions with wait states: " << stats.get_read_transactions_with_wait() << "\n";
+    out << "Number of Write Transactions with no wait states: " << stats.get_write_transactions_no_wait() << "\n";
+    out << "Number of Write Transactions with wait states: " << stats.get_write_transactions_with_wait() << "\n";
+    out << std::fixed << std::setprecision(2);
+    out << "Average Read Cycle: " << stats.get_average_read_cycle_duration() << " cycles\n";
+    out << "Average Write Cycle: " << stats.get_average_write_cycle_duration() << " cycles\n";
+    out << "Bus Utilization: " << stats.get_bus_utilization_percentage() << "%\n";
+    out << std::defaultfloat << std::setprecision(0);
+    out << "Number of Idle Cycles: " << stats.get_num_idle_pclk_edges() << "\n";
+    out << "Number of Completer: " << stats.get_number_of_unique_completers_accessed() << "\n";
+    out << std::fixed << std::setprecision(2);
+    out << "CPU Elapsed Time: " << stats.get_cpu_elapsed_time_ms() << " ms\n";
+    out << std::defaultfloat << std::setprecision(6);
+
+    write_error_sections(stats, out);
+}
+void ReportGenerator::generate_live_error_line(LiveErrorKind kind, uint64_t timestamp, uint32_t paddr, std::ostream& out) const {
+    std::ostringstream oss;
+    oss << "[#" << timestamp << "] ";
+    switch (kind) {
+        case LiveErrorKind::TIMEOUT:
+            oss << "Timeout Occurred -> Transaction Stalled at PADDR 0x" << std::hex << paddr;
+            break;
+        case LiveErrorKind::OUT_OF_RANGE:
+            oss << "Out-of-Range Access -> PADDR 0x" << std::hex << paddr << " (provisional)";
+            break;
+        case LiveErrorKind::READ_WRITE_OVERLAP:
+            oss << "Read-Write Overlap Error -> Read & Write at PADDR 0x" << std::hex << paddr << " overlapped (provisional)";
+            break;
+        case LiveErrorKind::DATA_MIRRORING:
+            oss << "Data Mirroring -> Read at PADDR 0x" << std::hex << paddr << " returned data written elsewhere";
+            break;
+    }
+    out << oss.str() << std::endl;
+}
+void ReportGenerator::generate_snapshot_line(const Statistics& stats, uint64_t completed_transactions, uint64_t current_timestamp, std::ostream& out) const {
+    std::ostringstream oss;
+    oss << "[snapshot #" << current_timestamp << "] transactions=" << completed_transactions
+        << " reads=" << (stats.get_read_transactions_no_wait() + stats.get_read_transactions_with_wait())
+        << " writes=" << (stats.get_write_transactions_no_wait() + stats.get_write_transactions_with_wait())
+        << std::fixed << std::setprecision(2)
+        << " utilization=" << stats.get_bus_utilization_percentage() << "%"
+        << " timeouts=" << stats.get_timeout_error_details().size()
+        << " mirrored=" << stats.get_mirroring_error_count();
+    out << oss.str() << std::endl;
+}
+static void write_histogram_line(const std::string& label, const LatencyHistogram& h, std::ostream& out) {
+    std::ostringstream oss;
+    oss << label << ": count=" << h.get_count();
+    if (h.get_count() > 0) {
+        oss << " p50=" << h.value_at_quantile(0.50)
+            << " p99=" << h.value_at_quantile(0.99)
+            << " p99.9=" << h.value_at_quantile(0.999)
+            << " max=" << h.get_max()
+            << std::fixed << std::setprecision(2) << " mean=" << h.get_mean();
+    }
+    out << oss.str() << "\n";
+}
+void ReportGenerator::generate_latency_report(const Statistics& stats, std::ostream& out) const {
+    bool first = true;
+    for (const auto& kv : stats.get_latency_histograms()) {
+        if (!first)
+            out << "\n";
+        first = false;
+        const std::string name = "Completer " + completer_id_to_report_string(kv.first);
+        write_histogram_line(name + " Read Cycles", kv.second.read_duration, out);
+        write_histogram_line(name + " Read Wait States", kv.second.read_wait_states, out);
+        write_histogram_line(name + " Write Cycles", kv.second.write_duration, out);
+        write_histogram_line(name + " Write Wait States", kv.second.write_wait_states, out);
+    }
+}
+static const char* protocol_violation_name(ProtocolViolationKind kind) {
+    switch (kind) {
+        case ProtocolViolationKind::PENABLE_IN_IDLE:
+            return "PENABLE Asserted Without SETUP";
+        case ProtocolViolationKind::SETUP_ABORTED:
+            return "PSEL Deasserted in SETUP";
+        case ProtocolViolationKind::SETUP_NOT_FOLLOWED_BY_ACCESS:
+            return "SETUP Not Followed by ACCESS";
+        case ProtocolViolationKind::PSEL_DROPPED_IN_ACCESS:
+            return "PSEL Deasserted in ACCESS";
+        case ProtocolViolationKind::PENABLE_DROPPED_IN_ACCESS:
+            return "PENABLE Deasserted in ACCESS";
+        case ProtocolViolationKind::CONTROL_X_IN_TRANSFER:
+            return "X/Z on Control Signal During Transfer";
+        case ProtocolViolationKind::PADDR_CHANGED_IN_TRANSFER:
+            return "PADDR Changed During Transfer";
+        case ProtocolViolationKind::PWRITE_CHANGED_IN_TRANSFER:
+            return "PWRITE Changed During Transfer";
+        default:
+            return "Unknown";
+    }
+}
+void ReportGenerator::generate_protocol_report(const Statistics& stats, std::ostream& out) const {
+    std::ostringstream oss;
+    oss << "Protocol Violations: " << stats.get_total_protocol_violation_count() << "\n";
+    for (int k = static_cast<int>(ProtocolViolationKind::NONE) + 1; k < static_cast<int>(ProtocolViolationKind::COUNT); ++k) {
+        ProtocolViolationKind kind = static_cast<ProtocolViolationKind>(k);
+        oss << "  " << protocol_violation_name(kind) << ": " << stats.get_protocol_violation_count(kind) << "\n";
+    }
+    // APB4 PSLVERR: 只列出有錯誤回應的 completer
+    uint64_t slave_errors = 0;
+    const CompleterID completers[] = {CompleterID::UART, CompleterID::GPIO, CompleterID::SPI_MASTER, CompleterID::UNKNOWN_COMPLETER};
+    for (CompleterID cid : completers)
+        slave_errors += stats.get_slave_error_count(cid);
+    oss << "PSLVERR Responses: " << slave_errors << "\n";
+    for (CompleterID cid : completers) {
+        if (stats.get_slave_error_count(cid) > 0)
+            oss << "  Completer " << completer_id_to_report_string(cid) << ": " << stats.get_slave_error_count(cid) << "\n";
+    }
+    const auto& details = stats.get_protocol_violation_details();
+    if (details.size() < stats.get_total_protocol_violation_count())
+        oss << "(showing the first " << details.size() << " violations)\n";
+    oss << "\n";
+    // 明細依偵測順序記錄, 時間本來就是遞增的
+    for (const auto& d : details)
+        oss << "[#" << d.timestamp << "] " << protocol_violation_name(d.kind) << " -> PADDR 0x" << std::hex << d.paddr << std::dec << "\n";
+    out << oss.str();
+}
+static double bucket_utilization(const TimelineBucket& b) {
+    return b.pclk_edges == 0 ? 0.0 : static_cast<double>(b.active_edges) / b.pclk_edges * 100.0;
+}
+void ReportGenerator::generate_timeline_csv(const UtilizationTimeline& timeline, std::ostream& out) const {
+    const char* unit = timeline.get_unit() == TimelineUnit::PCLK_EDGES ? "edge" : "ps";
+    out << "start_" << unit << ",end_" << unit << ",pclk_edges,active_edges,utilization,transactions,reads,writes,wait_cycles\n";
+    const auto& buckets = timeline.get_buckets();
+    const uint64_t width = timeline.get_bucket_width();
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(2);
+    for (std::size_t i = 0; i < buckets.size(); ++i) {
+        const TimelineBucket& b = buckets[i];
+        uint64_t start = (timeline.get_first_bucket_index() + i) * width;
+        oss << start << "," << start + width << "," << b.pclk_edges << "," << b.active_edges << ","
+            << bucket_utilization(b) << "," << (b.reads + b.writes) << "," << b.reads << "," << b.writes << ","
+            << b.wait_cycles << "\n";
+    }
+    out << oss.str();
+}
+void ReportGenerator::generate_timeline_json(const UtilizationTimeline& timeline, std::ostream& out) const {
+    const auto& buckets = timeline.get_buckets();
+    const uint64_t width = timeline.get_bucket_width();
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(2);
+    oss << "{\n  \"unit\": \"" << (timeline.get_unit() == TimelineUnit::PCLK_EDGES ? "pclk_edges" : "ps")
+        << "\",\n  \"bucket_width\": " << width << ",\n  \"buckets\": [";
+    for (std::size_t i = 0; i < buckets.size(); ++i) {
+        const TimelineBucket& b = buckets[i];
+        oss << (i == 0 ? "\n" : ",\n") << "    {\"start\": " << (timeline.get_first_bucket_index() + i) * width
+            << ", \"pclk_edges\": " << b.pclk_edges << ", \"active_edges\": " << b.active_edges
+            << ", \"utilization\": " << bucket_utilization(b) << ", \"transactions\": " << (b.reads + b.writes)
+            << ", \"reads\": " << b.reads << ", \"writes\": " << b.writes << ", \"wait_cycles\": " << b.wait_cycles << "}";
+    }
+    oss << "\n  ]\n}\n";
+    out << oss.str();
+}
+
+static const CompleterID HEATMAP_COMPLETERS[] = {CompleterID::UART, CompleterID::GPIO, CompleterID::SPI_MASTER};
+static double average_wait_cycles(const RegisterCounters& c) {
+    return c.accesses() == 0 ? 0.0 : static_cast<double>(c.wait_cycles) / c.accesses();
+}
+void ReportGenerator::generate_register_heatmap_csv(const RegisterHeatmap& heatmap, std::ostream& out) const {
+    out << "completer,address,offset,reads,writes,accesses,wait_cycles,avg_wait_cycles,last_access_ps\n";
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(2);
+    for (CompleterID cid : HEATMAP_COMPLETERS) {
+        if (!heatmap.is_completer_accessed(cid))
+            continue;
+        const uint32_t base = RegisterHeatmap::completer_base_addr(cid);
+        for (uint32_t i = 0; i < RegisterHeatmap::REGISTERS_PER_COMPLETER; ++i) {
+            const RegisterCounters& c = heatmap.get_counters(cid, i);
+            oss << completer_id_to_report_string(cid) << ",0x" << std::hex << std::setw(8) << std::setfill('0') << base + i * 4
+                << ",0x" << std::setw(3) << i * 4 << std::dec << std::setfill(' ') << "," << c.reads << "," << c.writes << ","
+                << c.accesses() << "," << c.wait_cycles << "," << average_wait_cycles(c) << ",";
+            if (c.accesses() != 0)
+                oss << c.last_access_ps;
+            oss << "\n";
+        }
+    }
+    out << oss.str();
+}
+void ReportGenerator::generate_hot_register_report(const RegisterHeatmap& heatmap, std::size_t top_n, std::ostream& out) const {
+    struct HotRegister {
+        CompleterID completer;
+        uint32_t index;
+        const RegisterCounters* counters;
+    };
+    std::vector<HotRegister> accessed;
+    uint64_t total_accesses = 0;
+    for (CompleterID cid : HEATMAP_COMPLETERS) {
+        if (!heatmap.is_completer_accessed(cid))
+            continue;
+        for (uint32_t i = 0; i < RegisterHeatmap::REGISTERS_PER_COMPLETER; ++i) {
+            const RegisterCounters& c = heatmap.get_counters(cid, i);
+            if (c.accesses() == 0)
+                continue;
+            accessed.push_back({cid, i, &c});
+            total_accesses += c.accesses();
+        }
+    }
+    const std::size_t shown = std::min(top_n, accessed.size());
+    // 位址隨 completer 與 index 遞增, 相同次數時保持位址順序
+    std::partial_sort(accessed.begin(), accessed.begin() + shown, accessed.end(), [](const HotRegister& a, const HotRegister& b) {
+        if (a.counters->accesses() != b.counters->accesses())
+            return a.counters->accesses() > b.counters->accesses();
+        return a.completer != b.completer ? a.completer < b.completer : a.index < b.index;
+    });
+
+    std::ostringstream oss;
+    oss << "Registers Accessed: " << accessed.size() << "\n";
+    oss << "Register Accesses: " << total_accesses << "\n";
+    oss << "Unmapped Accesses: " << heatmap.get_unmapped_accesses() << "\n";
+    oss << "\nTop " << shown << " Hot Registers:\n";
+    oss << std::left << std::setw(6) << "Rank" << std::setw(12) << "Completer" << std::setw(12) << "Address" << std::right
+        << std::setw(12) << "Accesses" << std::setw(12) << "Reads" << std::setw(12) << "Writes" << std::setw(14) << "Wait Cycles"
+        << std::setw(10) << "Avg Wait" << std::setw(22) << "Last Access (ps)" << "\n";
+    oss << std::fixed << std::setprecision(2);
+    for (std::size_t k = 0; k < shown; ++k) {
+        const HotRegister& h = accessed[k];
+        const RegisterCounters& c = *h.counters;
+        std::ostringstream address;
+        address << "0x" << std::hex << std::setw(8) << std::setfill('0') << RegisterHeatmap::completer_base_addr(h.completer) + h.index * 4;
+        oss << std::left << std::setw(6) << k + 1 << std::setw(12) << completer_id_to_report_string(h.completer) << std::setw(12)
+            << address.str() << std::right << std::setw(12) << c.accesses() << std::setw(12) << c.reads << std::setw(12) << c.writes
+            << std::setw(14) << c.wait_cycles << std::setw(10) << average_wait_cycles(c) << std::setw(22) << c.last_access_ps << "\n";
+    }
+    out << oss.str();
+}
+namespace {
+// ratio estimator 的點估計與 95% 信賴區間的半寬; 視窗少於 2 個時沒有區間
+struct RatioEstimate {
+    double value;
+    double half_width;
+    bool has_interval;
+};
+double t_quantile_975(std::size_t degrees_of_freedom) {
+    static const double table[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                   2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                   2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+    return degrees_of_freedom <= 30 ? table[degrees_of_freedom - 1] : 1.960;
+}
+// 每個視窗是一個 cluster: R = sum(y) / sum(x), Var(R) = sum((y - R x)^2) / (n (n - 1) mean(x)^2)
+template <typename GetY, typename GetX>
+RatioEstimate estimate_ratio(const std::vector<SampleWindowStats>& windows, GetY y, GetX x) {
+    double sum_y = 0.0, sum_x = 0.0;
+    std::size_t n = 0;
+    for (const auto& w : windows) {
+        if (!w.analyzed)
+            continue;
+        sum_y += y(w);
+        sum_x += x(w);
+        n++;
+    }
+    RatioEstimate e = {sum_x > 0.0 ? sum_y / sum_x : 0.0, 0.0, n >= 2 && sum_x > 0.0};
+    if (!e.has_interval)
+        return e;
+    double residuals = 0.0;
+    for (const auto& w : windows) {
+        if (w.analyzed) {
+            const double r = y(w) - e.value * x(w);
+            residuals += r * r;
+        }
+    }
+    const double mean_x = sum_x / n;
+    e.half_width = t_quantile_975(n - 1) * std::sqrt(residuals / (n * (n - 1.0))) / mean_x;
+    return e;
+}
+void write_estimate(std::ostream& out, const char* label, const RatioEstimate& e, double scale, const char* unit) {
+    out << label << ": " << e.value * scale;
+    if (e.has_interval)
+        out << " +/- " << e.half_width * scale;
+    out << unit << "\n";
+}
+}  // namespace
+
+void ReportGenerator::generate_sample_report(const SampleSummary& summary, const Statistics& stats, std::ostream& out) const {
+    const auto& windows = summary.windows;
+    std::size_t analyzed = 0;
+    uint64_t sampled_ps = 0, edges = 0, reads = 0, writes = 0;
+    for (const auto& w : windows) {
+        if (!w.analyzed)
+            continue;
+        analyzed++;
+        sampled_ps += w.last_timestamp - w.first_timestamp;
+        edges += w.pclk_edges;
+        reads += w.reads;
+        writes += w.writes;
+    }
+    const uint64_t span_ps = summary.trace_end_ps - summary.trace_begin_ps;
+    std::ostringstream oss;
+    oss << "Sampled Analysis (approximate)\n";
+    oss << "Trace Span: #" << summary.trace_begin_ps << " - #" << summary.trace_end_ps << "\n";
+    oss << "Windows: " << windows.size() << " requested, " << analyzed << " analyzed";
+    if (summary.random_placement)
+        oss << " (random placement, seed " << summary.seed << ")\n";
+    else
+        oss << " (evenly spaced)\n";
+    oss << std::fixed << std::setprecision(2);
+    oss << "Sampled Time: " << sampled_ps << " ps (" << (span_ps == 0 ? 0.0 : 100.0 * sampled_ps / span_ps) << "% of trace)\n";
+    oss << "Sampled PCLK Edges: " << edges << "\n";
+    oss << "Sampled Read Transactions: " << reads << "\n";
+    oss << "Sampled Write Transactions: " << writes << "\n";
+
+    // 整段的 edge 數以視窗內的 PCLK 週期推估; 交易數 = 每個 edge 的交易數 x 推估的 edge 數
+    const RatioEstimate utilization = estimate_ratio(
+        windows, [](const SampleWindowStats& w) { return static_cast<double>(w.active_edges); },
+        [](const SampleWindowStats& w) { return static_cast<double>(w.pclk_edges); });
+    const RatioEstimate read_share = estimate_ratio(
+        windows, [](const SampleWindowStats& w) { return static_cast<double>(w.reads); },
+        [](const SampleWindowStats& w) { return static_cast<double>(w.reads + w.writes); });
+    const RatioEstimate read_cycle = estimate_ratio(
+        windows, [](const SampleWindowStats& w) { return w.read_cycles; }, [](const SampleWindowStats& w) { return static_cast<double>(w.reads); });
+    const RatioEstimate write_cycle = estimate_ratio(
+        windows, [](const SampleWindowStats& w) { return w.write_cycles; }, [](const SampleWindowStats& w) { return static_cast<double>(w.writes); });
+    const RatioEstimate reads_per_edge = estimate_ratio(
+        windows, [](const SampleWindowStats& w) { return static_cast<double>(w.reads); },
+        [](const SampleWindowStats& w) { return static_cast<double>(w.pclk_edges); });
+    const RatioEstimate writes_per_edge = estimate_ratio(
+        windows, [](const SampleWindowStats& w) { return static_cast<double>(w.writes); },
+        [](const SampleWindowStats& w) { return static_cast<double>(w.pclk_edges); });
+    const double estimated_edges = sampled_ps == 0 ? 0.0 : static_cast<double>(edges) / sampled_ps * span_ps;
+
+    oss << "\nEstimates (95% confidence interval):\n";
+    write_estimate(oss, "Bus Utilization", utilization, 100.0, "%");
+    write_estimate(oss, "Read Share of Transactions", read_share, 100.0, "%");
+    write_estimate(oss, "Average Read Cycle", read_cycle, 1.0, " cycles");
+    write_estimate(oss, "Average Write Cycle", write_cycle, 1.0, " cycles");
+    oss << std::setprecision(0);
+    oss << "Estimated PCLK Edges: " << estimated_edges << "\n";
+    write_estimate(oss, "Estimated Read Transactions", reads_per_edge, estimated_edges, "");
+    write_estimate(oss, "Estimated Write Transactions", writes_per_edge, estimated_edges, "");
+    oss << std::setprecision(2);
+    oss << "CPU Elapsed Time: " << stats.get_cpu_elapsed_time_ms() << " ms\n";
+
+    oss << "\nWindow  Start (ps)            End (ps)              PCLK Edges   Utilization  Reads       Writes\n";
+    for (std::size_t k = 0; k < windows.size(); ++k) {
+        const SampleWindowStats& w = windows[k];
+        oss << std::left << std::setw(8) << k + 1 << std::setw(22) << w.window_begin_ps << std::setw(22) << w.window_end_ps;
+        if (!w.analyzed) {
+            oss << "not synchronized\n";
+            continue;
+        }
+        std::ostringstream percent;
+        percent << std::fixed << std::setprecision(2) << (w.pclk_edges == 0 ? 0.0 : 100.0 * w.active_edges / w.pclk_edges) << "%";
+        oss << std::setw(13) << w.pclk_edges << std::setw(13) << percent.str() << std::setw(12) << w.reads << w.writes << "\n";
+    }
+    oss << std::right;
+    out << oss.str();
+
+    out << "\nErrors in Sampled Windows:";
+    write_error_sections(stats, out);
+}
+}  // namespace APBSystem
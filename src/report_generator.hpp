@@ -1,5 +1,7 @@
+#pragma once
 #include <iostream>
 #include <string>
+#include "analysis_session.hpp"
 #include "statistics.hpp"  // 依賴 Statistics 類別來獲取數據
 
 namespace APBSystem {
@@ -13,6 +15,29 @@ class ReportGenerator {
     // @param out_stream: 報表輸出的目標流 (例如 std::cout 或一個檔案流)
     void generate_apb_transaction_report(const Statistics& stats, std::ostream& out_stream) const;
 
+    // follow 模式: 單行的即時錯誤與週期性統計快照
+    void generate_live_error_line(LiveErrorKind kind, uint64_t timestamp, uint32_t paddr, std::ostream& out_stream) const;
+    void generate_snapshot_line(const Statistics& stats, uint64_t completed_transactions, uint64_t current_timestamp, std::ostream& out_stream) const;
+
+    // 每個 completer 的交易長度 / wait state 分佈 (p50, p99, p99.9, max)
+    void generate_latency_report(const Statistics& stats, std::ostream& out_stream) const;
+
+    // APB 協定違規: 各類計數、各 completer 的 PSLVERR 次數與 (最多 MAX_PROTOCOL_VIOLATION_RECORDS 筆) 依時間排序的明細
+    void generate_protocol_report(const Statistics& stats, std::ostream& out_stream) const;
+
+    // 時間軸: 每個 bucket 一列 (CSV) 或一個物件 (JSON)
+    void generate_timeline_csv(const UtilizationTimeline& timeline, std::ostream& out_stream) const;
+    void generate_timeline_json(const UtilizationTimeline& timeline, std::ostream& out_stream) const;
+
+    // 暫存器熱度圖: 有存取的 completer 每個暫存器一列 (包含沒有存取的暫存器, 方便直接畫成熱度圖)
+    void generate_register_heatmap_csv(const RegisterHeatmap& heatmap, std::ostream& out_stream) const;
+    // 存取次數最多的前 top_n 個暫存器 (次數相同時依位址排序)
+    void generate_hot_register_report(const RegisterHeatmap& heatmap, std::size_t top_n, std::ostream& out_stream) const;
+
+    // 取樣分析: 以各視窗為樣本推估整段的 utilization、讀寫比例與平均 cycle 數 (95% 信賴區間),
+    // 之後是每個視窗的計數與視窗內找到的錯誤
+    void generate_sample_report(const SampleSummary& summary, const Statistics& stats, std::ostream& out_stream) const;
+
     // 您可能還有其他報表生成方法，例如錯誤摘要報表
     // void generate_error_summary_report(const ErrorLogger& error_logger, std::ostream& out_stream) const;
 };
@@ -0,0 +1,286 @@
+// result_cache.cpp
+#include "result_cache.hpp"
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include "checkpoint.hpp"
+
+namespace APBSystem {
+
+namespace {
+const uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+const uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+const uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+const uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+const uint32_t CACHE_ENTRY_MAGIC = 0x43525041;  // "APRC"
+const uint32_t CACHE_ENTRY_VERSION = 1;
+const char* const CACHE_ENTRY_SUFFIX = ".apbr";
+const char* const CACHE_LOCK_NAME = ".lock";
+const uint64_t MAX_CACHED_OUTPUTS = 64;  // 損毀的 entry 不會造成巨大的配置
+// 異常結束的 process 留下的暫存檔, 超過這個時間就清掉
+const time_t STALE_TEMP_SECONDS = 3600;
+
+inline uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+inline uint64_t read_u64(const unsigned char* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+inline uint32_t read_u32(const unsigned char* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap32(v);
+#endif
+    return v;
+}
+inline uint64_t xxh64_round(uint64_t acc, uint64_t input) {
+    acc += input * PRIME64_2;
+    acc = rotl64(acc, 31);
+    return acc * PRIME64_1;
+}
+inline uint64_t xxh64_merge_round(uint64_t acc, uint64_t val) {
+    acc ^= xxh64_round(0, val);
+    return acc * PRIME64_1 + PRIME64_4;
+}
+
+bool ends_with(const char* name, const char* suffix) {
+    std::size_t n = std::strlen(name), s = std::strlen(suffix);
+    return n >= s && std::memcmp(name + n - s, suffix, s) == 0;
+}
+
+struct CacheFileInfo {
+    time_t mtime;
+    uint64_t bytes;
+    std::string path;
+};
+}  // namespace
+
+uint64_t xxh64(const void* data, std::size_t len, uint64_t seed) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const unsigned char* const end = p + len;
+    uint64_t h;
+    if (len >= 32) {
+        // 四條獨立的 lane, 每次吃 32 bytes
+        uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+        uint64_t v2 = seed + PRIME64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - PRIME64_1;
+        const unsigned char* const limit = end - 32;
+        do {
+            v1 = xxh64_round(v1, read_u64(p));
+            v2 = xxh64_round(v2, read_u64(p + 8));
+            v3 = xxh64_round(v3, read_u64(p + 16));
+            v4 = xxh64_round(v4, read_u64(p + 24));
+            p += 32;
+        } while (p <= limit);
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = xxh64_merge_round(h, v1);
+        h = xxh64_merge_round(h, v2);
+        h = xxh64_merge_round(h, v3);
+        h = xxh64_merge_round(h, v4);
+    } else {
+        h = seed + PRIME64_5;
+    }
+    h += static_cast<uint64_t>(len);
+    for (; p + 8 <= end; p += 8) {
+        h ^= xxh64_round(0, read_u64(p));
+        h = rotl64(h, 27) * PRIME64_1 + PRIME64_4;
+    }
+    if (p + 4 <= end) {
+        h ^= static_cast<uint64_t>(read_u32(p)) * PRIME64_1;
+        h = rotl64(h, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+    for (; p < end; ++p) {
+        h ^= (*p) * PRIME64_5;
+        h = rotl64(h, 11) * PRIME64_1;
+    }
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+bool xxh64_file(const std::string& path, uint64_t seed, uint64_t& hash) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+        return false;
+    struct stat sb{};
+    if (fstat(fd, &sb) == -1) {
+        close(fd);
+        return false;
+    }
+    const std::size_t size = sb.st_size;
+    if (size == 0) {
+        close(fd);
+        hash = xxh64(nullptr, 0, seed);
+        return true;
+    }
+    void* file = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (file == MAP_FAILED)
+        return false;
+    madvise(file, size, MADV_SEQUENTIAL);
+    hash = xxh64(file, size, seed);
+    munmap(file, size);
+    return true;
+}
+
+ResultCache::ResultCache(const std::string& directory, uint64_t max_bytes)
+    : m_directory(directory), m_max_bytes(max_bytes) {}
+
+bool ResultCache::compute_key(const std::string& vcd_path, const std::string& config, uint64_t& key) const {
+    uint64_t parts[3] = {0, 0, 0};
+    if (!xxh64_file(vcd_path, 0, parts[0]))
+        return false;
+    parts[1] = xxh64(config.data(), config.size(), 0);
+    // 執行檔本身的 hash 當作分析器版本: 重新編譯後舊的結果自動失效
+    if (!xxh64_file("/proc/self/exe", 0, parts[2]))
+        parts[2] = CACHE_ENTRY_VERSION;
+    key = xxh64(parts, sizeof(parts), CACHE_ENTRY_VERSION);
+    return true;
+}
+
+std::string ResultCache::entry_path(uint64_t key) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+    return m_directory + "/" + name + CACHE_ENTRY_SUFFIX;
+}
+
+bool ResultCache::lookup(uint64_t key, std::vector<std::string>& outputs) const {
+    const std::string path = entry_path(key);
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open())
+        return false;
+    CheckpointReader r(in);
+    uint32_t magic = 0, version = 0;
+    uint64_t stored_key = 0, count = 0, payload_hash = 0;
+    if (!r.read_pod(magic) || !r.read_pod(version) || !r.read_pod(stored_key) || !r.read_pod(count) ||
+        magic != CACHE_ENTRY_MAGIC || version != CACHE_ENTRY_VERSION || stored_key != key || count > MAX_CACHED_OUTPUTS) {
+        return false;
+    }
+    std::vector<std::string> loaded(static_cast<std::size_t>(count));
+    uint64_t hash = 0;
+    for (auto& s : loaded) {
+        if (!r.read_string(s))
+            return false;
+        hash = xxh64(s.data(), s.size(), hash);
+    }
+    if (!r.read_pod(payload_hash) || payload_hash != hash)
+        return false;
+    outputs.swap(loaded);
+    // LRU: 命中的 entry 把 mtime 更新成現在
+    utimensat(AT_FDCWD, path.c_str(), nullptr, 0);
+    return true;
+}
+
+bool ResultCache::store(uint64_t key, const std::vector<std::string>& outputs) const {
+    // 只建立最後一層目錄; 已經存在不算錯誤
+    if (mkdir(m_directory.c_str(), 0777) == -1 && errno != EEXIST) {
+        std::cerr << "Warning: Could not create cache directory: " << m_directory << std::endl;
+        return false;
+    }
+    const std::string path = entry_path(key);
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), ".tmp.%ld", static_cast<long>(getpid()));
+    // 暫存檔以 '.' 開頭, 不會被當成 entry
+    const std::string tmp_path = m_directory + "/." + path.substr(m_directory.size() + 1) + suffix;
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            std::cerr << "Warning: Could not write cache entry: " << tmp_path << std::endl;
+            return false;
+        }
+        CheckpointWriter w(out);
+        w.write_pod(CACHE_ENTRY_MAGIC);
+        w.write_pod(CACHE_ENTRY_VERSION);
+        w.write_pod(key);
+        w.write_pod<uint64_t>(outputs.size());
+        uint64_t hash = 0;
+        for (const auto& s : outputs) {
+            w.write_string(s);
+            hash = xxh64(s.data(), s.size(), hash);
+        }
+        w.write_pod(hash);
+        out.flush();
+        if (!w.good()) {
+            out.close();
+            std::remove(tmp_path.c_str());
+            return false;
+        }
+    }
+    // 同一個 key 同時被多個 process 寫入時, 最後一個 rename 的勝出, 內容相同
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+    evict_to_capacity();
+    return true;
+}
+
+void ResultCache::evict_to_capacity() const {
+    const std::string lock_path = m_directory + "/" + CACHE_LOCK_NAME;
+    int lock_fd = open(lock_path.c_str(), O_RDWR | O_CREAT, 0666);
+    if (lock_fd == -1)
+        return;
+    // 同時只有一個 process 做清理; 讀取端不需要鎖 (被 unlink 的檔案已開啟的仍可讀完)
+    if (flock(lock_fd, LOCK_EX) == -1) {
+        close(lock_fd);
+        return;
+    }
+    DIR* dir = opendir(m_directory.c_str());
+    if (dir) {
+        std::vector<CacheFileInfo> entries;
+        uint64_t total_bytes = 0;
+        const time_t now = std::time(nullptr);
+        while (struct dirent* ent = readdir(dir)) {
+            const bool is_entry = ent->d_name[0] != '.' && ends_with(ent->d_name, CACHE_ENTRY_SUFFIX);
+            const bool is_temp = ent->d_name[0] == '.' && std::strstr(ent->d_name, ".tmp.") != nullptr;
+            if (!is_entry && !is_temp)
+                continue;
+            std::string path = m_directory + "/" + ent->d_name;
+            struct stat sb{};
+            if (stat(path.c_str(), &sb) == -1)
+                continue;
+            if (is_temp) {
+                if (now - sb.st_mtime > STALE_TEMP_SECONDS)
+                    std::remove(path.c_str());
+                continue;
+            }
+            entries.push_back({sb.st_mtime, static_cast<uint64_t>(sb.st_size), path});
+            total_bytes += sb.st_size;
+        }
+        closedir(dir);
+        std::sort(entries.begin(), entries.end(), [](const CacheFileInfo& a, const CacheFileInfo& b) {
+            return a.mtime < b.mtime;
+        });
+        for (std::size_t i = 0; i < entries.size() && total_bytes > m_max_bytes; ++i) {
+            if (std::remove(entries[i].path.c_str()) == 0)
+                total_bytes -= entries[i].bytes;
+        }
+    }
+    flock(lock_fd, LOCK_UN);
+    close(lock_fd);
+}
+
+}  // namespace APBSystem
@@ -0,0 +1,39 @@
+// result_cache.hpp
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace APBSystem {
+
+// XXH64 (與 xxHash 官方實作相同的輸出)
+uint64_t xxh64(const void* data, std::size_t len, uint64_t seed);
+// 以 mmap 讀入整個檔案計算 XXH64; 無法開啟時回傳 false
+bool xxh64_file(const std::string& path, uint64_t seed, uint64_t& hash);
+
+// --- 以輸入內容 hash 為 key 的分析結果快取 ---
+// 同一份 VCD + 同樣的分析設定 + 同一個執行檔, 直接回傳上次產生的報表, 不再解析
+// 多個 process 可以共用同一個目錄:
+//   - entry 先寫入暫存檔再 rename, 讀取端只會看到完整的檔案
+//   - 命中時更新 mtime, 超過容量時依 mtime 由舊到新刪除 (LRU); 清理時持有目錄的 flock
+class ResultCache {
+   public:
+    ResultCache(const std::string& directory, uint64_t max_bytes);
+
+    // 組合 VCD 內容, 分析設定與執行檔本身的 hash; VCD 無法讀取時回傳 false
+    bool compute_key(const std::string& vcd_path, const std::string& config, uint64_t& key) const;
+    // outputs 依呼叫端約定的順序存放各個報表的內容
+    bool lookup(uint64_t key, std::vector<std::string>& outputs) const;
+    bool store(uint64_t key, const std::vector<std::string>& outputs) const;
+
+   private:
+    std::string entry_path(uint64_t key) const;
+    void evict_to_capacity() const;
+
+    std::string m_directory;
+    uint64_t m_max_bytes;
+};
+
+}  // namespace APBSystem
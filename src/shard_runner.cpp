@@ -0,0 +1,401 @@
+// shard_runner.cpp
+#include "shard_runner.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include "checkpoint.hpp"
+#include "fst_reader.hpp"
+
+namespace APBSystem {
+
+namespace {
+const char ENDDEFINITIONS[] = "$enddefinitions";
+// 取樣時只解析檔案開頭這麼多的內容來取得視窗之外的訊號初值 (reset, $dumpvars)
+const uint64_t SAMPLE_HEAD_SCAN_BYTES = 4 << 20;
+
+void write_scan_summary(CheckpointWriter& w, const ShardScanSummary& s) {
+    w.write_pod(s.written_roles);
+    w.write_pod(s.first_pclk_value);
+    w.write_pod(s.pclk_rising_edges);
+    write_signal_state(w, s.end_state);
+    w.write_pod(s.last_timestamp);
+}
+
+bool read_scan_summary(const std::string& data, ShardScanSummary& s) {
+    std::istringstream in(data);
+    CheckpointReader r(in);
+    return r.read_pod(s.written_roles) && r.read_pod(s.first_pclk_value) && r.read_pod(s.pclk_rising_edges) &&
+           read_signal_state(r, s.end_state) && r.read_pod(s.last_timestamp);
+}
+
+struct Worker {
+    pid_t pid;
+    int fd;
+};
+
+// 在子 process 中執行 job, 序列化的結果經由 pipe 傳回
+bool start_worker(const std::function<bool(CheckpointWriter&)>& job, Worker& worker) {
+    int fds[2];
+    if (pipe(fds) == -1) {
+        std::cerr << "Error: pipe failed: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    // 避免父 process 緩衝區中的輸出被子 process 再寫一次
+    std::cout.flush();
+    std::cerr.flush();
+    pid_t pid = fork();
+    if (pid == -1) {
+        std::cerr << "Error: fork failed: " << std::strerror(errno) << std::endl;
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        std::ostringstream out;
+        CheckpointWriter w(out);
+        bool ok = job(w);
+        const std::string data = out.str();
+        const char* p = data.data();
+        std::size_t remaining = ok ? data.size() : 0;
+        while (remaining > 0) {
+            ssize_t n = write(fds[1], p, remaining);
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                ok = false;
+                break;
+            }
+            p += n;
+            remaining -= n;
+        }
+        close(fds[1]);
+        std::cout.flush();
+        std::cerr.flush();
+        _exit(ok ? 0 : 1);
+    }
+    close(fds[1]);
+    worker.pid = pid;
+    worker.fd = fds[0];
+    return true;
+}
+
+// 讀完子 process 的輸出並等待它結束; 所有 worker 都要收回, 即使前面的已經失敗
+bool collect_worker(const Worker& worker, std::string& result) {
+    result.clear();
+    char buffer[65536];
+    bool ok = true;
+    while (true) {
+        ssize_t n = read(worker.fd, buffer, sizeof(buffer));
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            ok = false;
+            break;
+        }
+        if (n == 0)
+            break;
+        result.append(buffer, n);
+    }
+    close(worker.fd);
+    int status = 0;
+    while (waitpid(worker.pid, &status, 0) == -1 && errno == EINTR) {
+    }
+    return ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// 最多 max_running 個 job 同時執行 (0: 全部同時), 結果依 job 順序放入 results
+bool run_workers(const std::vector<std::function<bool(CheckpointWriter&)>>& jobs, std::vector<std::string>& results,
+                 std::size_t max_running = 0) {
+    const std::size_t limit = max_running == 0 ? jobs.size() : max_running;
+    std::vector<Worker> workers(jobs.size());
+    results.assign(jobs.size(), std::string());
+    std::size_t started = 0;
+    std::size_t collected = 0;
+    bool ok = true;
+    while (true) {
+        while (ok && started < jobs.size() && started - collected < limit) {
+            if (!start_worker(jobs[started], workers[started])) {
+                ok = false;
+                break;
+            }
+            started++;
+        }
+        if (collected == started)
+            break;
+        // 依序收回; 收回一個之後才啟動下一個
+        ok = collect_worker(workers[collected], results[collected]) && ok;
+        collected++;
+    }
+    return ok && collected == jobs.size();
+}
+
+// from 之後 (不含 from 所在的行) 第一行 #timestamp 的開頭; 沒有時回傳 end
+const char* next_timestamp_line(const char* from, const char* end) {
+    const char* p = from;
+    while (p < end) {
+        const char* nl = static_cast<const char*>(std::memchr(p, '\n', end - p));
+        if (nl == nullptr || nl + 1 >= end)
+            return end;
+        if (nl[1] == '#')
+            return nl + 1;
+        p = nl + 1;
+    }
+    return end;
+}
+
+uint64_t timestamp_of_line(const char* line, const char* end) {
+    return VcdParser::parse_decimal_u64(line + 1, end);
+}
+
+// 時間 >= t 的第一行 #timestamp; VCD 的 timestamp 遞增, 以位元組位置二分搜尋
+const char* find_timestamp_line(const char* header_end, const char* end, uint64_t t) {
+    const char* lo = header_end;
+    const char* hi = end;
+    while (lo < hi) {
+        const char* mid = lo + (hi - lo) / 2;
+        const char* line = next_timestamp_line(mid, end);
+        if (line == end || timestamp_of_line(line, end) >= t)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return next_timestamp_line(lo, end);
+}
+
+// 檔案中最後一行 #timestamp; 沒有時回傳 end
+const char* last_timestamp_line(const char* header_end, const char* end) {
+    const char* p = end;
+    while (p > header_end) {
+        const char* hash = static_cast<const char*>(memrchr(header_end, '#', p - header_end));
+        if (hash == nullptr)
+            break;
+        if (hash > header_end && hash[-1] == '\n')
+            return hash;
+        p = hash;
+    }
+    return end;
+}
+
+// $enddefinitions 那一行的換行字元; 沒有時回傳 nullptr
+const char* find_header_end(const char* file, std::size_t size) {
+    const char* header_end = static_cast<const char*>(memmem(file, size, ENDDEFINITIONS, sizeof(ENDDEFINITIONS) - 1));
+    if (header_end == nullptr)
+        return nullptr;
+    return static_cast<const char*>(std::memchr(header_end, '\n', file + size - header_end));
+}
+
+// 唯讀 mmap 整個檔案
+class MappedFile {
+   public:
+    MappedFile() : m_data(nullptr), m_size(0) {}
+    ~MappedFile() {
+        if (m_data != nullptr)
+            munmap(m_data, m_size);
+    }
+    bool open(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd == -1)
+            return false;
+        struct stat sb{};
+        if (fstat(fd, &sb) == -1 || sb.st_size == 0) {
+            close(fd);
+            return false;
+        }
+        void* data = mmap(nullptr, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED)
+            return false;
+        m_data = static_cast<char*>(data);
+        m_size = sb.st_size;
+        return true;
+    }
+    const char* data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+
+   private:
+    char* m_data;
+    std::size_t m_size;
+};
+}  // namespace
+
+bool find_shard_boundaries(const std::string& vcd_path, unsigned shard_count, std::vector<uint64_t>& offsets) {
+    offsets.assign(1, 0);
+    MappedFile mapped;
+    if (!mapped.open(vcd_path))
+        return false;
+    const char* const file = mapped.data();
+    const std::size_t size = mapped.size();
+    const char* const end = file + size;
+    const char* header_end = find_header_end(file, size);
+    if (header_end == nullptr)
+        return false;
+    const std::size_t header_bytes = header_end - file;
+    for (unsigned k = 1; k < shard_count; ++k) {
+        uint64_t target = header_bytes + (size - header_bytes) * k / shard_count;
+        target = std::max(target, offsets.back());
+        // 切在 target 之後第一行 #timestamp 的開頭
+        const char* p = next_timestamp_line(file + target, end);
+        if (p >= end)
+            break;
+        const uint64_t offset = p - file;
+        if (offset > offsets.back())
+            offsets.push_back(offset);
+    }
+    return true;
+}
+
+bool run_sharded_analysis(AnalysisSession& session, const std::string& vcd_path, unsigned shard_count) {
+    std::vector<uint64_t> offsets;
+    if (FstReader::is_fst_file(vcd_path)) {
+        std::cerr << "Note: --shards applies to VCD input only; analyzing " << vcd_path << " in one process" << std::endl;
+        return session.parse_file(vcd_path);
+    }
+    if (!find_shard_boundaries(vcd_path, shard_count, offsets) || offsets.size() < 2)
+        return session.parse_file(vcd_path);
+    const std::size_t shards = offsets.size();
+    auto shard_end = [&](std::size_t k) { return k + 1 < shards ? offsets[k + 1] : 0; };
+
+    // 1. 除了最後一段, 每段只解析訊號, 取得切片結尾的狀態
+    std::vector<std::function<bool(CheckpointWriter&)>> jobs;
+    for (std::size_t k = 0; k + 1 < shards; ++k) {
+        jobs.push_back([&, k](CheckpointWriter& w) {
+            ShardScanSummary summary;
+            if (!session.scan_shard(vcd_path, offsets[k], shard_end(k), summary))
+                return false;
+            write_scan_summary(w, summary);
+            return true;
+        });
+    }
+    std::vector<std::string> results;
+    if (!run_workers(jobs, results)) {
+        std::cerr << "Error: Shard scan failed" << std::endl;
+        return false;
+    }
+    std::vector<ShardBoundaryState> starts(shards);
+    for (std::size_t k = 0; k + 1 < shards; ++k) {
+        ShardScanSummary summary;
+        if (!read_scan_summary(results[k], summary)) {
+            std::cerr << "Error: Corrupted shard scan result" << std::endl;
+            return false;
+        }
+        starts[k + 1] = summary.advance(starts[k]);
+    }
+
+    // 2. 每段從第一個 idle edge 分析到切片結尾之後的第一個 idle edge
+    jobs.clear();
+    for (std::size_t k = 0; k < shards; ++k) {
+        jobs.push_back([&, k](CheckpointWriter& w) {
+            if (!session.analyze_shard(vcd_path, offsets[k], shard_end(k), k == 0 ? nullptr : &starts[k]))
+                return false;
+            session.save_shard_result(w);
+            return true;
+        });
+    }
+    if (!run_workers(jobs, results)) {
+        std::cerr << "Error: Shard analysis failed" << std::endl;
+        return false;
+    }
+
+    // 3. 合併; 無法保證結果相同時改用單一 process
+    std::string reason;
+    if (!session.check_shard_results(results, reason)) {
+        std::cerr << "Note: " << reason << "; analyzing " << vcd_path << " in one process" << std::endl;
+        return session.parse_file(vcd_path);
+    }
+    return session.merge_shard_results(results);
+}
+
+bool run_sampled_analysis(AnalysisSession& session, const std::string& vcd_path, const SampleOptions& options, SampleSummary& summary) {
+    if (FstReader::is_fst_file(vcd_path)) {
+        std::cerr << "Error: --sample applies to VCD input only" << std::endl;
+        return false;
+    }
+    MappedFile mapped;
+    if (!mapped.open(vcd_path)) {
+        std::cerr << "Error: cannot open " << vcd_path << std::endl;
+        return false;
+    }
+    const char* const file = mapped.data();
+    const char* const end = file + mapped.size();
+    const char* header_end = find_header_end(file, mapped.size());
+    const char* first_line = header_end == nullptr ? end : next_timestamp_line(header_end, end);
+    if (first_line == end) {
+        std::cerr << "Error: " << vcd_path << " has no value changes to sample" << std::endl;
+        return false;
+    }
+    summary.trace_begin_ps = timestamp_of_line(first_line, end);
+    summary.trace_end_ps = std::max(summary.trace_begin_ps, timestamp_of_line(last_timestamp_line(header_end, end), end));
+    summary.random_placement = options.random_placement;
+    summary.seed = options.seed;
+    summary.windows.clear();
+
+    // 1. 時間軸分成 windows 等份, 每一份取一個長度為 fraction 的視窗 (置中或隨機位置)
+    const unsigned window_count = std::max(1u, options.windows);
+    const double stratum = static_cast<double>(summary.trace_end_ps - summary.trace_begin_ps) / window_count;
+    const double length = stratum * options.fraction;
+    std::mt19937_64 rng(options.seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::vector<uint64_t> begin_offsets;
+    std::vector<uint64_t> end_offsets;
+    for (unsigned k = 0; k < window_count; ++k) {
+        const double position = options.random_placement ? uniform(rng) : 0.5;
+        const double start = summary.trace_begin_ps + k * stratum + position * (stratum - length);
+        SampleWindowStats window;
+        window.window_begin_ps = static_cast<uint64_t>(std::llround(start));
+        window.window_end_ps = static_cast<uint64_t>(std::llround(start + length));
+        const char* begin_line = find_timestamp_line(header_end, end, window.window_begin_ps);
+        const char* end_line = find_timestamp_line(header_end, end, window.window_end_ps);
+        summary.windows.push_back(window);
+        begin_offsets.push_back(begin_line - file);
+        end_offsets.push_back(end_line == end ? 0 : end_line - file);
+    }
+
+    // 2. 視窗開頭往前找不到的訊號值 (例如只在開頭變化一次的 reset) 使用檔案開頭一小段結束時的狀態
+    const char* head_line = next_timestamp_line(header_end + std::min<uint64_t>(SAMPLE_HEAD_SCAN_BYTES, end - header_end), end);
+    const uint64_t head_end = std::min<uint64_t>(begin_offsets.front(), head_line - file);
+    std::vector<std::function<bool(CheckpointWriter&)>> jobs;
+    jobs.push_back([&](CheckpointWriter& w) {
+        ShardScanSummary head;
+        if (!session.scan_shard(vcd_path, 0, head_end, head))
+            return false;
+        write_scan_summary(w, head);
+        return true;
+    });
+    std::vector<std::string> results;
+    ShardScanSummary head;
+    if (!run_workers(jobs, results) || !read_scan_summary(results[0], head)) {
+        std::cerr << "Error: Sample baseline scan failed" << std::endl;
+        return false;
+    }
+    const SignalState baseline = head.advance(ShardBoundaryState()).signal_state;
+
+    // 3. 每個視窗一個 worker, 同時執行的數量不超過 CPU 數
+    jobs.clear();
+    for (unsigned k = 0; k < window_count; ++k) {
+        jobs.push_back([&, k](CheckpointWriter& w) {
+            if (!session.analyze_sample_window(vcd_path, begin_offsets[k], end_offsets[k], baseline, header_end, file + begin_offsets[k]))
+                return false;
+            session.save_shard_result(w);
+            return true;
+        });
+    }
+    const long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (!run_workers(jobs, results, static_cast<std::size_t>(std::max(1L, cpus)))) {
+        std::cerr << "Error: Sample window analysis failed" << std::endl;
+        return false;
+    }
+    return session.merge_sample_results(results, summary.windows);
+}
+
+}  // namespace APBSystem
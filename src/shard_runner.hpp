@@ -0,0 +1,37 @@
+// shard_runner.hpp
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "analysis_session.hpp"
+
+namespace APBSystem {
+
+// 把 VCD 標頭之後的內容切成 shard_count 段, 每段從一行 #timestamp 開始
+// offsets[0] 為 0 (第一段從檔案開頭解析); 檔案太小時回傳的段數可能少於 shard_count
+bool find_shard_boundaries(const std::string& vcd_path, unsigned shard_count, std::vector<uint64_t>& offsets);
+
+// --- 時間切片的多 process 分析 ---
+// 1. 每個 worker 只解析訊號 (不分析) 自己的切片, 回報切片結尾的訊號狀態與 PCLK edge 數
+// 2. 由前面切片的結果組合出每個切片開始時的狀態, 每個 worker 從切片開始後的第一個 idle edge 分析到
+//    切片結尾之後的第一個 idle edge (兩個 idle edge 之間不會有進行中的 transfer)
+// 3. 依序合併各切片的 Statistics 與 transaction 到 session
+// 無法保證與單一 process 結果相同時 (FST 輸入, 切片邊界對不上, 依賴前一段的 PSTRB 部分寫入 ...)
+// 在 stderr 說明原因並改用一般的 parse_file
+bool run_sharded_analysis(AnalysisSession& session, const std::string& vcd_path, unsigned shard_count);
+
+// --- 取樣分析 (快速初步檢查) ---
+// 以 #timestamp 二分搜尋找出 windows 個時間視窗 (合計約為整段時間的 fraction), 每個視窗由一個 worker 分析
+// (同時執行的 worker 不超過 CPU 數):
+// 視窗開始時的訊號值由視窗開頭往前找 (太早的寫入以檔案開頭的狀態代替), 從之後的第一個 idle edge 開始分析
+// 各視窗的計數放在 summary.windows, 合併的結果 (錯誤清單等) 放入 session
+struct SampleOptions {
+    unsigned windows = 16;
+    double fraction = 0.01;
+    bool random_placement = false;  // false: 視窗在每一等份的中央; true: 以 seed 隨機決定位置
+    uint64_t seed = 0;
+};
+bool run_sampled_analysis(AnalysisSession& session, const std::string& vcd_path, const SampleOptions& options, SampleSummary& summary);
+
+}  // namespace APBSystem
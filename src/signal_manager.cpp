@@ -1,52 +1,117 @@
 #include "signal_manager.hpp"
 #include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
+#include "vcd_parser.hpp"
 
 namespace APBSystem {
 
 SignalManager::SignalManager() {}
 
+namespace {
+struct ApbRoleName {
+    const char* name;
+    VcdSignalPhysicalType type;
+};
+// 依名稱長度分組 (3..7), 比對時只看同長度的少數幾個名稱
+const ApbRoleName ROLE_NAMES_3[] = {{"clk", VcdSignalPhysicalType::PCLK}};
+const ApbRoleName ROLE_NAMES_4[] = {{"psel", VcdSignalPhysicalType::PSEL}};
+const ApbRoleName ROLE_NAMES_5[] = {{"rst_n", VcdSignalPhysicalType::PRESETN},
+                                    {"paddr", VcdSignalPhysicalType::PADDR},
+                                    {"pstrb", VcdSignalPhysicalType::PSTRB},  // APB4 / APB5
+                                    {"pprot", VcdSignalPhysicalType::PPROT}};
+const ApbRoleName ROLE_NAMES_6[] = {{"pwrite", VcdSignalPhysicalType::PWRITE},
+                                    {"pwdata", VcdSignalPhysicalType::PWDATA},
+                                    {"prdata", VcdSignalPhysicalType::PRDATA},
+                                    {"pready", VcdSignalPhysicalType::PREADY}};
+const ApbRoleName ROLE_NAMES_7[] = {{"penable", VcdSignalPhysicalType::PENABLE},
+                                    {"pslverr", VcdSignalPhysicalType::PSLVERR}};
+
+template <std::size_t N>
+VcdSignalPhysicalType match_role(const ApbRoleName (&names)[N], const char* name, std::size_t len) {
+    for (std::size_t i = 0; i < N; ++i) {
+        if (std::memcmp(names[i].name, name, len) == 0)
+            return names[i].type;
+    }
+    return VcdSignalPhysicalType::OTHER;
+}
+
+inline bool is_trim_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+}  // namespace
+
+VcdSignalPhysicalType SignalManager::classify_signal_name(const char* name, size_t name_len) {
+    const char* begin = name;
+    const char* end = name + name_len;
+    for (const char* p = end; p != name; --p) {
+        if (*(p - 1) == '.') {
+            begin = p;
+            break;
+        }
+    }
+    const char* bracket = static_cast<const char*>(std::memchr(begin, '[', end - begin));
+    if (bracket != nullptr)
+        end = bracket;
+    while (begin < end && is_trim_space(*begin))
+        ++begin;
+    while (end > begin && is_trim_space(*(end - 1)))
+        --end;
+
+    switch (end - begin) {
+        case 3:
+            return match_role(ROLE_NAMES_3, begin, 3);
+        case 4:
+            return match_role(ROLE_NAMES_4, begin, 4);
+        case 5:
+            return match_role(ROLE_NAMES_5, begin, 5);
+        case 6:
+            return match_role(ROLE_NAMES_6, begin, 6);
+        case 7:
+            return match_role(ROLE_NAMES_7, begin, 7);
+        default:
+            return VcdSignalPhysicalType::OTHER;
+    }
+}
+
 VcdSignalPhysicalType SignalManager::deduce_physical_type_from_name(const std::string& hierarchical_name, const std::string& vcd_type_str) {
     if (vcd_type_str == "parameter")
         return VcdSignalPhysicalType::PARAMETER;
+    return classify_signal_name(hierarchical_name.data(), hierarchical_name.size());
+}
 
-    std::string name_suffix;
-    size_t last_dot = hierarchical_name.find_last_of('.');
-    if (last_dot != std::string::npos) {
-        name_suffix = hierarchical_name.substr(last_dot + 1);
-    } else {
-        name_suffix = hierarchical_name;
-    }
-
-    size_t bracket_pos = name_suffix.find('[');
-    if (bracket_pos != std::string::npos) {
-        name_suffix = name_suffix.substr(0, bracket_pos);
-    }
-
-    name_suffix.erase(0, name_suffix.find_first_not_of(" \t\n\r\f\v"));
-    name_suffix.erase(name_suffix.find_last_not_of(" \t\n\r\f\v") + 1);
-
-    if (name_suffix == "clk")
-        return VcdSignalPhysicalType::PCLK;
-    if (name_suffix == "rst_n")
-        return VcdSignalPhysicalType::PRESETN;
-    if (name_suffix == "paddr")
-        return VcdSignalPhysicalType::PADDR;
-    if (name_suffix == "pwrite")
-        return VcdSignalPhysicalType::PWRITE;
-    if (name_suffix == "psel")
-        return VcdSignalPhysicalType::PSEL;
-    if (name_suffix == "penable")
-        return VcdSignalPhysicalType::PENABLE;
-    if (name_suffix == "pwdata")
-        return VcdSignalPhysicalType::PWDATA;
-    if (name_suffix == "prdata")
-        return VcdSignalPhysicalType::PRDATA;
-    if (name_suffix == "pready")
-        return VcdSignalPhysicalType::PREADY;
+VcdSignalInfo SignalManager::make_signal_info(const std::string& type_str,
+                                              int width,
+                                              const std::string& hierarchical_name) {
+    return make_signal_info(deduce_physical_type_from_name(hierarchical_name, type_str), width, hierarchical_name);
+}
 
-    return VcdSignalPhysicalType::OTHER;
+VcdSignalInfo SignalManager::make_signal_info(VcdSignalPhysicalType type, int width, const std::string& hierarchical_name) {
+    VcdSignalInfo info;
+    info.hierarchical_name = hierarchical_name;
+    info.bit_width = width;
+    info.type = type;
+
+    if (info.type == VcdSignalPhysicalType::PADDR) {
+        m_paddr_width = width;
+    } else if (info.type == VcdSignalPhysicalType::PWDATA) {
+        m_pwdata_width = width;
+    }
+    return info;
+}
+
+void SignalManager::store_signal(const std::string& vcd_id_code, const VcdSignalInfo& signal_info) {
+    VcdSignalInfo& info = m_signal_definitions[vcd_id_code];
+    info = signal_info;
+    m_registered_roles |= 1u << static_cast<int>(signal_info.type);
+    // unordered_map 的元素位址在 rehash 後仍然有效, 可以直接放進 dense table
+    int slot = short_id_slot(vcd_id_code.data(), vcd_id_code.size());
+    if (slot >= 0) {
+        if (m_short_id_table.empty())
+            m_short_id_table.assign(SHORT_ID_TABLE_SIZE, nullptr);
+        m_short_id_table[slot] = &info;
+    }
 }
 
 void SignalManager::register_signal(const std::string& vcd_id_code,
@@ -56,18 +121,37 @@ void SignalManager::register_signal(const std::string& vcd_id_code,
     if (vcd_id_code.empty()) {
         return;
     }
-    VcdSignalInfo info;
-    info.hierarchical_name = hierarchical_name;
-    info.bit_width = width;
-    info.type = deduce_physical_type_from_name(hierarchical_name, type_str);
+    store_signal(vcd_id_code, make_signal_info(type_str, width, hierarchical_name));
+}
 
-    if (info.type == VcdSignalPhysicalType::PADDR) {
-        m_paddr_width = width;
-    } else if (info.type == VcdSignalPhysicalType::PWDATA) {
-        m_pwdata_width = width;
+void SignalManager::register_var(const VcdVarDefinition& definition) {
+    if (definition.id_len == 0)
+        return;
+    VcdSignalPhysicalType type = definition.type_len == 9 && std::memcmp(definition.type, "parameter", 9) == 0
+                                     ? VcdSignalPhysicalType::PARAMETER
+                                     : classify_signal_name(definition.name, definition.name_len);
+    if (type == VcdSignalPhysicalType::OTHER || type == VcdSignalPhysicalType::PARAMETER) {
+        // 非 APB 訊號不建立項目, value change 查不到 id 時一樣直接略過;
+        // 只有同一個 id 先前被宣告成 APB 訊號 (alias) 時才需要覆蓋成新的類型
+        if (!m_signal_definitions.empty()) {
+            auto it = m_signal_definitions.find(definition.id_string());
+            if (it != m_signal_definitions.end())
+                it->second = make_signal_info(type, definition.width, definition.hierarchical_name());
+        }
+        return;
     }
+    store_signal(definition.id_string(), make_signal_info(type, definition.width, definition.hierarchical_name()));
+}
 
-    m_signal_definitions[vcd_id_code] = info;
+bool SignalManager::register_indexed_signal(uint32_t signal_index,
+                                            const std::string& type_str,
+                                            int width,
+                                            const std::string& hierarchical_name) {
+    if (signal_index >= m_indexed_signals.size())
+        m_indexed_signals.resize(signal_index + 1);
+    VcdSignalInfo& info = m_indexed_signals[signal_index];
+    info = make_signal_info(type_str, width, hierarchical_name);
+    return info.type != VcdSignalPhysicalType::OTHER && info.type != VcdSignalPhysicalType::PARAMETER;
 }
 
 int SignalManager::get_paddr_width() const {
@@ -110,68 +194,185 @@ uint32_t SignalManager::parse_vcd_value_to_uint(const char* value_ptr, size_t va
 }
 
 bool SignalManager::update_state_on_signal_change(
-    char vcd_id_char,
+    const char* vcd_id,
+    size_t vcd_id_len,
     const char* value_ptr,
     size_t value_len,
     SignalState& current_overall_state,
     bool& previous_pclk_val) {
-    std::string id_str(1, vcd_id_char);
-    auto it = m_signal_definitions.find(id_str);
-    if (it == m_signal_definitions.end()) {
+    // 不認得的 id 與非 APB 訊號 (例如 filler) 在這裡就結束, 不需要解析值
+    const VcdSignalInfo* info = find_apb_signal(vcd_id, vcd_id_len);
+    if (info == nullptr) {
         return false;
     }
-    const VcdSignalInfo& sig_info = it->second;
+    const VcdSignalInfo& sig_info = *info;
 
     bool val_has_x = false;
     uint32_t new_uint_val = parse_vcd_value_to_uint(value_ptr, value_len, val_has_x);
+    return apply_value_to_state(sig_info, new_uint_val, val_has_x, current_overall_state, previous_pclk_val);
+}
+
+const VcdSignalInfo* SignalManager::find_apb_signal(const char* vcd_id, size_t vcd_id_len) const {
+    const VcdSignalInfo* info = nullptr;
+    int slot = short_id_slot(vcd_id, vcd_id_len);
+    if (slot >= 0 && !m_short_id_table.empty()) {
+        info = m_short_id_table[slot];
+    } else if (slot < 0) {
+        auto it = m_signal_definitions.find(std::string(vcd_id, vcd_id_len));
+        if (it != m_signal_definitions.end())
+            info = &it->second;
+    }
+    if (info == nullptr || info->type == VcdSignalPhysicalType::OTHER || info->type == VcdSignalPhysicalType::PARAMETER)
+        return nullptr;
+    return info;
+}
+
+void SignalManager::stage_signal_change(const char* vcd_id, size_t vcd_id_len, const char* value_ptr, size_t value_len) {
+    const VcdSignalInfo* info = find_apb_signal(vcd_id, vcd_id_len);
+    if (info == nullptr)
+        return;
+    const int role = static_cast<int>(info->type);
+    StagedChange& change = m_staged[role];
+    change.info = info;
+    change.len = value_len;
+    // 大部分是 1 個字元的 scalar (PCLK / 控制訊號), 不需要呼叫 memcpy
+    if (value_len == 1)
+        change.text[0] = *value_ptr;
+    else if (value_len <= STAGED_VALUE_INLINE_BYTES)
+        std::memcpy(change.text, value_ptr, value_len);
+    else
+        change.long_text.assign(value_ptr, value_len);
+    m_staged_mask |= 1u << role;
+}
+
+void SignalManager::apply_staged_change(const StagedChange& change, SignalState& current_overall_state, bool& previous_pclk_val, bool& pclk_rose) {
+    bool val_has_x = false;
+    uint32_t new_uint_val = parse_vcd_value_to_uint(change.data(), change.len, val_has_x);
+    pclk_rose = apply_value_to_state(*change.info, new_uint_val, val_has_x, current_overall_state, previous_pclk_val) || pclk_rose;
+}
+
+void SignalManager::commit_staged_non_clock(SignalState& current_overall_state, bool& previous_pclk_val) {
+    bool pclk_rose = false;
+    for (uint32_t pending = m_staged_mask & ~STAGED_PCLK_BIT; pending; pending &= pending - 1)
+        apply_staged_change(m_staged[__builtin_ctz(pending)], current_overall_state, previous_pclk_val, pclk_rose);
+}
 
+bool SignalManager::update_state_from_decoded_value(
+    uint32_t signal_index,
+    uint32_t value,
+    uint32_t xmask,
+    SignalState& current_overall_state,
+    bool& previous_pclk_val) {
+    if (signal_index >= m_indexed_signals.size()) {
+        return false;
+    }
+    return apply_value_to_state(m_indexed_signals[signal_index], value, xmask != 0, current_overall_state, previous_pclk_val);
+}
+
+namespace {
+// 1-bit 控制訊號: 值與 X 旗標一次寫回 flags
+inline void set_control_bit(SignalState& state, uint32_t value_bit, uint32_t x_bit, uint32_t new_uint_val, bool val_has_x) {
+    uint32_t bits = (new_uint_val != 0 ? value_bit : 0) | (val_has_x ? x_bit : 0);
+    state.flags = (state.flags & ~(value_bit | x_bit)) | bits;
+}
+inline void set_bus_value(SignalState& state, SignalValueIndex index, uint32_t x_bit, uint32_t new_uint_val, bool val_has_x) {
+    state.values[index] = new_uint_val;
+    state.set(x_bit, val_has_x);
+}
+}  // namespace
+
+bool SignalManager::apply_value_to_state(const VcdSignalInfo& sig_info,
+                                         uint32_t new_uint_val,
+                                         bool val_has_x,
+                                         SignalState& current_overall_state,
+                                         bool& previous_pclk_val) {
     bool pclk_rose_this_event = false;
     switch (sig_info.type) {
         case VcdSignalPhysicalType::PCLK: {
             bool new_pclk_state = (new_uint_val != 0);
+            if (!(m_written_roles & (1u << static_cast<int>(VcdSignalPhysicalType::PCLK))))
+                m_first_pclk_value = new_pclk_state;
             if (new_pclk_state && !previous_pclk_val) {
                 pclk_rose_this_event = true;
             }
-            current_overall_state.pclk = new_pclk_state;
+            current_overall_state.set(STATE_PCLK, new_pclk_state);
             previous_pclk_val = new_pclk_state;
         } break;
         case VcdSignalPhysicalType::PRESETN:
-            current_overall_state.presetn = (new_uint_val != 0);
+            current_overall_state.set(STATE_PRESETN, new_uint_val != 0);
             break;
         case VcdSignalPhysicalType::PADDR:
-            current_overall_state.paddr = new_uint_val;
-            current_overall_state.paddr_has_x = val_has_x;
+            set_bus_value(current_overall_state, VALUE_PADDR, STATE_PADDR_X, new_uint_val, val_has_x);
             break;
         case VcdSignalPhysicalType::PWRITE:
-            current_overall_state.pwrite = (new_uint_val != 0);
-            current_overall_state.pwrite_has_x = val_has_x;
+            set_control_bit(current_overall_state, STATE_PWRITE, STATE_PWRITE_X, new_uint_val, val_has_x);
             break;
         case VcdSignalPhysicalType::PSEL:
-            current_overall_state.psel = (new_uint_val != 0);
-            current_overall_state.psel_has_x = val_has_x;
+            set_control_bit(current_overall_state, STATE_PSEL, STATE_PSEL_X, new_uint_val, val_has_x);
             break;
         case VcdSignalPhysicalType::PENABLE:
-            current_overall_state.penable = (new_uint_val != 0);
-            current_overall_state.penable_has_x = val_has_x;
+            set_control_bit(current_overall_state, STATE_PENABLE, STATE_PENABLE_X, new_uint_val, val_has_x);
             break;
         case VcdSignalPhysicalType::PWDATA:
-            current_overall_state.pwdata = new_uint_val;
-            current_overall_state.pwdata_has_x = val_has_x;
+            set_bus_value(current_overall_state, VALUE_PWDATA, STATE_PWDATA_X, new_uint_val, val_has_x);
             break;
         case VcdSignalPhysicalType::PRDATA:
-            current_overall_state.prdata = new_uint_val;
-            current_overall_state.prdata_has_x = val_has_x;
+            set_bus_value(current_overall_state, VALUE_PRDATA, STATE_PRDATA_X, new_uint_val, val_has_x);
             break;
         case VcdSignalPhysicalType::PREADY:
-            current_overall_state.pready = (new_uint_val != 0);
-            current_overall_state.pready_has_x = val_has_x;
+            set_control_bit(current_overall_state, STATE_PREADY, STATE_PREADY_X, new_uint_val, val_has_x);
+            break;
+        case VcdSignalPhysicalType::PSTRB:
+            current_overall_state.flags = (current_overall_state.flags & ~(APB4_PSTRB_MASK | STATE_PSTRB_X)) |
+                                          ((new_uint_val << APB4_PSTRB_SHIFT) & APB4_PSTRB_MASK) | (val_has_x ? static_cast<uint32_t>(STATE_PSTRB_X) : 0u);
+            break;
+        case VcdSignalPhysicalType::PPROT:
+            current_overall_state.flags = (current_overall_state.flags & ~APB4_PPROT_MASK) |
+                                          ((new_uint_val << APB4_PPROT_SHIFT) & APB4_PPROT_MASK);
+            break;
+        case VcdSignalPhysicalType::PSLVERR:
+            set_control_bit(current_overall_state, STATE_PSLVERR, STATE_PSLVERR_X, new_uint_val, val_has_x);
             break;
         default:
             break;
     }
+    m_written_roles |= 1u << static_cast<int>(sig_info.type);
     return pclk_rose_this_event;
 }
 
+namespace {
+// 每個角色在 SignalState 中佔用的 flags 位元與 values 欄位 (-1: 沒有)
+struct RoleFields {
+    uint32_t flags;
+    int value_index;
+};
+const RoleFields ROLE_FIELDS[] = {
+    {STATE_PCLK, -1},                              // PCLK
+    {STATE_PRESETN, -1},                           // PRESETN
+    {STATE_PADDR_X, VALUE_PADDR},                  // PADDR
+    {STATE_PWRITE | STATE_PWRITE_X, -1},           // PWRITE
+    {STATE_PSEL | STATE_PSEL_X, -1},               // PSEL
+    {STATE_PENABLE | STATE_PENABLE_X, -1},         // PENABLE
+    {STATE_PWDATA_X, VALUE_PWDATA},                // PWDATA
+    {STATE_PRDATA_X, VALUE_PRDATA},                // PRDATA
+    {STATE_PREADY | STATE_PREADY_X, -1},           // PREADY
+    {APB4_PSTRB_MASK | STATE_PSTRB_X, -1},         // PSTRB
+    {APB4_PPROT_MASK, -1},                         // PPROT
+    {STATE_PSLVERR | STATE_PSLVERR_X, -1}};        // PSLVERR
+}  // namespace
+
+void SignalManager::copy_role_fields(uint32_t roles, const SignalState& from, SignalState& to) {
+    static_assert(sizeof(ROLE_FIELDS) / sizeof(ROLE_FIELDS[0]) == APB_ROLE_COUNT, "ROLE_FIELDS must cover every APB role");
+    for (int role = 0; role < APB_ROLE_COUNT; ++role) {
+        if (!(roles & (1u << role)))
+            continue;
+        const RoleFields& fields = ROLE_FIELDS[role];
+        to.flags = (to.flags & ~fields.flags) | (from.flags & fields.flags);
+        if (fields.value_index >= 0)
+            to.values[fields.value_index] = from.values[fields.value_index];
+    }
+}
+
 const VcdSignalInfo* SignalManager::get_signal_info_by_vcd_id(const std::string& vcd_id_code) const {
     auto it = m_signal_definitions.find(vcd_id_code);
     if (it != m_signal_definitions.end()) {
@@ -8,6 +8,8 @@
 
 namespace APBSystem {
 
+struct VcdVarDefinition;
+
 class SignalManager {
    public:
     SignalManager();
@@ -16,26 +18,129 @@ class SignalManager {
                          const std::string& type_str,
                          int width,
                          const std::string& hierarchical_name);
+    // 直接使用 parser 的 $var 欄位: 先以最後一層名稱判斷角色, 只有 APB 訊號才組出完整名稱並建立項目
+    void register_var(const VcdVarDefinition& definition);
 
     bool update_state_on_signal_change(
-        char vcd_id_char,
+        const char* vcd_id,
+        size_t vcd_id_len,
         const char* value_ptr,
         size_t value_len,
         SignalState& current_overall_state,
         bool& previous_pclk_val);
 
+    // --- timestamp 合併模式: 同一個 #time 內每個 APB 角色只保留最後一個值字串, 整段結束時才解碼 ---
+    // 同一個角色的訊號寫入的是同一個 SignalState 欄位, 依角色合併與逐行套用的最終狀態相同
+    void stage_signal_change(const char* vcd_id, size_t vcd_id_len, const char* value_ptr, size_t value_len);
+    bool has_staged_changes() const { return m_staged_mask != 0; }
+    // 只套用暫存的 PCLK 值; 回傳 pclk 是否由 0 變 1
+    bool commit_staged_clock(SignalState& current_overall_state, bool& previous_pclk_val) {
+        if (!(m_staged_mask & STAGED_PCLK_BIT))
+            return false;
+        bool pclk_rose = false;
+        apply_staged_change(m_staged[static_cast<int>(VcdSignalPhysicalType::PCLK)], current_overall_state, previous_pclk_val, pclk_rose);
+        return pclk_rose;
+    }
+    // 套用 PCLK 以外的暫存值 (大部分的 timestamp 只有 PCLK 變化)
+    void commit_staged_signals(SignalState& current_overall_state, bool& previous_pclk_val) {
+        if (m_staged_mask & ~STAGED_PCLK_BIT)
+            commit_staged_non_clock(current_overall_state, previous_pclk_val);
+    }
+    void clear_staged_changes() { m_staged_mask = 0; }
+
+    // --- 二進位 value-change feed: 以 signal index 取代 VCD id, 值已經解碼 ---
+    // 回傳這個 index 是否為 APB 訊號 (FST 只解碼這些訊號的波形)
+    bool register_indexed_signal(uint32_t signal_index,
+                                 const std::string& type_str,
+                                 int width,
+                                 const std::string& hierarchical_name);
+    bool is_indexed_clock(uint32_t signal_index) const {
+        return signal_index < m_indexed_signals.size() && m_indexed_signals[signal_index].type == VcdSignalPhysicalType::PCLK;
+    }
+    bool update_state_from_decoded_value(
+        uint32_t signal_index,
+        uint32_t value,
+        uint32_t xmask,
+        SignalState& current_overall_state,
+        bool& previous_pclk_val);
+
+    // 將 VCD 值字串轉成 uint32 (超過 32 bit 只保留低位元); 不依賴任何狀態, 方便單獨量測
+    static uint32_t parse_vcd_value_to_uint(const char* value_ptr, size_t value_len, bool& out_has_x_or_z);
+    // 名稱最後一個 '.' 之後、'[' 之前的部分 (去掉前後空白) 對應的 APB 角色
+    static VcdSignalPhysicalType classify_signal_name(const char* name, size_t name_len);
+
+    // --- 時間切片掃描: 記錄寫入過的 APB 角色 (bit i: VcdSignalPhysicalType i) 與第一個寫入的 PCLK 值 ---
+    void reset_written_roles() {
+        m_written_roles = 0;
+        m_first_pclk_value = false;
+    }
+    uint32_t get_written_roles() const { return m_written_roles; }
+    bool get_first_pclk_value() const { return m_first_pclk_value; }
+    // VCD 標頭中出現的 APB 角色 (bit i: VcdSignalPhysicalType i)
+    uint32_t get_registered_roles() const { return m_registered_roles; }
+    // 把 roles 中每個角色在 SignalState 裡的欄位 (值與 X 旗標) 從 from 複製到 to
+    static void copy_role_fields(uint32_t roles, const SignalState& from, SignalState& to);
+
     const VcdSignalInfo* get_signal_info_by_vcd_id(const std::string& vcd_id_code) const;
     int get_paddr_width() const;
     int get_pwdata_width() const;
 
    private:
+    // 1~2 個字元的 VCD id ('!'..'~') 直接換算成 dense table 的索引, 較長的 id 才查 hash map
+    static const int VCD_ID_RADIX = 94;
+    static const int SHORT_ID_TABLE_SIZE = VCD_ID_RADIX + VCD_ID_RADIX * VCD_ID_RADIX;
+    static int short_id_slot(const char* id, size_t len) {
+        if (len == 0 || len > 2)
+            return -1;
+        unsigned c0 = static_cast<unsigned char>(id[0]) - 33u;
+        if (len == 1)
+            return c0 < VCD_ID_RADIX ? static_cast<int>(c0) : -1;
+        if (len == 2) {
+            unsigned c1 = static_cast<unsigned char>(id[1]) - 33u;
+            if (c0 < VCD_ID_RADIX && c1 < VCD_ID_RADIX)
+                return VCD_ID_RADIX + static_cast<int>(c0 * VCD_ID_RADIX + c1);
+        }
+        return -1;
+    }
+
+    // 依 id 找 APB 訊號; 不認得的 id 與 OTHER / PARAMETER 回傳 nullptr
+    const VcdSignalInfo* find_apb_signal(const char* vcd_id, size_t vcd_id_len) const;
+
+    static const int APB_ROLE_COUNT = static_cast<int>(VcdSignalPhysicalType::PARAMETER);
+    static const size_t STAGED_VALUE_INLINE_BYTES = 64;
+    struct StagedChange {
+        const VcdSignalInfo* info;
+        size_t len;
+        char text[STAGED_VALUE_INLINE_BYTES];
+        std::string long_text;  // 超過 inline 大小的值 (很寬的 bus)
+        const char* data() const { return len <= STAGED_VALUE_INLINE_BYTES ? text : long_text.data(); }
+    };
+    static const uint32_t STAGED_PCLK_BIT = 1u << static_cast<int>(VcdSignalPhysicalType::PCLK);
+    void apply_staged_change(const StagedChange& change, SignalState& current_overall_state, bool& previous_pclk_val, bool& pclk_rose);
+    void commit_staged_non_clock(SignalState& current_overall_state, bool& previous_pclk_val);
+    StagedChange m_staged[APB_ROLE_COUNT];
+    uint32_t m_staged_mask{0};  // bit i: m_staged[i] 有這個 timestamp 的值
+
     std::unordered_map<std::string, VcdSignalInfo> m_signal_definitions;
+    std::vector<const VcdSignalInfo*> m_short_id_table;
+    std::vector<VcdSignalInfo> m_indexed_signals;
+
+    uint32_t m_registered_roles{0};
+    uint32_t m_written_roles{0};
+    bool m_first_pclk_value{false};
 
     int m_paddr_width{32};
     int m_pwdata_width{32};
     VcdSignalPhysicalType deduce_physical_type_from_name(const std::string& hierarchical_name, const std::string& vcd_type_str);
 
-    uint32_t parse_vcd_value_to_uint(const char* value_ptr, size_t value_len, bool& out_has_x_or_z);
+    VcdSignalInfo make_signal_info(const std::string& type_str, int width, const std::string& hierarchical_name);
+    VcdSignalInfo make_signal_info(VcdSignalPhysicalType type, int width, const std::string& hierarchical_name);
+    void store_signal(const std::string& vcd_id_code, const VcdSignalInfo& info);
+    bool apply_value_to_state(const VcdSignalInfo& sig_info,
+                              uint32_t new_uint_val,
+                              bool val_has_x,
+                              SignalState& current_overall_state,
+                              bool& previous_pclk_val);
 };
 
 }  // namespace APBSystem
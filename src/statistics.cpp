@@ -1,12 +1,35 @@
 #include "statistics.hpp"
 #include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <iostream>
 #include <set>
+#include <thread>
+#include "checkpoint.hpp"
 
 namespace APBSystem {
 
-Statistics::Statistics()
-    : m_read_transactions_no_wait(0), m_read_transactions_with_wait(0), m_write_transactions_no_wait(0), m_write_transactions_with_wait(0), m_total_pclk_edges_for_read_transactions(0), m_total_pclk_edges_for_write_transactions(0), m_bus_active_pclk_edges(0), m_total_simulation_pclk_edges(0), m_cpu_elapsed_time_ms(0.0), m_first_valid_pclk_edge_for_stats(0) {}
+Statistics::Statistics(MonotonicArena* arena)
+    : m_arena(arena), m_read_transactions_no_wait(0), m_read_transactions_with_wait(0), m_write_transactions_no_wait(0), m_write_transactions_with_wait(0), m_total_pclk_edges_for_read_transactions(0), m_total_pclk_edges_for_write_transactions(0), m_bus_active_pclk_edges(0), m_total_simulation_pclk_edges(0), m_cpu_elapsed_time_ms(0.0), m_first_valid_pclk_edge_for_stats(0),
+      m_completer_bit_activity_map(0, std::hash<CompleterID>(), std::equal_to<CompleterID>(), ArenaAllocator<char>(arena)),
+      m_out_of_range_details(ArenaAllocator<char>(arena)),
+      m_timeout_error_details(ArenaAllocator<char>(arena)),
+      m_read_write_overlap_details(ArenaAllocator<char>(arena)),
+      m_data_mirroring_details(ArenaAllocator<char>(arena)),
+      m_protocol_violation_details(ArenaAllocator<char>(arena)),
+      m_latency_histograms(ArenaAllocator<char>(arena)),
+      m_shadow_memories(0, std::hash<CompleterID>(), std::equal_to<CompleterID>(), ArenaAllocator<char>(arena)),
+      m_reverse_write_lookup(0, std::hash<uint32_t>(), std::equal_to<uint32_t>(), ArenaAllocator<char>(arena)),
+      m_deferred_mirroring_checks(ArenaAllocator<char>(arena)) {
+    m_protocol_violation_counts.fill(0);
+    m_slave_error_counts.fill(0);
+}
+Statistics::ShadowMemory& Statistics::shadow_memory_for(CompleterID completer) {
+    auto it = m_shadow_memories.find(completer);
+    if (it == m_shadow_memories.end())
+        it = m_shadow_memories.emplace(completer, ShadowMemory(0, std::hash<uint32_t>(), std::equal_to<uint32_t>(), ArenaAllocator<char>(m_arena))).first;
+    return it->second;
+}
 bool Statistics::is_completer_corrupted(CompleterID cid) {
     auto it = m_completer_bit_activity_map.find(cid);
     if (it == m_completer_bit_activity_map.end())
@@ -14,11 +37,11 @@ bool Statistics::is_completer_corrupted(CompleterID cid) {
 
     const auto& activity = it->second;
     for (const auto& detail : activity.paddr_bit_details) {
-        if (detail.status == BitConnectionStatus::SHORTED)
+        if (detail.status != BitConnectionStatus::CORRECT)
             return true;
     }
     for (const auto& detail : activity.pwdata_bit_details) {
-        if (detail.status == BitConnectionStatus::SHORTED)
+        if (detail.status != BitConnectionStatus::CORRECT)
             return true;
     }
     return false;
@@ -41,34 +64,55 @@ void Statistics::record_accessed_completer(CompleterID completer_id) {
             m_accessed_completer_ids_set.insert(completer_id);
             m_ordered_accessed_completers.push_back(completer_id);
         }
-        CompleterBitActivity activity;
-        activity.resize(m_paddr_width, m_pwdata_width);
+        CompleterBitActivity activity{ArenaAllocator<char>(m_arena)};
+        activity.resize(m_paddr_width, m_pwdata_width, m_incremental_corruption_analysis);
         m_completer_bit_activity_map.emplace(completer_id, std::move(activity));
     }
 }
+namespace {
+// 增量模式: 只走訪還沒判定的 pair. 某個 pair 第一次出現 01/10 時仍然計數 (保留獨立變化的證據),
+// 之後就從 undecided 移除, 它的計數不再影響短路判定
+void record_bit_pairs(BitPairMatrix& m, PairVerdictTracker& tracker, int width, uint32_t value) {
+    if (!tracker.incremental) {
+        tracker.observe(value);
+        // 值只保留低 32 bit; 更寬的 bus (只會走完整計數) 高位元視為 0, 不能直接位移 32 以上
+        const uint64_t bits = value;
+        for (int i = 0; i < width; ++i) {
+            for (int j = i + 1; j < width; ++j) {
+                bool bit_i_val = (bits >> i) & 1;
+                bool bit_j_val = (bits >> j) & 1;
+                m[i][j][(bit_i_val << 1) | bit_j_val]++;
+            }
+        }
+        return;
+    }
+    tracker.observe(value);
+    for (uint32_t rows = tracker.undecided_rows; rows; rows &= rows - 1) {
+        const int i = __builtin_ctz(rows);
+        const uint32_t bit_i_val = (value >> i) & 1;
+        uint32_t& cols = tracker.undecided[i];
+        for (uint32_t c = cols; c; c &= c - 1) {
+            const int j = __builtin_ctz(c);
+            m[i][j][(bit_i_val << 1) | ((value >> j) & 1)]++;
+        }
+        cols &= bit_i_val ? value : ~value;
+        if (cols == 0)
+            tracker.undecided_rows &= ~(1u << i);
+    }
+}
+}  // namespace
+
 void Statistics::record_paddr_for_corruption_analysis(CompleterID completer, uint32_t paddr_value) {
     if (completer == CompleterID::NONE || completer == CompleterID::UNKNOWN_COMPLETER)
         return;
     auto& activity = m_completer_bit_activity_map.at(completer);
-    for (int i = 0; i < m_paddr_width; ++i) {
-        for (int j = i + 1; j < m_paddr_width; ++j) {
-            bool bit_i_val = (paddr_value >> i) & 1;
-            bool bit_j_val = (paddr_value >> j) & 1;
-            activity.paddr_combinations[i][j][(bit_i_val << 1) | bit_j_val]++;
-        }
-    }
+    record_bit_pairs(activity.paddr_combinations, activity.paddr_tracker, m_paddr_width, paddr_value);
 }
 void Statistics::record_pwdata_for_corruption_analysis(CompleterID completer, uint32_t pwdata_value) {
     if (completer == CompleterID::NONE || completer == CompleterID::UNKNOWN_COMPLETER)
         return;
     auto& activity = m_completer_bit_activity_map.at(completer);
-    for (int i = 0; i < m_pwdata_width; ++i) {
-        for (int j = i + 1; j < m_pwdata_width; ++j) {
-            bool bit_i_val = (pwdata_value >> i) & 1;
-            bool bit_j_val = (pwdata_value >> j) & 1;
-            activity.pwdata_combinations[i][j][(bit_i_val << 1) | bit_j_val]++;
-        }
-    }
+    record_bit_pairs(activity.pwdata_combinations, activity.pwdata_tracker, m_pwdata_width, pwdata_value);
 }
 
 void Statistics::check_for_data_mirroring(CompleterID completer, uint32_t paddr, uint32_t prdata, uint64_t timestamp) {
@@ -78,78 +122,181 @@ void Statistics::check_for_data_mirroring(CompleterID completer, uint32_t paddr,
     static const std::set<uint32_t> special_input_registers = {0x1A101008, 0x1A100014};
     if (special_input_registers.count(paddr))
         return;
-    if (m_shadow_memories[completer].count(paddr))
+    auto memory = m_shadow_memories.find(completer);
+    if (memory != m_shadow_memories.end() && memory->second.count(paddr))
         return;
-    if (m_reverse_write_lookup.count(prdata)) {
-        const auto& original_write = m_reverse_write_lookup.at(prdata);
-        if (original_write.address != paddr) {
-            record_data_mirroring({timestamp, paddr, prdata, original_write.address, original_write.timestamp});
+    auto original_write = m_reverse_write_lookup.find(prdata);
+    if (m_shard_mode) {
+        DeferredMirroringCheck check = {timestamp, paddr, prdata, completer, false, {0, 0}};
+        if (original_write != m_reverse_write_lookup.end()) {
+            check.has_local_source = true;
+            check.local_source = original_write->second;
         }
+        m_deferred_mirroring_checks.push_back(check);
+        return;
+    }
+    if (original_write != m_reverse_write_lookup.end() && original_write->second.address != paddr) {
+        record_data_mirroring({timestamp, paddr, prdata, original_write->second.address, original_write->second.timestamp});
     }
 }
 
-void Statistics::finalize_bit_activity() {
-    const int MIN_EVIDENCE_COUNT = 1;
-    for (auto& kv : m_completer_bit_activity_map) {
-        auto& act = kv.second;
-        // PADDR 分析 (只檢查 a0-a11 的相鄰位元)
-        {
-            std::vector<std::pair<int, int>> candidate_pairs;
-            for (int i = 0; i < 11; ++i) {
-                int j = i + 1;
-                const auto& counts = act.paddr_combinations[i][j];
-                bool has_independent_evidence = (counts[1] > 0) || (counts[2] > 0);
-                bool has_sufficient_sync_evidence = (counts[0] >= MIN_EVIDENCE_COUNT) && (counts[3] >= MIN_EVIDENCE_COUNT);
-                if (!has_independent_evidence && has_sufficient_sync_evidence) {
-                    candidate_pairs.push_back({i, j});
-                }
-            }
-            if (candidate_pairs.size() == 1) {
-                int bit_a = candidate_pairs[0].first;
-                int bit_b = candidate_pairs[0].second;
-                act.paddr_bit_details[bit_a].status = BitConnectionStatus::SHORTED;
-                act.paddr_bit_details[bit_a].shorted_with_bit_index = bit_b;
-                act.paddr_bit_details[bit_b].status = BitConnectionStatus::SHORTED;
-                act.paddr_bit_details[bit_b].shorted_with_bit_index = bit_a;
-            }
+namespace {
+const int MIN_EVIDENCE_COUNT = 1;
+// 延伸分析允許多組短路, 需要更多同步證據才成立
+const int EXTENDED_MIN_EVIDENCE_COUNT = 4;
+const uint64_t STUCK_AT_MIN_SAMPLES = 16;
+
+void mark_shorted(ArenaVector<BitDetailStatus>& details, int bit_a, int bit_b) {
+    details[bit_a].status = BitConnectionStatus::SHORTED;
+    details[bit_a].shorted_with_bit_index = bit_b;
+    details[bit_b].status = BitConnectionStatus::SHORTED;
+    details[bit_b].shorted_with_bit_index = bit_a;
+}
+
+bool is_short_candidate(const std::array<int, 4>& counts, int min_evidence) {
+    bool has_independent_evidence = (counts[1] > 0) || (counts[2] > 0);
+    bool has_sufficient_sync_evidence = (counts[0] >= min_evidence) && (counts[3] >= min_evidence);
+    return !has_independent_evidence && has_sufficient_sync_evidence;
+}
+
+// 原本的規則: 只看前 pair_limit 組相鄰位元, 恰好一組候選時才判定短路
+void analyze_adjacent_pairs(const BitPairMatrix& m, ArenaVector<BitDetailStatus>& details, int pair_limit) {
+    std::vector<std::pair<int, int>> candidate_pairs;
+    for (int i = 0; i < pair_limit; ++i) {
+        if (is_short_candidate(m[i][i + 1], MIN_EVIDENCE_COUNT))
+            candidate_pairs.push_back({i, i + 1});
+    }
+    if (candidate_pairs.size() == 1)
+        mark_shorted(details, candidate_pairs[0].first, candidate_pairs[0].second);
+}
+
+// 延伸規則: 使用完整的 co-occurrence matrix, 找出任意位元間的多組短路與 stuck-at-0/1
+// 只處理相鄰規則之後仍是 CORRECT 的位元
+void analyze_full_matrix(const BitPairMatrix& m, const PairVerdictTracker& tracker, ArenaVector<BitDetailStatus>& details, int stuck_at_bits) {
+    const int width = static_cast<int>(m.size());
+    if (width < 2)
+        return;
+    // stuck-at: 所有樣本中該位元都是同一個值; 只有上下都有會變化的位元時才判定,
+    // 否則多半只是測試資料沒有用到 (例如只存取少數暫存器時的高位址位元)
+    if (tracker.samples >= STUCK_AT_MIN_SAMPLES) {
+        const uint32_t active = tracker.seen_ones & tracker.seen_zeros;
+        int lowest_active = active ? __builtin_ctz(active) : width;
+        int highest_active = active ? 31 - __builtin_clz(active) : -1;
+        for (int i = lowest_active + 1; i < std::min(stuck_at_bits, highest_active); ++i) {
+            if (details[i].status != BitConnectionStatus::CORRECT)
+                continue;
+            if (!((tracker.seen_ones >> i) & 1))
+                details[i].status = BitConnectionStatus::STUCK_AT_0;
+            else if (!((tracker.seen_zeros >> i) & 1))
+                details[i].status = BitConnectionStatus::STUCK_AT_1;
         }
-        // PWDATA 分析 (檢查所有相鄰位元)
-        {
-            std::vector<std::pair<int, int>> candidate_pairs;
-            for (int i = 0; i < m_pwdata_width - 1; ++i) {
-                int j = i + 1;
-                const auto& counts = act.pwdata_combinations[i][j];
-                bool has_independent_evidence = (counts[1] > 0) || (counts[2] > 0);
-                bool has_sufficient_sync_evidence = (counts[0] >= MIN_EVIDENCE_COUNT) && (counts[3] >= MIN_EVIDENCE_COUNT);
-                if (!has_independent_evidence && has_sufficient_sync_evidence) {
-                    candidate_pairs.push_back({i, j});
-                }
-            }
-            if (candidate_pairs.size() == 1) {
-                int bit_a = candidate_pairs[0].first;
-                int bit_b = candidate_pairs[0].second;
-                act.pwdata_bit_details[bit_a].status = BitConnectionStatus::SHORTED;
-                act.pwdata_bit_details[bit_a].shorted_with_bit_index = bit_b;
-                act.pwdata_bit_details[bit_b].status = BitConnectionStatus::SHORTED;
-                act.pwdata_bit_details[bit_b].shorted_with_bit_index = bit_a;
-            }
+    }
+    // 短路: 同步變化的位元併成一組, 組內其他位元都指向編號最小的位元, 最小的位元指向第二小的
+    // (已經由相鄰規則判定的位元保留原本的結果)
+    std::vector<int> group(width);
+    for (int i = 0; i < width; ++i)
+        group[i] = i;
+    for (int i = 0; i < width; ++i) {
+        if (details[i].status != BitConnectionStatus::CORRECT)
+            continue;
+        for (int j = i + 1; j < width; ++j) {
+            if (group[j] == j && details[j].status == BitConnectionStatus::CORRECT && is_short_candidate(m[i][j], EXTENDED_MIN_EVIDENCE_COUNT))
+                group[j] = group[i];
+        }
+    }
+    for (int j = 0; j < width; ++j) {
+        int root = group[j];
+        if (root == j)
+            continue;
+        details[j].status = BitConnectionStatus::SHORTED;
+        details[j].shorted_with_bit_index = root;
+        if (details[root].status != BitConnectionStatus::SHORTED) {
+            details[root].status = BitConnectionStatus::SHORTED;
+            details[root].shorted_with_bit_index = j;
         }
     }
 }
+}  // namespace
 
-void Statistics::record_read_transaction(bool h, uint64_t d) {
+void Statistics::finalize_bit_activity() {
+    // 每個 completer 的 PADDR / PWDATA 各是一個獨立的工作, 只寫入自己的 bit details
+    struct BusJob {
+        const BitPairMatrix* matrix;
+        const PairVerdictTracker* tracker;
+        ArenaVector<BitDetailStatus>* details;
+        bool is_paddr;
+    };
+    std::vector<BusJob> jobs;
+    for (auto& kv : m_completer_bit_activity_map) {
+        jobs.push_back({&kv.second.paddr_combinations, &kv.second.paddr_tracker, &kv.second.paddr_bit_details, true});
+        jobs.push_back({&kv.second.pwdata_combinations, &kv.second.pwdata_tracker, &kv.second.pwdata_bit_details, false});
+    }
+    const bool extended = m_extended_bit_analysis;
+    auto run_job = [extended](const BusJob& job) {
+        const int width = static_cast<int>(job.matrix->size());
+        // PADDR 只檢查 a0-a11 的相鄰位元, PWDATA 檢查所有相鄰位元
+        int pair_limit = job.is_paddr ? std::min(PADDR_OFFSET_BITS - 1, width - 1) : width - 1;
+        analyze_adjacent_pairs(*job.matrix, *job.details, pair_limit);
+        // 延伸分析只會在原本的結果上增加, 不會推翻相鄰規則的判定
+        if (extended)
+            analyze_full_matrix(*job.matrix, *job.tracker, *job.details, job.is_paddr ? PADDR_OFFSET_BITS : width);
+    };
+    unsigned thread_count = std::min<unsigned>(m_finalize_threads, static_cast<unsigned>(jobs.size()));
+    if (thread_count <= 1) {
+        for (const auto& job : jobs)
+            run_job(job);
+        return;
+    }
+    std::atomic<std::size_t> next_job(0);
+    auto worker = [&]() {
+        for (std::size_t i = next_job++; i < jobs.size(); i = next_job++)
+            run_job(jobs[i]);
+    };
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < thread_count; ++t)
+        workers.emplace_back(worker);
+    worker();
+    for (auto& t : workers)
+        t.join();
+}
+void Statistics::set_extended_bit_analysis(bool enabled) {
+    m_extended_bit_analysis = enabled;
+}
+void Statistics::set_finalize_threads(unsigned threads) {
+    m_finalize_threads = threads > 0 ? threads : 1;
+}
+void Statistics::set_incremental_corruption_analysis(bool enabled) {
+    m_incremental_corruption_analysis = enabled;
+}
+
+void Statistics::record_read_transaction(bool h, uint64_t d, CompleterID c) {
     if (h)
         m_read_transactions_with_wait++;
     else
         m_read_transactions_no_wait++;
     m_total_pclk_edges_for_read_transactions += d;
-}
-void Statistics::record_write_transaction(bool h, uint64_t d) {
+    // SETUP + ACCESS 各一個 edge, 其餘都是 wait state
+    auto& histograms = m_latency_histograms[c];
+    histograms.read_duration.record(d);
+    histograms.read_wait_states.record(d > 2 ? d - 2 : 0);
+    if (m_timeline.is_enabled())
+        m_timeline.on_transaction(false, d > 2 ? d - 2 : 0);
+}
+void Statistics::record_write_transaction(bool h, uint64_t d, CompleterID c) {
     if (h)
         m_write_transactions_with_wait++;
     else
         m_write_transactions_no_wait++;
     m_total_pclk_edges_for_write_transactions += d;
+    auto& histograms = m_latency_histograms[c];
+    histograms.write_duration.record(d);
+    histograms.write_wait_states.record(d > 2 ? d - 2 : 0);
+    if (m_timeline.is_enabled())
+        m_timeline.on_transaction(true, d > 2 ? d - 2 : 0);
+}
+void Statistics::merge_latency_histograms(const Statistics& other) {
+    for (const auto& kv : other.m_latency_histograms)
+        m_latency_histograms[kv.first].merge(kv.second);
 }
 void Statistics::record_out_of_range_access(const OutOfRangeAccessDetail& d) {
     m_out_of_range_details.push_back(d);
@@ -164,18 +311,56 @@ void Statistics::record_read_write_overlap_error(const ReadWriteOverlapDetail& d
 void Statistics::record_data_mirroring(const DataMirroringDetail& d) {
     m_data_mirroring_details.push_back(d);
 }
-void Statistics::update_shadow_memory(CompleterID c, uint32_t p, uint32_t d, uint64_t t) {
+void Statistics::record_protocol_violation(const ProtocolViolationDetail& detail) {
+    m_protocol_violation_counts[static_cast<int>(detail.kind)]++;
+    if (m_protocol_violation_details.size() < MAX_PROTOCOL_VIOLATION_RECORDS)
+        m_protocol_violation_details.push_back(detail);
+}
+void Statistics::update_shadow_memory(CompleterID c, uint32_t p, uint32_t d, uint64_t t, uint32_t pstrb) {
     if (c == CompleterID::NONE || c == CompleterID::UNKNOWN_COMPLETER)
         return;
-    m_shadow_memories[c][p] = {d, t};
+    pstrb &= m_full_strobe_mask;
+    if (pstrb == 0)
+        return;
+    ShadowMemory& memory = shadow_memory_for(c);
+    // 合併的基礎值在前面的切片裡, 這個切片的 shadow memory 無法單獨合併
+    if (m_shard_mode && pstrb != m_full_strobe_mask && memory.find(p) == memory.end())
+        m_shard_unmergeable = true;
+    ShadowMemoryEntry& entry = memory[p];
+    if (pstrb != m_full_strobe_mask) {
+        uint32_t byte_mask = 0;
+        for (int lane = 0; lane < 4; ++lane) {
+            if (pstrb & (1u << lane))
+                byte_mask |= 0xFFu << (lane * 8);
+        }
+        d = (entry.data & ~byte_mask) | (d & byte_mask);
+    }
+    entry = {d, t};
     m_reverse_write_lookup[d] = {p, t};
 }
+void Statistics::record_slave_error(CompleterID completer) {
+    m_slave_error_counts[static_cast<int>(completer)]++;
+}
 void Statistics::record_bus_active_pclk_edge() {
     m_bus_active_pclk_edges++;
+    if (m_timeline.is_enabled())
+        m_timeline.on_active_edge();
+}
+void Statistics::enable_timeline(TimelineUnit unit, uint64_t bucket_width, uint64_t expected_buckets) {
+    m_timeline.enable(unit, bucket_width, expected_buckets);
+}
+void Statistics::enable_register_heatmap() {
+    m_register_heatmap.enable();
 }
 void Statistics::set_bus_widths(int p, int d) {
     m_paddr_width = p > 0 ? p : 32;
     m_pwdata_width = d > 0 ? d : 32;
+    update_full_strobe_mask();
+}
+void Statistics::update_full_strobe_mask() {
+    // 值只保留低 32 bit, 最多 4 個 byte lane
+    int lanes = std::min((m_pwdata_width + 7) / 8, 4);
+    m_full_strobe_mask = (1u << lanes) - 1;
 }
 void Statistics::set_total_pclk_rising_edges(uint64_t t) {
     m_total_simulation_pclk_edges = t;
@@ -243,27 +428,375 @@ int Statistics::get_number_of_unique_completers_accessed() const {
 double Statistics::get_cpu_elapsed_time_ms() const {
     return m_cpu_elapsed_time_ms;
 }
-const std::vector<OutOfRangeAccessDetail>& Statistics::get_out_of_range_details() const {
+const ArenaVector<OutOfRangeAccessDetail>& Statistics::get_out_of_range_details() const {
     return m_out_of_range_details;
 }
-const std::vector<TransactionTimeoutDetail>& Statistics::get_timeout_error_details() const {
+const ArenaVector<TransactionTimeoutDetail>& Statistics::get_timeout_error_details() const {
     return m_timeout_error_details;
 }
-const std::vector<ReadWriteOverlapDetail>& Statistics::get_read_write_overlap_details() const {
+const ArenaVector<ReadWriteOverlapDetail>& Statistics::get_read_write_overlap_details() const {
     return m_read_write_overlap_details;
 }
 
-const std::vector<DataMirroringDetail>& Statistics::get_data_mirroring_details() const {
+const ArenaVector<DataMirroringDetail>& Statistics::get_data_mirroring_details() const {
     return m_data_mirroring_details;
 }
 uint64_t Statistics::get_mirroring_error_count() const {
     return m_data_mirroring_details.size();
 }
+const ArenaVector<ProtocolViolationDetail>& Statistics::get_protocol_violation_details() const {
+    return m_protocol_violation_details;
+}
+uint64_t Statistics::get_protocol_violation_count(ProtocolViolationKind kind) const {
+    return m_protocol_violation_counts[static_cast<int>(kind)];
+}
+uint64_t Statistics::get_slave_error_count(CompleterID completer) const {
+    return m_slave_error_counts[static_cast<int>(completer)];
+}
+uint64_t Statistics::get_total_protocol_violation_count() const {
+    uint64_t total = 0;
+    for (uint64_t count : m_protocol_violation_counts)
+        total += count;
+    return total;
+}
 const std::vector<CompleterID>& Statistics::get_ordered_accessed_completers() const {
     return m_ordered_accessed_completers;
 }
-const std::unordered_map<APBSystem::CompleterID, CompleterBitActivity>& Statistics::get_completer_bit_activity_map() const {
+const ArenaUnorderedMap<CompleterID, CompleterBitActivity>& Statistics::get_completer_bit_activity_map() const {
     return m_completer_bit_activity_map;
 }
+const ArenaMap<CompleterID, CompleterLatencyHistograms>& Statistics::get_latency_histograms() const {
+    return m_latency_histograms;
+}
+
+namespace {
+void merge_bit_matrix(BitPairMatrix& m, const BitPairMatrix& later) {
+    for (std::size_t i = 0; i < m.size() && i < later.size(); ++i) {
+        for (std::size_t j = 0; j < m[i].size() && j < later[i].size(); ++j) {
+            for (int k = 0; k < 4; ++k)
+                m[i][j][k] += later[i][j][k];
+        }
+    }
+}
+// 一組 pair 在任何一段出現過 01/10 就不再是候選; 仍是候選的 pair 在每一段都有完整計數
+void merge_verdict_tracker(PairVerdictTracker& t, const PairVerdictTracker& later) {
+    t.undecided_rows = 0;
+    for (std::size_t i = 0; i < t.undecided.size(); ++i) {
+        if (i < later.undecided.size())
+            t.undecided[i] &= later.undecided[i];
+        if (t.undecided[i])
+            t.undecided_rows |= 1u << i;
+    }
+    t.seen_ones |= later.seen_ones;
+    t.seen_zeros |= later.seen_zeros;
+    t.samples += later.samples;
+}
+}  // namespace
+
+void Statistics::merge_shard(const Statistics& later) {
+    // 各切片解析同一份標頭, bus 寬度相同
+    set_bus_widths(later.m_paddr_width, later.m_pwdata_width);
+    m_read_transactions_no_wait += later.m_read_transactions_no_wait;
+    m_read_transactions_with_wait += later.m_read_transactions_with_wait;
+    m_write_transactions_no_wait += later.m_write_transactions_no_wait;
+    m_write_transactions_with_wait += later.m_write_transactions_with_wait;
+    m_total_pclk_edges_for_read_transactions += later.m_total_pclk_edges_for_read_transactions;
+    m_total_pclk_edges_for_write_transactions += later.m_total_pclk_edges_for_write_transactions;
+    m_bus_active_pclk_edges += later.m_bus_active_pclk_edges;
+
+    for (CompleterID completer : later.m_ordered_accessed_completers) {
+        record_accessed_completer(completer);
+        auto mine = m_completer_bit_activity_map.find(completer);
+        auto theirs = later.m_completer_bit_activity_map.find(completer);
+        if (mine == m_completer_bit_activity_map.end() || theirs == later.m_completer_bit_activity_map.end())
+            continue;
+        merge_bit_matrix(mine->second.paddr_combinations, theirs->second.paddr_combinations);
+        merge_bit_matrix(mine->second.pwdata_combinations, theirs->second.pwdata_combinations);
+        merge_verdict_tracker(mine->second.paddr_tracker, theirs->second.paddr_tracker);
+        merge_verdict_tracker(mine->second.pwdata_tracker, theirs->second.pwdata_tracker);
+    }
+
+    // 一般切片不會在本地記錄 mirroring (都延後); 抽樣視窗已在本地判斷完
+    m_data_mirroring_details.insert(m_data_mirroring_details.end(), later.m_data_mirroring_details.begin(), later.m_data_mirroring_details.end());
+    // 延後的 mirroring 判斷要用合併 later 之前 (也就是讀取當時) 的 shadow memory
+    for (const auto& check : later.m_deferred_mirroring_checks) {
+        auto memory = m_shadow_memories.find(check.completer);
+        if (memory != m_shadow_memories.end() && memory->second.count(check.paddr))
+            continue;
+        const ReverseWriteInfo* source = check.has_local_source ? &check.local_source : nullptr;
+        if (source == nullptr) {
+            auto it = m_reverse_write_lookup.find(check.prdata);
+            if (it != m_reverse_write_lookup.end())
+                source = &it->second;
+        }
+        if (source != nullptr && source->address != check.paddr)
+            record_data_mirroring({check.timestamp, check.paddr, check.prdata, source->address, source->timestamp});
+    }
+    for (const auto& kv : later.m_shadow_memories) {
+        ShadowMemory& memory = shadow_memory_for(kv.first);
+        for (const auto& entry : kv.second)
+            memory[entry.first] = entry.second;
+    }
+    for (const auto& kv : later.m_reverse_write_lookup)
+        m_reverse_write_lookup[kv.first] = kv.second;
+
+    m_out_of_range_details.insert(m_out_of_range_details.end(), later.m_out_of_range_details.begin(), later.m_out_of_range_details.end());
+    m_timeout_error_details.insert(m_timeout_error_details.end(), later.m_timeout_error_details.begin(), later.m_timeout_error_details.end());
+    m_read_write_overlap_details.insert(m_read_write_overlap_details.end(), later.m_read_write_overlap_details.begin(), later.m_read_write_overlap_details.end());
+    for (const auto& detail : later.m_protocol_violation_details) {
+        if (m_protocol_violation_details.size() >= MAX_PROTOCOL_VIOLATION_RECORDS)
+            break;
+        m_protocol_violation_details.push_back(detail);
+    }
+    for (std::size_t i = 0; i < m_protocol_violation_counts.size(); ++i)
+        m_protocol_violation_counts[i] += later.m_protocol_violation_counts[i];
+    for (std::size_t i = 0; i < m_slave_error_counts.size(); ++i)
+        m_slave_error_counts[i] += later.m_slave_error_counts[i];
+
+    merge_latency_histograms(later);
+    m_timeline.merge(later.m_timeline);
+    m_register_heatmap.merge(later.m_register_heatmap);
+    m_shard_unmergeable = m_shard_unmergeable || later.m_shard_unmergeable;
+}
+
+void Statistics::resolve_deferred_mirroring_locally() {
+    for (const auto& check : m_deferred_mirroring_checks) {
+        if (check.has_local_source && check.local_source.address != check.paddr)
+            record_data_mirroring({check.timestamp, check.paddr, check.prdata, check.local_source.address, check.local_source.timestamp});
+    }
+    m_deferred_mirroring_checks.clear();
+}
+
+namespace {
+bool valid_completer(CompleterID id) {
+    return static_cast<unsigned>(id) <= static_cast<unsigned>(CompleterID::NONE);
+}
+// 以整塊 POD 讀回的結構中的 bool 不能直接比較, 否則損毀的值 (例如 2) 是未定義行為
+bool valid_bool_byte(const bool& b) {
+    uint8_t raw;
+    std::memcpy(&raw, &b, 1);
+    return raw <= 1;
+}
+// 每個 bit 的判定與寬度一致, 報表才不會以損毀的索引存取矩陣
+bool valid_bit_details(const ArenaVector<BitDetailStatus>& details, int width) {
+    if (details.size() != static_cast<std::size_t>(width))
+        return false;
+    for (const auto& d : details) {
+        if (static_cast<unsigned>(d.status) > static_cast<unsigned>(BitConnectionStatus::STUCK_AT_1) ||
+            d.shorted_with_bit_index < -1 || d.shorted_with_bit_index >= width)
+            return false;
+    }
+    return true;
+}
+}  // namespace
+
+void Statistics::save_shard_handoff(CheckpointWriter& w) const {
+    w.write_pod(m_shard_unmergeable);
+    w.write_pod_vector(m_deferred_mirroring_checks);
+}
+
+bool Statistics::load_shard_handoff(CheckpointReader& r) {
+    if (!r.read_bool(m_shard_unmergeable) || !r.read_pod_vector(m_deferred_mirroring_checks))
+        return false;
+    for (const auto& check : m_deferred_mirroring_checks) {
+        if (!valid_completer(check.completer) || !valid_bool_byte(check.has_local_source))
+            return false;
+    }
+    return true;
+}
+
+namespace {
+void write_bit_matrix(CheckpointWriter& w, const BitPairMatrix& m) {
+    w.write_pod<uint64_t>(m.size());
+    for (const auto& row : m)
+        w.write_pod_vector(row);
+}
+// 矩陣必須是 width x width
+bool read_bit_matrix(CheckpointReader& r, BitPairMatrix& m, int width) {
+    uint64_t n = 0;
+    if (!r.read_pod(n) || n != static_cast<uint64_t>(width))
+        return false;
+    m.clear();
+    for (uint64_t i = 0; i < n; ++i) {
+        m.emplace_back(m.get_allocator());
+        if (!r.read_pod_vector(m.back()) || m.back().size() != n)
+            return false;
+    }
+    return true;
+}
+void write_verdict_tracker(CheckpointWriter& w, const PairVerdictTracker& t) {
+    w.write_pod_vector(t.undecided);
+    w.write_pod(t.undecided_rows);
+    w.write_pod(t.width_mask);
+    w.write_pod(t.seen_ones);
+    w.write_pod(t.seen_zeros);
+    w.write_pod(t.samples);
+    w.write_pod(t.incremental);
+}
+bool read_verdict_tracker(CheckpointReader& r, PairVerdictTracker& t) {
+    return r.read_pod_vector(t.undecided) && t.undecided.size() <= 32 && r.read_pod(t.undecided_rows) && r.read_pod(t.width_mask) &&
+           r.read_pod(t.seen_ones) && r.read_pod(t.seen_zeros) && r.read_pod(t.samples) && r.read_bool(t.incremental);
+}
+}  // namespace
+
+void Statistics::save_state(CheckpointWriter& w) const {
+    w.write_pod(m_read_transactions_no_wait);
+    w.write_pod(m_read_transactions_with_wait);
+    w.write_pod(m_write_transactions_no_wait);
+    w.write_pod(m_write_transactions_with_wait);
+    w.write_pod(m_total_pclk_edges_for_read_transactions);
+    w.write_pod(m_total_pclk_edges_for_write_transactions);
+    w.write_pod(m_bus_active_pclk_edges);
+    w.write_pod(m_total_simulation_pclk_edges);
+    w.write_pod(m_first_valid_pclk_edge_for_stats);
+    w.write_pod(m_paddr_width);
+    w.write_pod(m_pwdata_width);
+    w.write_pod_vector(m_ordered_accessed_completers);
+
+    w.write_pod<uint64_t>(m_completer_bit_activity_map.size());
+    for (const auto& kv : m_completer_bit_activity_map) {
+        w.write_pod(kv.first);
+        write_bit_matrix(w, kv.second.paddr_combinations);
+        write_bit_matrix(w, kv.second.pwdata_combinations);
+        write_verdict_tracker(w, kv.second.paddr_tracker);
+        write_verdict_tracker(w, kv.second.pwdata_tracker);
+        w.write_pod_vector(kv.second.paddr_bit_details);
+        w.write_pod_vector(kv.second.pwdata_bit_details);
+    }
+
+    w.write_pod_vector(m_out_of_range_details);
+    w.write_pod_vector(m_timeout_error_details);
+    w.write_pod_vector(m_read_write_overlap_details);
+    w.write_pod_vector(m_data_mirroring_details);
+    w.write_pod_vector(m_protocol_violation_details);
+    w.write_pod(m_protocol_violation_counts);
+    w.write_pod(m_slave_error_counts);
+
+    w.write_pod<uint64_t>(m_shadow_memories.size());
+    for (const auto& kv : m_shadow_memories) {
+        w.write_pod(kv.first);
+        w.write_pod<uint64_t>(kv.second.size());
+        for (const auto& entry : kv.second) {
+            w.write_pod(entry.first);
+            w.write_pod(entry.second);
+        }
+    }
+    w.write_pod<uint64_t>(m_reverse_write_lookup.size());
+    for (const auto& kv : m_reverse_write_lookup) {
+        w.write_pod(kv.first);
+        w.write_pod(kv.second);
+    }
+
+    w.write_pod<uint64_t>(m_latency_histograms.size());
+    for (const auto& kv : m_latency_histograms) {
+        w.write_pod(kv.first);
+        kv.second.read_duration.save_state(w);
+        kv.second.write_duration.save_state(w);
+        kv.second.read_wait_states.save_state(w);
+        kv.second.write_wait_states.save_state(w);
+    }
+    m_timeline.save_state(w);
+    m_register_heatmap.save_state(w);
+}
+
+bool Statistics::load_state(CheckpointReader& r) {
+    if (!r.read_pod(m_read_transactions_no_wait) || !r.read_pod(m_read_transactions_with_wait) ||
+        !r.read_pod(m_write_transactions_no_wait) || !r.read_pod(m_write_transactions_with_wait) ||
+        !r.read_pod(m_total_pclk_edges_for_read_transactions) || !r.read_pod(m_total_pclk_edges_for_write_transactions) ||
+        !r.read_pod(m_bus_active_pclk_edges) || !r.read_pod(m_total_simulation_pclk_edges) ||
+        !r.read_pod(m_first_valid_pclk_edge_for_stats) ||
+        !r.read_pod(m_paddr_width) || !r.read_pod(m_pwdata_width) || m_paddr_width <= 0 || m_pwdata_width <= 0 ||
+        !r.read_pod_vector(m_ordered_accessed_completers))
+        return false;
+    for (CompleterID cid : m_ordered_accessed_completers) {
+        if (!valid_completer(cid))
+            return false;
+    }
+    m_accessed_completer_ids_set.clear();
+    m_accessed_completer_ids_set.insert(m_ordered_accessed_completers.begin(), m_ordered_accessed_completers.end());
+    update_full_strobe_mask();
+
+    uint64_t n = 0;
+    if (!r.read_pod(n) || !r.fits(n, sizeof(CompleterID)))
+        return false;
+    m_completer_bit_activity_map.clear();
+    for (uint64_t i = 0; i < n; ++i) {
+        CompleterID cid;
+        CompleterBitActivity activity{ArenaAllocator<char>(m_arena)};
+        if (!r.read_enum(cid, CompleterID::NONE) ||
+            !read_bit_matrix(r, activity.paddr_combinations, m_paddr_width) || !read_bit_matrix(r, activity.pwdata_combinations, m_pwdata_width) ||
+            !read_verdict_tracker(r, activity.paddr_tracker) || !read_verdict_tracker(r, activity.pwdata_tracker) ||
+            !r.read_pod_vector(activity.paddr_bit_details) || !r.read_pod_vector(activity.pwdata_bit_details) ||
+            !valid_bit_details(activity.paddr_bit_details, m_paddr_width) || !valid_bit_details(activity.pwdata_bit_details, m_pwdata_width))
+            return false;
+        m_completer_bit_activity_map.emplace(cid, std::move(activity));
+    }
+
+    if (!r.read_pod_vector(m_out_of_range_details) || !r.read_pod_vector(m_timeout_error_details) ||
+        !r.read_pod_vector(m_read_write_overlap_details) || !r.read_pod_vector(m_data_mirroring_details) ||
+        !r.read_pod_vector(m_protocol_violation_details) || !r.read_pod(m_protocol_violation_counts) ||
+        !r.read_pod(m_slave_error_counts))
+        return false;
+    for (const auto& v : m_protocol_violation_details) {
+        if (static_cast<unsigned>(v.kind) >= static_cast<unsigned>(ProtocolViolationKind::COUNT))
+            return false;
+    }
+
+    if (!r.read_pod(n) || !r.fits(n, sizeof(CompleterID) + sizeof(uint64_t)))
+        return false;
+    m_shadow_memories.clear();
+    for (uint64_t i = 0; i < n; ++i) {
+        CompleterID cid;
+        uint64_t entries = 0;
+        if (!r.read_enum(cid, CompleterID::NONE) || !r.read_pod(entries) ||
+            !r.fits(entries, sizeof(uint32_t) + sizeof(ShadowMemoryEntry)))
+            return false;
+        auto& memory = shadow_memory_for(cid);
+        memory.reserve(entries);
+        for (uint64_t k = 0; k < entries; ++k) {
+            uint32_t paddr = 0;
+            ShadowMemoryEntry entry{};
+            if (!r.read_pod(paddr) || !r.read_pod(entry))
+                return false;
+            memory[paddr] = entry;
+        }
+    }
+    if (!r.read_pod(n) || !r.fits(n, sizeof(uint32_t) + sizeof(ReverseWriteInfo)))
+        return false;
+    m_reverse_write_lookup.clear();
+    m_reverse_write_lookup.reserve(n);
+    for (uint64_t i = 0; i < n; ++i) {
+        uint32_t data = 0;
+        ReverseWriteInfo info{};
+        if (!r.read_pod(data) || !r.read_pod(info))
+            return false;
+        m_reverse_write_lookup[data] = info;
+    }
+
+    if (!r.read_pod(n))
+        return false;
+    m_latency_histograms.clear();
+    for (uint64_t i = 0; i < n; ++i) {
+        CompleterID cid;
+        if (!r.read_enum(cid, CompleterID::NONE))
+            return false;
+        auto& histograms = m_latency_histograms[cid];
+        if (!histograms.read_duration.load_state(r) || !histograms.write_duration.load_state(r) ||
+            !histograms.read_wait_states.load_state(r) || !histograms.write_wait_states.load_state(r))
+            return false;
+    }
+    // checkpoint 沒有時間軸時保留目前的設定 (resume 時才開啟 --timeline)
+    UtilizationTimeline timeline;
+    if (!timeline.load_state(r))
+        return false;
+    if (timeline.is_enabled())
+        m_timeline = timeline;
+    RegisterHeatmap heatmap;
+    if (!heatmap.load_state(r))
+        return false;
+    if (heatmap.is_enabled())
+        m_register_heatmap = heatmap;
+    return true;
+}
 
 }  // namespace APBSystem
@@ -1,16 +1,27 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
+#include <map>
 #include <set>
 #include <unordered_map>
 #include <vector>
 #include "apb_types.hpp"
+#include "latency_histogram.hpp"
+#include "register_heatmap.hpp"
+#include "utilization_timeline.hpp"
 
 namespace APBSystem {
 
+class CheckpointWriter;
+class CheckpointReader;
+
 class Statistics {
    public:
-    Statistics();
+    static const std::size_t MAX_PROTOCOL_VIOLATION_RECORDS = 10000;
+
+    // arena 為 nullptr 時所有容器使用一般的 heap
+    explicit Statistics(MonotonicArena* arena = nullptr);
     bool is_completer_corrupted(CompleterID cid);
     bool is_transaction_timeout(uint64_t start_time, uint32_t paddr) const;
 
@@ -18,24 +29,65 @@ class Statistics {
     void record_paddr_for_corruption_analysis(CompleterID completer, uint32_t paddr_value);
     void record_pwdata_for_corruption_analysis(CompleterID completer, uint32_t pwdata_value);
     void record_bus_active_pclk_edge();
+    // 每個 reset 之後的 pclk edge 呼叫一次, 時間軸未啟用時只有一個判斷
+    void record_timeline_pclk_edge(uint64_t pclk_edge_count, uint64_t timestamp) {
+        if (m_timeline.is_enabled())
+            m_timeline.on_pclk_edge(pclk_edge_count, timestamp);
+    }
+    // 每筆完成的交易呼叫一次, 熱度圖未啟用時只有一個判斷
+    void record_register_access(CompleterID completer, uint32_t paddr, bool is_write, uint64_t duration_pclk_edges, uint64_t start_time_ps) {
+        if (m_register_heatmap.is_enabled())
+            m_register_heatmap.on_transaction(completer, paddr, is_write, duration_pclk_edges > 2 ? duration_pclk_edges - 2 : 0, start_time_ps);
+    }
     void record_accessed_completer(CompleterID completer_id);
-    void update_shadow_memory(CompleterID completer, uint32_t paddr, uint32_t pwdata, uint64_t timestamp);
+    // pstrb 只有部分 byte lane 有效時與原本的內容合併 (沒寫過的位址視為 0)
+    void update_shadow_memory(CompleterID completer, uint32_t paddr, uint32_t pwdata, uint64_t timestamp, uint32_t pstrb);
     void check_for_data_mirroring(CompleterID completer, uint32_t paddr, uint32_t prdata, uint64_t timestamp);
-    void record_read_transaction(bool had_wait_states, uint64_t duration_pclk_edges);
-    void record_write_transaction(bool had_wait_states, uint64_t duration_pclk_edges);
+    void record_read_transaction(bool had_wait_states, uint64_t duration_pclk_edges, CompleterID completer);
+    void record_write_transaction(bool had_wait_states, uint64_t duration_pclk_edges, CompleterID completer);
 
     // --- 錯誤記錄 ---
     void record_out_of_range_access(const OutOfRangeAccessDetail& detail);
     void record_timeout_error(const TransactionTimeoutDetail& detail);
     void record_read_write_overlap_error(const ReadWriteOverlapDetail& detail);
     void record_data_mirroring(const DataMirroringDetail& d);
+    // 計數不設上限, 明細只保留前 MAX_PROTOCOL_VIOLATION_RECORDS 筆
+    void record_protocol_violation(const ProtocolViolationDetail& detail);
+    void record_slave_error(CompleterID completer);
 
     // --- 分析與設定 ---
     void set_bus_widths(int paddr_width, int pwdata_width);
     void set_total_pclk_rising_edges(uint64_t total_edges);
     void set_cpu_elapsed_time_ms(double time_ms);
     void set_first_valid_pclk_edge_for_stats(uint64_t first_valid_edge);
+    // 各 completer 的 PADDR / PWDATA 分析互相獨立, threads > 1 時平行執行
     void finalize_bit_activity();
+    // 預設只判定恰好一組相鄰位元的短路; 開啟後使用完整矩陣找多組 / 非相鄰短路與 stuck-at-0/1
+    void set_extended_bit_analysis(bool enabled);
+    void set_finalize_threads(unsigned threads);
+    // 預設只更新還沒出現 01/10 證據的 pair; 關閉後每筆交易都更新完整的 co-occurrence matrix
+    // (要在第一個 completer 被存取之前設定)
+    void set_incremental_corruption_analysis(bool enabled);
+    // 把另一份 Statistics (其他執行緒或檔案) 的延遲分佈加進來
+    void merge_latency_histograms(const Statistics& other);
+    void enable_timeline(TimelineUnit unit, uint64_t bucket_width, uint64_t expected_buckets);
+    void enable_register_heatmap();
+
+    // --- 時間切片 (shard) ---
+    // worker 不知道前面切片的 shadow memory: data mirroring 的判斷延後到合併時才做,
+    // 對本地沒寫過的位址做部分 PSTRB 寫入 (需要之前的內容) 時標記為無法合併
+    void set_shard_mode(bool enabled) { m_shard_mode = enabled; }
+    bool is_shard_unmergeable() const { return m_shard_unmergeable; }
+    // later 是緊接在這段之後的切片: 計數相加, 清單依序串接, shadow memory 由 later 覆蓋
+    void merge_shard(const Statistics& later);
+    // 取樣視窗之前的 shadow memory 無從得知: 只回報來源寫入也在視窗內的 mirroring, 其餘的延後判斷直接捨棄
+    void resolve_deferred_mirroring_locally();
+    void save_shard_handoff(CheckpointWriter& w) const;
+    bool load_shard_handoff(CheckpointReader& r);
+
+    // --- Checkpoint (計數器、bit activity、shadow memory 與錯誤清單) ---
+    void save_state(CheckpointWriter& w) const;
+    bool load_state(CheckpointReader& r);
 
     // --- Getters ---
     uint64_t get_read_transactions_no_wait() const;
@@ -46,17 +98,27 @@ class Statistics {
     double get_average_write_cycle_duration() const;
     double get_bus_utilization_percentage() const;
     uint64_t get_num_idle_pclk_edges() const;
+    uint64_t get_bus_active_pclk_edges() const { return m_bus_active_pclk_edges; }
     int get_number_of_unique_completers_accessed() const;
     double get_cpu_elapsed_time_ms() const;
-    const std::vector<OutOfRangeAccessDetail>& get_out_of_range_details() const;
-    const std::vector<TransactionTimeoutDetail>& get_timeout_error_details() const;
-    const std::vector<ReadWriteOverlapDetail>& get_read_write_overlap_details() const;
-    const std::vector<DataMirroringDetail>& get_data_mirroring_details() const;
+    const ArenaVector<OutOfRangeAccessDetail>& get_out_of_range_details() const;
+    const ArenaVector<TransactionTimeoutDetail>& get_timeout_error_details() const;
+    const ArenaVector<ReadWriteOverlapDetail>& get_read_write_overlap_details() const;
+    const ArenaVector<DataMirroringDetail>& get_data_mirroring_details() const;
     uint64_t get_mirroring_error_count() const;
+    const ArenaVector<ProtocolViolationDetail>& get_protocol_violation_details() const;
+    uint64_t get_protocol_violation_count(ProtocolViolationKind kind) const;
+    uint64_t get_total_protocol_violation_count() const;
+    uint64_t get_slave_error_count(CompleterID completer) const;
     const std::vector<CompleterID>& get_ordered_accessed_completers() const;
-    const std::unordered_map<APBSystem::CompleterID, CompleterBitActivity>& get_completer_bit_activity_map() const;
+    const ArenaUnorderedMap<CompleterID, CompleterBitActivity>& get_completer_bit_activity_map() const;
+    const ArenaMap<CompleterID, CompleterLatencyHistograms>& get_latency_histograms() const;
+    MonotonicArena* get_arena() const { return m_arena; }
+    const UtilizationTimeline& get_timeline() const { return m_timeline; }
+    const RegisterHeatmap& get_register_heatmap() const { return m_register_heatmap; }
 
    private:
+    MonotonicArena* m_arena;
     uint64_t m_read_transactions_no_wait, m_read_transactions_with_wait;
     uint64_t m_write_transactions_no_wait, m_write_transactions_with_wait;
     uint64_t m_total_pclk_edges_for_read_transactions, m_total_pclk_edges_for_write_transactions;
@@ -65,22 +127,49 @@ class Statistics {
     uint64_t m_first_valid_pclk_edge_for_stats;
 
     int m_paddr_width{32}, m_pwdata_width{32};
+    uint32_t m_full_strobe_mask{0xF};
+    bool m_extended_bit_analysis{false};
+    unsigned m_finalize_threads{1};
+    bool m_incremental_corruption_analysis{true};
     std::set<CompleterID> m_accessed_completer_ids_set;
     std::vector<CompleterID> m_ordered_accessed_completers;
 
-    std::unordered_map<APBSystem::CompleterID, CompleterBitActivity> m_completer_bit_activity_map;
+    ArenaUnorderedMap<CompleterID, CompleterBitActivity> m_completer_bit_activity_map;
 
-    std::vector<OutOfRangeAccessDetail> m_out_of_range_details;
-    std::vector<TransactionTimeoutDetail> m_timeout_error_details;
-    std::vector<ReadWriteOverlapDetail> m_read_write_overlap_details;
-    std::vector<DataMirroringDetail> m_data_mirroring_details;
+    ArenaVector<OutOfRangeAccessDetail> m_out_of_range_details;
+    ArenaVector<TransactionTimeoutDetail> m_timeout_error_details;
+    ArenaVector<ReadWriteOverlapDetail> m_read_write_overlap_details;
+    ArenaVector<DataMirroringDetail> m_data_mirroring_details;
+    ArenaVector<ProtocolViolationDetail> m_protocol_violation_details;
+    std::array<uint64_t, static_cast<int>(ProtocolViolationKind::COUNT)> m_protocol_violation_counts;
+    std::array<uint64_t, static_cast<int>(CompleterID::NONE) + 1> m_slave_error_counts;
+
+    ArenaMap<CompleterID, CompleterLatencyHistograms> m_latency_histograms;
+    UtilizationTimeline m_timeline;
+    RegisterHeatmap m_register_heatmap;
 
     struct ShadowMemoryEntry {
         uint32_t data;
         uint64_t timestamp;
     };
-    std::unordered_map<CompleterID, std::unordered_map<uint32_t, ShadowMemoryEntry>> m_shadow_memories;
-    std::unordered_map<uint32_t, ReverseWriteInfo> m_reverse_write_lookup;
+    using ShadowMemory = ArenaUnorderedMap<uint32_t, ShadowMemoryEntry>;
+    ShadowMemory& shadow_memory_for(CompleterID completer);
+    void update_full_strobe_mask();
+    ArenaUnorderedMap<CompleterID, ShadowMemory> m_shadow_memories;
+    ArenaUnorderedMap<uint32_t, ReverseWriteInfo> m_reverse_write_lookup;
+
+    // 切片內讀取本地沒寫過的位址: 前面的切片可能寫過這個位址或同樣的值
+    struct DeferredMirroringCheck {
+        uint64_t timestamp;
+        uint32_t paddr;
+        uint32_t prdata;
+        CompleterID completer;
+        bool has_local_source;        // 切片內寫過 prdata 這個值 (比前面切片的寫入新)
+        ReverseWriteInfo local_source;
+    };
+    bool m_shard_mode{false};
+    bool m_shard_unmergeable{false};
+    ArenaVector<DeferredMirroringCheck> m_deferred_mirroring_checks;
 };
 
 }  // namespace APBSystem
\ No newline at end of file
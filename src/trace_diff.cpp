@@ -0,0 +1,421 @@
+// trace_diff.cpp
+#include "trace_diff.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace APBSystem {
+
+namespace {
+const std::size_t CHUNK_RECORDS = 4096;
+const std::size_t MAX_QUEUED_CHUNKS = 8;  // 一邊領先另一邊太多時, 分析執行緒在這裡等待
+const std::size_t CONFIRM_RECORDS = 4;    // 重新對齊時要求連續相同的筆數
+const std::size_t MAX_SHOWN_RECORDS = 8;  // 一個不一致區段最多列出的交易數
+const uint64_t HASH_BASE = 0x9E3779B97F4A7C15ULL;
+// 預設比較的 flags (TXN_HAD_WAIT / TXN_OUT_OF_RANGE 等由時序或設定決定的不列入)
+const uint32_t COMPARED_FLAGS = TXN_WRITE | TXN_PADDR_X | TXN_PWDATA_X | TXN_PRDATA_X | TXN_SLVERR | APB4_PSTRB_MASK | APB4_PPROT_MASK;
+
+inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDULL;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+uint64_t hash_power(uint64_t exponent) {
+    uint64_t result = 1, base = HASH_BASE;
+    for (; exponent > 0; exponent >>= 1) {
+        if (exponent & 1)
+            result *= base;
+        base *= base;
+    }
+    return result;
+}
+
+// 每筆交易先混合成 64-bit key, prefix hash 的多項式在 mod 2^64 下就不容易碰撞
+uint64_t transaction_key(const TransactionRecord& r, bool timing) {
+    uint64_t h = mix64((static_cast<uint64_t>(r.paddr) << 32) | (r.is_write() ? r.pwdata : r.prdata));
+    h = mix64(h ^ ((static_cast<uint64_t>(r.flags & COMPARED_FLAGS) << 8) | static_cast<uint64_t>(r.completer)));
+    if (timing) {
+        h = mix64(h ^ r.start_time_ps);
+        h = mix64(h ^ r.end_time_ps);
+        h = mix64(h ^ r.wait_cycles);
+    }
+    return h;
+}
+
+// transaction_key 涵蓋的欄位逐一比較; hash 相同只代表 "很可能" 相同
+bool same_transaction(const TransactionRecord& a, const TransactionRecord& b, bool timing) {
+    if (a.paddr != b.paddr || (a.flags & COMPARED_FLAGS) != (b.flags & COMPARED_FLAGS) || a.completer != b.completer ||
+        (a.is_write() ? a.pwdata != b.pwdata : a.prdata != b.prdata))
+        return false;
+    return !timing || (a.start_time_ps == b.start_time_ps && a.end_time_ps == b.end_time_ps && a.wait_cycles == b.wait_cycles);
+}
+
+struct DiffEntry {
+    TransactionRecord record;
+    uint64_t prefix_hash;  // 序列開頭到這筆 (含) 的多項式 hash
+};
+
+// 一份波形的分析執行緒, 以及比對端看到的視窗 [window_begin, end())
+class TraceSide {
+   public:
+    TraceSide(const std::string& path, const TraceDiffOptions& options)
+        : m_path(path), m_options(options), m_cancelled(false), m_done(false), m_parse_ok(false),
+          m_produced(0), m_running_hash(0), m_window_begin(0), m_hash_before_window(0) {}
+
+    void start() { m_thread = std::thread(&TraceSide::run, this); }
+    // 比對端不再需要資料: 之後的交易只計數
+    void cancel() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cancelled = true;
+        m_queue.clear();
+        m_cv.notify_all();
+    }
+    void join() { m_thread.join(); }
+    bool parse_ok() const { return m_parse_ok; }
+    uint64_t produced() const { return m_produced; }
+    const std::string& path() const { return m_path; }
+
+    // 讀入 chunk 直到視窗涵蓋到 end_index 之前; 資料已經結束時回傳 false
+    bool ensure(uint64_t end_index) {
+        while (end() < end_index) {
+            if (!fetch_chunk())
+                return false;
+        }
+        return true;
+    }
+    uint64_t begin() const { return m_window_begin; }
+    uint64_t end() const { return m_window_begin + m_window.size(); }
+    const TransactionRecord& at(uint64_t index) const { return m_window[index - m_window_begin].record; }
+    uint64_t range_hash(uint64_t first, uint64_t length) const {
+        return hash_before(first + length) - hash_before(first) * hash_power(length);
+    }
+    void release_before(uint64_t index) {
+        while (m_window_begin < index && !m_window.empty()) {
+            m_hash_before_window = m_window.front().prefix_hash;
+            m_window.pop_front();
+            m_window_begin++;
+        }
+    }
+
+   private:
+    void run() {
+        m_session.set_timestamp_coalescing(m_options.coalescing);
+        m_session.analyzer().set_keep_completed_transactions(false);
+        m_session.analyzer().set_transaction_callback([this](const TransactionRecord& r) { on_transaction(r); });
+        m_parse_ok = m_session.parse_file(m_path);
+        if (!m_pending.empty())
+            submit_pending();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_done = true;
+        m_cv.notify_all();
+    }
+    void on_transaction(const TransactionRecord& record) {
+        m_produced++;
+        if (m_cancelled.load(std::memory_order_relaxed))
+            return;
+        m_running_hash = m_running_hash * HASH_BASE + transaction_key(record, m_options.compare_timing);
+        m_pending.push_back({record, m_running_hash});
+        if (m_pending.size() == CHUNK_RECORDS)
+            submit_pending();
+    }
+    void submit_pending() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [this] { return m_queue.size() < MAX_QUEUED_CHUNKS || m_cancelled; });
+        if (!m_cancelled)
+            m_queue.push_back(std::move(m_pending));
+        m_pending.clear();
+        m_pending.reserve(CHUNK_RECORDS);
+        m_cv.notify_all();
+    }
+    bool fetch_chunk() {
+        std::vector<DiffEntry> chunk;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this] { return !m_queue.empty() || m_done; });
+            if (m_queue.empty())
+                return false;
+            chunk = std::move(m_queue.front());
+            m_queue.pop_front();
+            m_cv.notify_all();
+        }
+        m_window.insert(m_window.end(), chunk.begin(), chunk.end());
+        return true;
+    }
+    uint64_t hash_before(uint64_t index) const {
+        return index == m_window_begin ? m_hash_before_window : m_window[index - m_window_begin - 1].prefix_hash;
+    }
+
+    std::string m_path;
+    const TraceDiffOptions& m_options;
+    AnalysisSession m_session;
+    std::thread m_thread;
+
+    // 分析執行緒與比對端共用
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<std::vector<DiffEntry>> m_queue;
+    std::atomic<bool> m_cancelled;
+    bool m_done;
+
+    // 只有分析執行緒使用 (join 之後比對端才讀取)
+    bool m_parse_ok;
+    uint64_t m_produced;
+    uint64_t m_running_hash;
+    std::vector<DiffEntry> m_pending;
+
+    // 只有比對端使用
+    std::deque<DiffEntry> m_window;
+    uint64_t m_window_begin;
+    uint64_t m_hash_before_window;
+};
+
+struct Divergence {
+    uint64_t golden_index;
+    uint64_t dut_index;
+    uint64_t golden_count;  // 不一致區段的筆數
+    uint64_t dut_count;
+    bool to_end;            // 一邊的序列已經結束, 另一邊剩下的交易都是多出來的
+    std::vector<TransactionRecord> before;  // 區段之前相同的交易 (golden)
+    std::vector<TransactionRecord> golden_records;
+    std::vector<TransactionRecord> dut_records;
+    std::vector<TransactionRecord> after;   // 重新對齊之後的交易 (golden)
+};
+
+class TraceComparator {
+   public:
+    TraceComparator(TraceSide& golden, TraceSide& dut, const TraceDiffOptions& options)
+        : m_golden(golden), m_dut(dut), m_options(options), m_stopped_early(false) {}
+
+    void run() {
+        uint64_t g = 0, d = 0;
+        while (true) {
+            m_golden.ensure(g + 1);
+            m_dut.ensure(d + 1);
+            const uint64_t length = std::min(m_golden.end() - g, m_dut.end() - d);
+            if (length == 0) {
+                // 至少一邊已經結束
+                if (m_golden.end() > g || m_dut.end() > d) {
+                    if (m_divergences.size() >= m_options.max_divergences) {
+                        m_stopped_early = true;
+                        return;
+                    }
+                    m_golden.ensure(g + MAX_SHOWN_RECORDS);
+                    m_dut.ensure(d + MAX_SHOWN_RECORDS);
+                    record_divergence(g, d, m_golden.end() - g, m_dut.end() - d, true);
+                }
+                return;
+            }
+            // hash 找出第一個可能不一致的位置: 整段 hash 相同時是 length, 否則二分搜尋 ([0, lo) hash 相同, [0, hi) 不同)
+            uint64_t lo = length;
+            if (m_golden.range_hash(g, length) != m_dut.range_hash(d, length)) {
+                lo = 0;
+                uint64_t hi = length;
+                while (hi - lo > 1) {
+                    const uint64_t mid = lo + (hi - lo) / 2;
+                    if (m_golden.range_hash(g, mid) == m_dut.range_hash(d, mid))
+                        lo = mid;
+                    else
+                        hi = mid;
+                }
+            }
+            // hash 相同的部分仍逐筆比較 (資料已在視窗中), 碰撞不能讓不一致被當成相同
+            lo = matching_prefix(g, d, lo);
+            if (lo == length) {
+                g += length;
+                d += length;
+                release(g, d);
+                continue;
+            }
+            if (m_divergences.size() >= m_options.max_divergences) {
+                m_stopped_early = true;
+                return;
+            }
+            g += lo;
+            d += lo;
+            uint64_t skip_golden = 1, skip_dut = 1;
+            m_golden.ensure(g + m_options.resync_window + CONFIRM_RECORDS);
+            m_dut.ensure(d + m_options.resync_window + CONFIRM_RECORDS);
+            find_resync_point(g, d, skip_golden, skip_dut);
+            record_divergence(g, d, skip_golden, skip_dut, false);
+            g += skip_golden;
+            d += skip_dut;
+            release(g, d);
+        }
+    }
+    const std::vector<Divergence>& divergences() const { return m_divergences; }
+    bool stopped_early() const { return m_stopped_early; }
+
+   private:
+    // 從 g / d 開始最多 length 筆中, 開頭相同的筆數
+    uint64_t matching_prefix(uint64_t g, uint64_t d, uint64_t length) const {
+        uint64_t i = 0;
+        while (i < length && same_transaction(m_golden.at(g + i), m_dut.at(d + i), m_options.compare_timing))
+            ++i;
+        return i;
+    }
+    void release(uint64_t g, uint64_t d) {
+        m_golden.release_before(g - std::min<uint64_t>(g, m_options.context));
+        m_dut.release_before(d - std::min<uint64_t>(d, m_options.context));
+    }
+
+    // 找最小的 (skip_golden + skip_dut), 使兩邊跳過之後連續 CONFIRM_RECORDS 筆相同 (或同時結束)
+    // 總數相同時優先兩邊各跳過相同筆數 (資料被改), 其次才是插入/遺漏
+    bool find_resync_point(uint64_t g, uint64_t d, uint64_t& skip_golden, uint64_t& skip_dut) const {
+        const uint64_t window = m_options.resync_window;
+        const uint64_t g_end = m_golden.end(), d_end = m_dut.end();
+        // ensure 之後視窗仍不足, 表示序列已經結束
+        const bool g_finished = g_end < g + window + CONFIRM_RECORDS;
+        const bool d_finished = d_end < d + window + CONFIRM_RECORDS;
+        for (uint64_t total = 1; total <= 2 * window; ++total) {
+            for (uint64_t k = 0; k <= total + 1; ++k) {
+                // total/2, total/2+1, total/2-1, ...
+                const uint64_t half = total / 2;
+                const uint64_t a = (k % 2 == 0) ? half + k / 2 : half - (k + 1) / 2;
+                if (a > total || a > window || total - a > window)
+                    continue;
+                const uint64_t b = total - a;
+                const uint64_t ga = g + a, db = d + b;
+                if (ga > g_end || db > d_end)
+                    continue;
+                const uint64_t confirm = std::min<uint64_t>(CONFIRM_RECORDS, std::min(g_end - ga, d_end - db));
+                if (confirm < CONFIRM_RECORDS) {
+                    // 不足 CONFIRM_RECORDS 筆時, 兩邊必須在同一個位置結束
+                    if (!g_finished || !d_finished || ga + confirm != g_end || db + confirm != d_end)
+                        continue;
+                }
+                if (confirm == 0 || (m_golden.range_hash(ga, confirm) == m_dut.range_hash(db, confirm) &&
+                                     matching_prefix(ga, db, confirm) == confirm)) {
+                    skip_golden = a;
+                    skip_dut = b;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void record_divergence(uint64_t g, uint64_t d, uint64_t golden_count, uint64_t dut_count, bool to_end) {
+        Divergence div;
+        div.golden_index = g;
+        div.dut_index = d;
+        div.golden_count = golden_count;
+        div.dut_count = dut_count;
+        div.to_end = to_end;
+        for (uint64_t i = std::max(m_golden.begin(), g - std::min<uint64_t>(g, m_options.context)); i < g; ++i)
+            div.before.push_back(m_golden.at(i));
+        for (uint64_t i = g; i < std::min(g + std::min<uint64_t>(golden_count, MAX_SHOWN_RECORDS), m_golden.end()); ++i)
+            div.golden_records.push_back(m_golden.at(i));
+        for (uint64_t i = d; i < std::min(d + std::min<uint64_t>(dut_count, MAX_SHOWN_RECORDS), m_dut.end()); ++i)
+            div.dut_records.push_back(m_dut.at(i));
+        if (!to_end) {
+            for (uint64_t i = g + golden_count; i < std::min(g + golden_count + m_options.context, m_golden.end()); ++i)
+                div.after.push_back(m_golden.at(i));
+        }
+        m_divergences.push_back(div);
+    }
+
+    TraceSide& m_golden;
+    TraceSide& m_dut;
+    const TraceDiffOptions& m_options;
+    std::vector<Divergence> m_divergences;
+    bool m_stopped_early;
+};
+
+void write_transaction_line(std::ostream& out, char marker, const char* side, uint64_t index, const TransactionRecord& r) {
+    char line[192];
+    std::snprintf(line, sizeof(line), "  %c %-6s #%-9llu %c PADDR=0x%08X DATA=0x%08X %-10s wait=%u t=%llu..%llu ps%s\n",
+                  marker, side, static_cast<unsigned long long>(index), r.is_write() ? 'W' : 'R', r.paddr,
+                  r.is_write() ? r.pwdata : r.prdata, completer_id_name(r.completer), r.wait_cycles,
+                  static_cast<unsigned long long>(r.start_time_ps), static_cast<unsigned long long>(r.end_time_ps),
+                  (r.flags & TXN_SLVERR) ? " PSLVERR" : "");
+    out << line;
+}
+
+void write_divergence(std::ostream& out, std::size_t number, const Divergence& div) {
+    out << "\nDivergence " << number << ": golden #" << div.golden_index << " / DUT #" << div.dut_index;
+    if (div.to_end) {
+        if (div.golden_count > 0)
+            out << " (DUT ends; golden has more transactions)";
+        else
+            out << " (golden ends; DUT has more transactions)";
+    } else if (div.golden_count == div.dut_count) {
+        out << " (" << div.golden_count << " transaction(s) differ)";
+    } else {
+        out << " (" << div.golden_count << " golden vs " << div.dut_count << " DUT transaction(s))";
+    }
+    out << "\n";
+    uint64_t index = div.golden_index - div.before.size();
+    for (const auto& r : div.before)
+        write_transaction_line(out, ' ', "golden", index++, r);
+    index = div.golden_index;
+    for (const auto& r : div.golden_records)
+        write_transaction_line(out, '-', "golden", index++, r);
+    if (!div.to_end && div.golden_count > div.golden_records.size())
+        out << "  - ... " << (div.golden_count - div.golden_records.size()) << " more\n";
+    index = div.dut_index;
+    for (const auto& r : div.dut_records)
+        write_transaction_line(out, '+', "DUT", index++, r);
+    if (!div.to_end && div.dut_count > div.dut_records.size())
+        out << "  + ... " << (div.dut_count - div.dut_records.size()) << " more\n";
+    index = div.golden_index + div.golden_count;
+    for (const auto& r : div.after)
+        write_transaction_line(out, ' ', "golden", index++, r);
+}
+}  // namespace
+
+bool run_trace_diff(const std::string& golden_path, const std::string& dut_path, const TraceDiffOptions& options,
+                    std::ostream& out, bool& identical) {
+    TraceSide golden(golden_path, options);
+    TraceSide dut(dut_path, options);
+    golden.start();
+    dut.start();
+    TraceComparator comparator(golden, dut, options);
+    comparator.run();
+    // 比對結束 (或達到上限) 後, 分析執行緒只需要把交易數算完
+    golden.cancel();
+    dut.cancel();
+    golden.join();
+    dut.join();
+    for (const TraceSide* side : {&golden, &dut}) {
+        if (!side->parse_ok()) {
+            std::cerr << "Error: Failed to analyze " << side->path() << std::endl;
+            return false;
+        }
+    }
+
+    const auto& divergences = comparator.divergences();
+    identical = divergences.empty() && !comparator.stopped_early();
+    out << "Golden: " << golden_path << " (" << golden.produced() << " transactions)\n";
+    out << "DUT: " << dut_path << " (" << dut.produced() << " transactions)\n";
+    out << "Compared Fields: direction, PADDR, data, completer, PSLVERR, PSTRB/PPROT"
+        << (options.compare_timing ? ", start/end time, wait cycles" : "") << "\n";
+    out << "Identical Prefix: " << (divergences.empty() ? golden.produced() : divergences.front().golden_index) << " transactions\n";
+    out << "Number of Divergences: " << divergences.size();
+    if (comparator.stopped_early())
+        out << " (stopped after the first " << divergences.size() << ")";
+    out << "\n";
+    for (std::size_t i = 0; i < divergences.size(); ++i) {
+        Divergence div = divergences[i];
+        // 結尾多出的交易數在分析執行緒結束後才知道
+        if (div.to_end) {
+            div.golden_count = golden.produced() - div.golden_index;
+            div.dut_count = dut.produced() - div.dut_index;
+        }
+        write_divergence(out, i + 1, div);
+        if (div.to_end)
+            out << "  " << std::max(div.golden_count, div.dut_count) << " extra transaction(s) in total\n";
+    }
+    return true;
+}
+
+}  // namespace APBSystem
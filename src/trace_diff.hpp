@@ -0,0 +1,29 @@
+// trace_diff.hpp
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include "analysis_session.hpp"
+
+namespace APBSystem {
+
+struct TraceDiffOptions {
+    bool compare_timing = false;      // 也比較開始/結束時間與 wait cycles (預設只比較方向/位址/資料/completer/PSLVERR)
+    std::size_t max_divergences = 10;  // 回報前幾個不一致的區段後就停止比對
+    std::size_t context = 3;           // 每個不一致區段前後列出的交易數
+    std::size_t resync_window = 64;    // 不一致之後在兩邊各往前找多少筆交易來重新對齊
+    TimestampCoalescing coalescing = TimestampCoalescing::OFF;
+};
+
+// --- golden 與 DUT 兩份波形的交易序列比對 ---
+// 兩個 AnalysisSession 在各自的執行緒同時分析, 完成的交易以固定大小的 chunk 經由有上限的 queue 送給比對端
+// 每筆交易的 key hash 與整個序列的多項式 prefix hash 在分析執行緒計算; 比對端以 range hash
+// 二分搜尋第一個可能不一致的位置, hash 相同的部分再逐筆確認後才跳過, 並在 resync_window 內找重新對齊的點
+// 記憶體只有 queue 與比對視窗 (context + resync_window), 與 trace 長度無關
+// identical 表示兩邊的交易序列完全相同; 任一邊解析失敗時回傳 false
+bool run_trace_diff(const std::string& golden_path, const std::string& dut_path, const TraceDiffOptions& options,
+                    std::ostream& out, bool& identical);
+
+}  // namespace APBSystem
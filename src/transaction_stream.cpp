@@ -0,0 +1,289 @@
+// transaction_stream.cpp
+#include "transaction_stream.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include "lz4_block.hpp"
+
+namespace APBSystem {
+
+namespace {
+const std::size_t MAX_QUEUED_BLOCKS = 4;      // 背景執行緒落後時, 分析執行緒最多領先幾個 block
+const std::size_t OUTPUT_BUFFER_BYTES = 1 << 20;
+const uint64_t INCOMPLETE_RECORD_COUNT = ~0ULL;
+
+inline uint64_t padded_length(uint64_t n) {
+    return (n + 7) & ~7ULL;
+}
+
+template <typename T, typename Getter>
+unsigned char* put_column(unsigned char* out, const std::vector<TransactionRecord>& records, Getter get) {
+    for (const auto& r : records) {
+        const T v = get(r);
+        std::memcpy(out, &v, sizeof(T));
+        out += sizeof(T);
+    }
+    return out;
+}
+}  // namespace
+
+TransactionRecord TransactionColumns::record(std::size_t i) const {
+    TransactionRecord r;
+    r.start_time_ps = start_time_ps[i];
+    r.end_time_ps = end_time_ps[i];
+    r.paddr = paddr[i];
+    r.pwdata = pwdata[i];
+    r.prdata = prdata[i];
+    r.wait_cycles = wait_cycles[i];
+    r.flags = flags[i];
+    r.completer = static_cast<CompleterID>(completer[i]);
+    return r;
+}
+
+// --- Writer ---
+TransactionStreamWriter::TransactionStreamWriter()
+    : m_fd(-1), m_lz4(false), m_closing(false), m_record_count(0), m_block_count(0), m_write_failed(false) {}
+
+TransactionStreamWriter::~TransactionStreamWriter() {
+    close();
+}
+
+bool TransactionStreamWriter::open(const std::string& path, bool lz4) {
+    m_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (m_fd == -1) {
+        std::cerr << "Error: Could not open transaction stream file: " << path << std::endl;
+        return false;
+    }
+    m_lz4 = lz4;
+    m_closing = false;
+    m_record_count = 0;
+    m_block_count = 0;
+    m_write_failed = false;
+    m_output.reserve(OUTPUT_BUFFER_BYTES);
+    m_current.reserve(TRANSACTION_STREAM_BLOCK_RECORDS);
+    // 檔頭的筆數在 close() 時才填入
+    TransactionStreamHeader header = {TRANSACTION_STREAM_MAGIC, TRANSACTION_STREAM_VERSION, TRANSACTION_STREAM_BLOCK_RECORDS,
+                                      lz4 ? static_cast<uint32_t>(STREAM_LZ4) : 0u, INCOMPLETE_RECORD_COUNT, 0};
+    buffered_write(&header, sizeof(header));
+    m_thread = std::thread(&TransactionStreamWriter::writer_loop, this);
+    return true;
+}
+
+void TransactionStreamWriter::submit_current_block() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [this] { return m_queue.size() < MAX_QUEUED_BLOCKS; });
+    m_queue.push_back(std::move(m_current));
+    if (!m_free_blocks.empty()) {
+        m_current = std::move(m_free_blocks.back());
+        m_free_blocks.pop_back();
+    } else {
+        m_current = std::vector<TransactionRecord>();
+        m_current.reserve(TRANSACTION_STREAM_BLOCK_RECORDS);
+    }
+    lock.unlock();
+    m_cv.notify_all();
+}
+
+void TransactionStreamWriter::writer_loop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_cv.wait(lock, [this] { return !m_queue.empty() || m_closing; });
+        if (m_queue.empty())
+            break;
+        std::vector<TransactionRecord> block = std::move(m_queue.front());
+        m_queue.pop_front();
+        lock.unlock();
+        m_cv.notify_all();
+        encode_block(block);
+        block.clear();
+        lock.lock();
+        m_free_blocks.push_back(std::move(block));
+    }
+}
+
+void TransactionStreamWriter::encode_block(const std::vector<TransactionRecord>& records) {
+    const std::size_t n = records.size();
+    m_columns.resize(n * TRANSACTION_RECORD_BYTES);
+    unsigned char* p = m_columns.data();
+    p = put_column<uint64_t>(p, records, [](const TransactionRecord& r) { return r.start_time_ps; });
+    p = put_column<uint64_t>(p, records, [](const TransactionRecord& r) { return r.end_time_ps; });
+    p = put_column<uint32_t>(p, records, [](const TransactionRecord& r) { return r.paddr; });
+    p = put_column<uint32_t>(p, records, [](const TransactionRecord& r) { return r.pwdata; });
+    p = put_column<uint32_t>(p, records, [](const TransactionRecord& r) { return r.prdata; });
+    p = put_column<uint32_t>(p, records, [](const TransactionRecord& r) { return r.wait_cycles; });
+    p = put_column<uint32_t>(p, records, [](const TransactionRecord& r) { return r.flags; });
+    put_column<uint8_t>(p, records, [](const TransactionRecord& r) { return static_cast<uint8_t>(r.completer); });
+
+    const std::vector<unsigned char>* payload = &m_columns;
+    TransactionBlockEncoding encoding = TransactionBlockEncoding::RAW;
+    if (m_lz4) {
+        lz4_compress(m_columns.data(), m_columns.size(), m_compressed);
+        if (m_compressed.size() < m_columns.size()) {
+            payload = &m_compressed;
+            encoding = TransactionBlockEncoding::LZ4;
+        }
+    }
+    TransactionBlockHeader header = {static_cast<uint32_t>(n), encoding, payload->size()};
+    buffered_write(&header, sizeof(header));
+    buffered_write(payload->data(), payload->size());
+    static const unsigned char zeros[8] = {0};
+    buffered_write(zeros, padded_length(payload->size()) - payload->size());
+    m_record_count += n;
+    m_block_count++;
+}
+
+void TransactionStreamWriter::buffered_write(const void* data, std::size_t len) {
+    if (m_output.size() + len > OUTPUT_BUFFER_BYTES)
+        flush_output();
+    m_output.insert(m_output.end(), static_cast<const unsigned char*>(data), static_cast<const unsigned char*>(data) + len);
+    if (m_output.size() >= OUTPUT_BUFFER_BYTES)
+        flush_output();
+}
+
+void TransactionStreamWriter::flush_output() {
+    const unsigned char* p = m_output.data();
+    std::size_t remaining = m_output.size();
+    while (remaining > 0 && !m_write_failed) {
+        ssize_t n = write(m_fd, p, remaining);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            m_write_failed = true;
+            break;
+        }
+        p += n;
+        remaining -= n;
+    }
+    m_output.clear();
+}
+
+bool TransactionStreamWriter::close() {
+    if (m_fd == -1)
+        return true;
+    if (!m_current.empty())
+        submit_current_block();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closing = true;
+    }
+    m_cv.notify_all();
+    m_thread.join();
+    flush_output();
+    // 全部寫完後才填入筆數, 讀取端以此判斷檔案是否完整
+    TransactionStreamHeader header = {TRANSACTION_STREAM_MAGIC, TRANSACTION_STREAM_VERSION, TRANSACTION_STREAM_BLOCK_RECORDS,
+                                      m_lz4 ? static_cast<uint32_t>(STREAM_LZ4) : 0u, m_record_count, m_block_count};
+    if (!m_write_failed && pwrite(m_fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)))
+        m_write_failed = true;
+    if (::close(m_fd) != 0)
+        m_write_failed = true;
+    m_fd = -1;
+    if (m_write_failed)
+        std::cerr << "Error: Failed to write transaction stream" << std::endl;
+    return !m_write_failed;
+}
+
+// --- Reader ---
+TransactionStreamReader::TransactionStreamReader() : m_data(nullptr), m_size(0), m_record_count(0) {}
+
+TransactionStreamReader::~TransactionStreamReader() {
+    close();
+}
+
+void TransactionStreamReader::close() {
+    if (m_data)
+        munmap(const_cast<unsigned char*>(m_data), m_size);
+    m_data = nullptr;
+    m_size = 0;
+    m_record_count = 0;
+    m_blocks.clear();
+}
+
+bool TransactionStreamReader::open(const std::string& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        std::cerr << "Error: cannot open " << path << "\n";
+        return false;
+    }
+    struct stat sb{};
+    if (fstat(fd, &sb) == -1 || static_cast<std::size_t>(sb.st_size) < sizeof(TransactionStreamHeader)) {
+        ::close(fd);
+        std::cerr << "Error: " << path << " is not a transaction stream\n";
+        return false;
+    }
+    m_size = sb.st_size;
+    void* file = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (file == MAP_FAILED) {
+        m_size = 0;
+        return false;
+    }
+    m_data = static_cast<const unsigned char*>(file);
+
+    TransactionStreamHeader header;
+    std::memcpy(&header, m_data, sizeof(header));
+    if (header.magic != TRANSACTION_STREAM_MAGIC || header.version != TRANSACTION_STREAM_VERSION) {
+        std::cerr << "Error: " << path << " is not a transaction stream (or was written by another version)\n";
+        close();
+        return false;
+    }
+    if (header.record_count == INCOMPLETE_RECORD_COUNT) {
+        std::cerr << "Error: " << path << " is incomplete (the writer did not finish)\n";
+        close();
+        return false;
+    }
+    // 依序走過 block header 建立索引, 同時驗證長度
+    uint64_t offset = sizeof(header);
+    uint64_t records = 0;
+    while (offset < m_size) {
+        TransactionBlockHeader block;
+        if (m_size - offset < sizeof(block))
+            break;
+        std::memcpy(&block, m_data + offset, sizeof(block));
+        offset += sizeof(block);
+        const bool known_encoding = block.encoding == TransactionBlockEncoding::RAW || block.encoding == TransactionBlockEncoding::LZ4;
+        if (!known_encoding || block.record_count > header.block_records || block.stored_bytes > m_size - offset ||
+            (block.encoding == TransactionBlockEncoding::RAW && block.stored_bytes != block.record_count * TRANSACTION_RECORD_BYTES))
+            break;
+        m_blocks.push_back({offset, records, block.record_count, block.encoding, block.stored_bytes});
+        records += block.record_count;
+        offset += padded_length(block.stored_bytes);
+    }
+    if (offset < m_size || records != header.record_count || m_blocks.size() != header.block_count) {
+        std::cerr << "Error: " << path << " is corrupted\n";
+        close();
+        return false;
+    }
+    m_record_count = records;
+    return true;
+}
+
+bool TransactionStreamReader::read_block(std::size_t block, TransactionColumns& columns) const {
+    const BlockIndex& b = m_blocks[block];
+    const std::size_t n = b.record_count;
+    const unsigned char* p = m_data + b.offset;
+    if (b.encoding == TransactionBlockEncoding::LZ4) {
+        const uint64_t raw_bytes = n * TRANSACTION_RECORD_BYTES;
+        columns.storage.resize(padded_length(raw_bytes) / 8);
+        unsigned char* out = reinterpret_cast<unsigned char*>(columns.storage.data());
+        if (!lz4_uncompress(p, b.stored_bytes, out, raw_bytes))
+            return false;
+        p = out;
+    }
+    columns.count = n;
+    columns.start_time_ps = reinterpret_cast<const uint64_t*>(p);
+    columns.end_time_ps = columns.start_time_ps + n;
+    columns.paddr = reinterpret_cast<const uint32_t*>(columns.end_time_ps + n);
+    columns.pwdata = columns.paddr + n;
+    columns.prdata = columns.pwdata + n;
+    columns.wait_cycles = columns.prdata + n;
+    columns.flags = columns.wait_cycles + n;
+    columns.completer = reinterpret_cast<const uint8_t*>(columns.flags + n);
+    return true;
+}
+
+}  // namespace APBSystem
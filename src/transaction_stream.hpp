@@ -0,0 +1,139 @@
+// transaction_stream.hpp
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "apb_types.hpp"
+
+namespace APBSystem {
+
+// --- 已完成交易的二進位匯出檔 (.apbt) ---
+// 下游工具只需要交易序列時, 讀這個檔案即可, 不必重新解析 VCD
+// 佈局 (本機位元組序, 所有欄位 8-byte 對齊):
+//   TransactionStreamHeader
+//   block*: TransactionBlockHeader + payload (補齊到 8 bytes)
+// 每個 block 最多 block_records 筆, payload 以欄位為單位連續存放 (columnar):
+//   start_time_ps[n] end_time_ps[n] (u64) | paddr[n] pwdata[n] prdata[n] wait_cycles[n] flags[n] (u32) | completer[n] (u8)
+// 壓縮後沒有變小的 block 以原始格式存放, 讀取時可以直接指向 mmap 的內容
+const uint32_t TRANSACTION_STREAM_MAGIC = 0x54425041;  // "APBT"
+const uint32_t TRANSACTION_STREAM_VERSION = 1;
+const uint32_t TRANSACTION_STREAM_BLOCK_RECORDS = 65536;
+const uint64_t TRANSACTION_RECORD_BYTES = 2 * 8 + 5 * 4 + 1;
+
+enum TransactionStreamFlag : uint32_t {
+    STREAM_LZ4 = 1u << 0  // 寫入時要求壓縮 (個別 block 仍可能是原始格式)
+};
+enum class TransactionBlockEncoding : uint32_t { RAW = 0,
+                                                 LZ4 = 1 };
+
+struct TransactionStreamHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t block_records;
+    uint32_t flags;
+    uint64_t record_count;  // 寫入完成時才填入; 中途中止的檔案為 UINT64_MAX
+    uint64_t block_count;
+};
+struct TransactionBlockHeader {
+    uint32_t record_count;
+    TransactionBlockEncoding encoding;
+    uint64_t stored_bytes;  // payload 長度 (不含補齊)
+};
+
+// 一個 block 的欄位; RAW block 直接指向 mmap, LZ4 block 指向 storage
+struct TransactionColumns {
+    std::size_t count = 0;
+    const uint64_t* start_time_ps = nullptr;
+    const uint64_t* end_time_ps = nullptr;
+    const uint32_t* paddr = nullptr;
+    const uint32_t* pwdata = nullptr;
+    const uint32_t* prdata = nullptr;
+    const uint32_t* wait_cycles = nullptr;
+    const uint32_t* flags = nullptr;
+    const uint8_t* completer = nullptr;
+    std::vector<uint64_t> storage;  // 解壓縮的 buffer (uint64_t 確保對齊)
+
+    TransactionRecord record(std::size_t i) const;
+};
+
+// 分析執行緒只把交易複製進目前的 block; 寫滿的 block 交給背景執行緒轉成 columnar 格式,
+// 壓縮後經由緩衝的 write() 寫出
+class TransactionStreamWriter {
+   public:
+    TransactionStreamWriter();
+    ~TransactionStreamWriter();
+
+    bool open(const std::string& path, bool lz4);
+    void append(const TransactionRecord& record) {
+        m_current.push_back(record);
+        if (m_current.size() == TRANSACTION_STREAM_BLOCK_RECORDS)
+            submit_current_block();
+    }
+    // 寫出剩下的交易與檔頭; 任何一次寫入失敗都回傳 false
+    bool close();
+
+   private:
+    void submit_current_block();
+    void writer_loop();
+    void encode_block(const std::vector<TransactionRecord>& records);
+    void buffered_write(const void* data, std::size_t len);
+    void flush_output();
+
+    int m_fd;
+    bool m_lz4;
+    std::vector<TransactionRecord> m_current;
+
+    // 分析執行緒與背景執行緒共用
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<std::vector<TransactionRecord>> m_queue;
+    std::vector<std::vector<TransactionRecord>> m_free_blocks;  // 重複使用, 避免每個 block 重新配置
+    bool m_closing;
+    std::thread m_thread;
+
+    // 只有背景執行緒使用
+    std::vector<unsigned char> m_columns;
+    std::vector<unsigned char> m_compressed;
+    std::vector<unsigned char> m_output;
+    uint64_t m_record_count;
+    uint64_t m_block_count;
+    bool m_write_failed;
+};
+
+class TransactionStreamReader {
+   public:
+    TransactionStreamReader();
+    ~TransactionStreamReader();
+
+    // mmap 整個檔案並建立 block 索引; 檔案不完整或損毀時回傳 false
+    bool open(const std::string& path);
+    void close();
+
+    uint64_t record_count() const { return m_record_count; }
+    std::size_t block_count() const { return m_blocks.size(); }
+    // 第 block 個 block 第一筆交易的序號
+    uint64_t block_first_record(std::size_t block) const { return m_blocks[block].first_record; }
+    bool read_block(std::size_t block, TransactionColumns& columns) const;
+
+   private:
+    struct BlockIndex {
+        uint64_t offset;  // payload 在檔案中的位置
+        uint64_t first_record;
+        uint32_t record_count;
+        TransactionBlockEncoding encoding;
+        uint64_t stored_bytes;
+    };
+
+    const unsigned char* m_data;
+    std::size_t m_size;
+    uint64_t m_record_count;
+    std::vector<BlockIndex> m_blocks;
+};
+
+}  // namespace APBSystem
@@ -0,0 +1,87 @@
+// utilization_timeline.cpp
+#include "utilization_timeline.hpp"
+#include "checkpoint.hpp"
+
+namespace APBSystem {
+
+UtilizationTimeline::UtilizationTimeline()
+    : m_enabled(false), m_unit(TimelineUnit::PCLK_EDGES), m_bucket_width(1), m_first_bucket_index(0), m_current_end(0) {}
+
+void UtilizationTimeline::enable(TimelineUnit unit, uint64_t bucket_width, uint64_t expected_buckets) {
+    m_enabled = true;
+    m_unit = unit;
+    m_bucket_width = bucket_width > 0 ? bucket_width : 1;
+    m_first_bucket_index = 0;
+    m_current_end = 0;
+    m_buckets.clear();
+    if (expected_buckets > 0)
+        m_buckets.reserve(expected_buckets);
+}
+
+void UtilizationTimeline::advance_to(uint64_t key) {
+    const TimelineBucket empty = {0, 0, 0, 0, 0};
+    uint64_t index = key / m_bucket_width;
+    if (m_buckets.empty())
+        m_first_bucket_index = index;
+    // 中間沒有任何 edge 的區間也保留, 讓輸出的時間軸是連續的
+    m_buckets.resize(index - m_first_bucket_index + 1, empty);
+    m_current_end = (index + 1) * m_bucket_width;
+}
+
+void UtilizationTimeline::on_transaction(bool is_write, uint64_t wait_cycles) {
+    if (m_buckets.empty())
+        return;
+    TimelineBucket& b = m_buckets.back();
+    if (is_write)
+        b.writes++;
+    else
+        b.reads++;
+    b.wait_cycles += static_cast<uint32_t>(wait_cycles);
+}
+
+void UtilizationTimeline::merge(const UtilizationTimeline& later) {
+    if (!later.m_enabled || later.m_buckets.empty())
+        return;
+    if (m_buckets.empty()) {
+        m_first_bucket_index = later.m_first_bucket_index;
+        m_current_end = later.m_current_end;
+        m_buckets = later.m_buckets;
+        return;
+    }
+    const TimelineBucket empty = {0, 0, 0, 0, 0};
+    if (later.m_first_bucket_index < m_first_bucket_index) {
+        m_buckets.insert(m_buckets.begin(), m_first_bucket_index - later.m_first_bucket_index, empty);
+        m_first_bucket_index = later.m_first_bucket_index;
+    }
+    const uint64_t later_end = later.m_first_bucket_index + later.m_buckets.size();
+    if (later_end > m_first_bucket_index + m_buckets.size())
+        m_buckets.resize(later_end - m_first_bucket_index, empty);
+    for (std::size_t i = 0; i < later.m_buckets.size(); ++i) {
+        TimelineBucket& b = m_buckets[later.m_first_bucket_index - m_first_bucket_index + i];
+        const TimelineBucket& l = later.m_buckets[i];
+        b.pclk_edges += l.pclk_edges;
+        b.active_edges += l.active_edges;
+        b.reads += l.reads;
+        b.writes += l.writes;
+        b.wait_cycles += l.wait_cycles;
+    }
+    if (later.m_current_end > m_current_end)
+        m_current_end = later.m_current_end;
+}
+
+void UtilizationTimeline::save_state(CheckpointWriter& w) const {
+    w.write_pod(m_enabled);
+    w.write_pod(m_unit);
+    w.write_pod(m_bucket_width);
+    w.write_pod(m_first_bucket_index);
+    w.write_pod(m_current_end);
+    w.write_pod_vector(m_buckets);
+}
+
+bool UtilizationTimeline::load_state(CheckpointReader& r) {
+    // bucket 寬度是除數, 不能為 0
+    return r.read_bool(m_enabled) && r.read_enum(m_unit, TimelineUnit::PICOSECONDS) && r.read_pod(m_bucket_width) && m_bucket_width > 0 &&
+           r.read_pod(m_first_bucket_index) && r.read_pod(m_current_end) && r.read_pod_vector(m_buckets);
+}
+
+}  // namespace APBSystem
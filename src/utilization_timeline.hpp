@@ -0,0 +1,69 @@
+// utilization_timeline.hpp
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace APBSystem {
+
+class CheckpointWriter;
+class CheckpointReader;
+
+enum class TimelineUnit : uint32_t { PCLK_EDGES,
+                                     PICOSECONDS };
+
+// 一個時間區間內的統計; 交易算在完成時所在的區間
+struct TimelineBucket {
+    uint32_t pclk_edges;
+    uint32_t active_edges;
+    uint32_t reads;
+    uint32_t writes;
+    uint32_t wait_cycles;
+};
+
+// 固定寬度的 bus utilization 時間軸
+// key (edge 編號或 ps) 只會遞增, 因此每個 edge 只需比較一次區間結尾再加一
+class UtilizationTimeline {
+   public:
+    UtilizationTimeline();
+
+    // expected_buckets > 0 時預先配置空間
+    void enable(TimelineUnit unit, uint64_t bucket_width, uint64_t expected_buckets);
+    bool is_enabled() const { return m_enabled; }
+    TimelineUnit get_unit() const { return m_unit; }
+    uint64_t get_bucket_width() const { return m_bucket_width; }
+
+    void on_pclk_edge(uint64_t pclk_edge_count, uint64_t timestamp) {
+        uint64_t key = m_unit == TimelineUnit::PCLK_EDGES ? pclk_edge_count : timestamp;
+        if (key >= m_current_end)
+            advance_to(key);
+        m_buckets.back().pclk_edges++;
+    }
+    void on_active_edge() {
+        if (!m_buckets.empty())
+            m_buckets.back().active_edges++;
+    }
+    void on_transaction(bool is_write, uint64_t wait_cycles);
+
+    // 第 i 個 bucket 的起點為 (first_bucket_index + i) * bucket_width
+    uint64_t get_first_bucket_index() const { return m_first_bucket_index; }
+    const std::vector<TimelineBucket>& get_buckets() const { return m_buckets; }
+
+    // later 是之後一段時間的時間軸 (時間切片); 同一個 bucket 的計數相加
+    void merge(const UtilizationTimeline& later);
+
+    void save_state(CheckpointWriter& w) const;
+    bool load_state(CheckpointReader& r);
+
+   private:
+    void advance_to(uint64_t key);
+
+    bool m_enabled;
+    TimelineUnit m_unit;
+    uint64_t m_bucket_width;
+    uint64_t m_first_bucket_index;
+    uint64_t m_current_end;
+    std::vector<TimelineBucket> m_buckets;
+};
+
+}  // namespace APBSystem
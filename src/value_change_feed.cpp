@@ -0,0 +1,277 @@
+// value_change_feed.cpp
+#include "value_change_feed.hpp"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+namespace APBSystem {
+
+void decode_vcd_value(const char* value_ptr, std::size_t value_len, uint32_t& value, uint32_t& xmask) {
+    // 與 SignalManager::parse_vcd_value_to_uint 相同的規則: 逐位元左移, 非 01xz 的字元略過
+    value = 0;
+    xmask = 0;
+    bool truncated_x = false;
+    std::size_t start_idx = (value_len > 0 && (value_ptr[0] == 'b' || value_ptr[0] == 'B')) ? 1 : 0;
+    if (start_idx >= value_len) {
+        xmask = 0xFFFFFFFFu;
+        return;
+    }
+    for (std::size_t i = start_idx; i < value_len; ++i) {
+        char c = value_ptr[i];
+        if (c == '0' || c == '1') {
+            truncated_x = truncated_x || (xmask & 0x80000000u);
+            value = (value << 1) | (c == '1');
+            xmask <<= 1;
+        } else if (c == 'x' || c == 'X' || c == 'z' || c == 'Z') {
+            truncated_x = truncated_x || (xmask & 0x80000000u);
+            value <<= 1;
+            xmask = (xmask << 1) | 1u;
+        }
+    }
+    if (truncated_x)
+        xmask |= 0x80000000u;
+}
+
+// --- Writer ---
+ValueChangeFeedWriter::ValueChangeFeedWriter(int fd, std::size_t batch_records, bool delta_time)
+    : m_fd(fd), m_batch_limit(batch_records > 0 ? batch_records : 1), m_delta_time(delta_time) {
+    if (m_delta_time)
+        m_delta_batch.reserve(m_batch_limit);
+    else
+        m_batch.reserve(m_batch_limit);
+}
+
+bool ValueChangeFeedWriter::write_all(const void* data, std::size_t len) {
+    const char* p = static_cast<const char*>(data);
+    while (len > 0) {
+        ssize_t n = ::write(m_fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            std::cerr << "Error: value-change feed write failed: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+bool ValueChangeFeedWriter::write_frame(FeedFrameKind kind, const void* payload, uint32_t payload_bytes) {
+    FeedFrameHeader header{FEED_FRAME_MAGIC, static_cast<uint32_t>(kind), payload_bytes, 0};
+    return write_all(&header, sizeof(header)) && (payload_bytes == 0 || write_all(payload, payload_bytes));
+}
+
+bool ValueChangeFeedWriter::define_signal(uint32_t signal_index, const std::string& type_str, int width, const std::string& name) {
+    std::vector<char> payload(4 * sizeof(uint32_t) + type_str.size() + name.size());
+    uint32_t fields[4] = {signal_index, static_cast<uint32_t>(width), static_cast<uint32_t>(type_str.size()), static_cast<uint32_t>(name.size())};
+    std::memcpy(payload.data(), fields, sizeof(fields));
+    std::memcpy(payload.data() + sizeof(fields), type_str.data(), type_str.size());
+    std::memcpy(payload.data() + sizeof(fields) + type_str.size(), name.data(), name.size());
+    return write_frame(FeedFrameKind::SIGNAL_DEFINITION, payload.data(), payload.size());
+}
+
+bool ValueChangeFeedWriter::end_definitions() {
+    return write_frame(FeedFrameKind::END_DEFINITIONS, nullptr, 0);
+}
+
+bool ValueChangeFeedWriter::push(const ValueChangeRecord& record) {
+    if (m_delta_time) {
+        if (record.time_ps < m_last_time_ps || record.time_ps - m_last_time_ps > 0xFFFFFFFFu) {
+            m_delta_batch.push_back({0, FEED_TIME_BASE_INDEX, static_cast<uint32_t>(record.time_ps >> 32), static_cast<uint32_t>(record.time_ps)});
+            m_pending_time_bases++;
+            m_last_time_ps = record.time_ps;
+        }
+        m_delta_batch.push_back({static_cast<uint32_t>(record.time_ps - m_last_time_ps), record.signal_index, record.value, record.xmask});
+        m_last_time_ps = record.time_ps;
+        if (m_delta_batch.size() >= m_batch_limit)
+            return flush_records();
+        return true;
+    }
+    m_batch.push_back(record);
+    if (m_batch.size() >= m_batch_limit)
+        return flush_records();
+    return true;
+}
+
+bool ValueChangeFeedWriter::flush_records() {
+    bool ok = true;
+    if (!m_delta_batch.empty()) {
+        ok = write_frame(FeedFrameKind::VALUE_CHANGES_DELTA, m_delta_batch.data(), m_delta_batch.size() * sizeof(DeltaValueChangeRecord));
+        m_records_written += m_delta_batch.size() - m_pending_time_bases;
+        m_delta_batch.clear();
+        m_pending_time_bases = 0;
+    }
+    if (ok && !m_batch.empty()) {
+        ok = write_frame(FeedFrameKind::VALUE_CHANGES, m_batch.data(), m_batch.size() * sizeof(ValueChangeRecord));
+        m_records_written += m_batch.size();
+        m_batch.clear();
+    }
+    return ok;
+}
+
+bool ValueChangeFeedWriter::finish() {
+    return flush_records() && write_frame(FeedFrameKind::END_OF_STREAM, nullptr, 0);
+}
+
+// --- Reader ---
+ValueChangeFeedReader::ValueChangeFeedReader(int fd) : m_fd(fd) {}
+
+bool ValueChangeFeedReader::read_exact(void* data, std::size_t len) {
+    char* p = static_cast<char*>(data);
+    while (len > 0) {
+        ssize_t n = ::read(m_fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            std::cerr << "Error: value-change feed read failed: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        if (n == 0)
+            return false;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+bool ValueChangeFeedReader::run(SignalDefinitionCallback def_cb,
+                                EndDefinitionsCallback end_def_cb,
+                                RecordBatchCallback batch_cb) {
+    while (true) {
+        FeedFrameHeader header{};
+        if (!read_exact(&header, sizeof(header))) {
+            std::cerr << "Error: value-change feed ended without END_OF_STREAM" << std::endl;
+            return false;
+        }
+        if (header.magic != FEED_FRAME_MAGIC) {
+            std::cerr << "Error: value-change feed is out of sync (bad frame magic)" << std::endl;
+            return false;
+        }
+        m_payload.resize(header.payload_bytes);
+        if (header.payload_bytes > 0 && !read_exact(m_payload.data(), header.payload_bytes))
+            return false;
+
+        switch (static_cast<FeedFrameKind>(header.kind)) {
+            case FeedFrameKind::SIGNAL_DEFINITION: {
+                uint32_t fields[4];
+                if (header.payload_bytes < sizeof(fields))
+                    return false;
+                std::memcpy(fields, m_payload.data(), sizeof(fields));
+                if (sizeof(fields) + static_cast<uint64_t>(fields[2]) + fields[3] > header.payload_bytes)
+                    return false;
+                if (fields[0] > FEED_MAX_SIGNAL_INDEX) {
+                    std::cerr << "Error: value-change feed defines signal index " << fields[0] << " (limit " << FEED_MAX_SIGNAL_INDEX << ")" << std::endl;
+                    return false;
+                }
+                const char* text = m_payload.data() + sizeof(fields);
+                if (def_cb)
+                    def_cb(fields[0], std::string(text, fields[2]), static_cast<int>(fields[1]), std::string(text + fields[2], fields[3]));
+            } break;
+            case FeedFrameKind::END_DEFINITIONS:
+                if (end_def_cb)
+                    end_def_cb();
+                break;
+            case FeedFrameKind::VALUE_CHANGES: {
+                if (header.payload_bytes % sizeof(ValueChangeRecord) != 0) {
+                    std::cerr << "Error: value-change feed has a truncated VALUE_CHANGES frame" << std::endl;
+                    return false;
+                }
+                std::size_t count = header.payload_bytes / sizeof(ValueChangeRecord);
+                const ValueChangeRecord* records = reinterpret_cast<const ValueChangeRecord*>(m_payload.data());
+                if (count > 0)
+                    m_last_time_ps = records[count - 1].time_ps;
+                if (batch_cb && count > 0)
+                    batch_cb(records, count);
+            } break;
+            case FeedFrameKind::VALUE_CHANGES_DELTA: {
+                if (header.payload_bytes % sizeof(DeltaValueChangeRecord) != 0) {
+                    std::cerr << "Error: value-change feed has a truncated VALUE_CHANGES_DELTA frame" << std::endl;
+                    return false;
+                }
+                std::size_t count = header.payload_bytes / sizeof(DeltaValueChangeRecord);
+                const DeltaValueChangeRecord* deltas = reinterpret_cast<const DeltaValueChangeRecord*>(m_payload.data());
+                m_expanded.clear();
+                for (std::size_t i = 0; i < count; ++i) {
+                    if (deltas[i].signal_index == FEED_TIME_BASE_INDEX) {
+                        m_last_time_ps = (static_cast<uint64_t>(deltas[i].value) << 32) | deltas[i].xmask;
+                        continue;
+                    }
+                    m_last_time_ps += deltas[i].time_delta_ps;
+                    m_expanded.push_back({m_last_time_ps, deltas[i].signal_index, deltas[i].value, deltas[i].xmask, 0});
+                }
+                if (batch_cb && !m_expanded.empty())
+                    batch_cb(m_expanded.data(), m_expanded.size());
+            } break;
+            case FeedFrameKind::END_OF_STREAM:
+                return true;
+            default:
+                std::cerr << "Error: value-change feed has unknown frame kind " << header.kind << std::endl;
+                return false;
+        }
+    }
+}
+
+// --- Unix domain socket ---
+namespace {
+bool fill_socket_address(const std::string& path, sockaddr_un& addr) {
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "Error: socket path too long: " << path << std::endl;
+        return false;
+    }
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+}  // namespace
+
+int listen_unix_socket(const std::string& path) {
+    sockaddr_un addr;
+    if (!fill_socket_address(path, addr))
+        return -1;
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1)
+        return -1;
+    ::unlink(path.c_str());
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1 || ::listen(fd, 1) == -1) {
+        std::cerr << "Error: cannot listen on " << path << ": " << std::strerror(errno) << std::endl;
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int accept_unix_socket(int listen_fd) {
+    while (true) {
+        int fd = ::accept(listen_fd, nullptr, nullptr);
+        if (fd == -1 && errno == EINTR)
+            continue;
+        return fd;
+    }
+}
+
+int connect_unix_socket(const std::string& path, int retry_ms) {
+    sockaddr_un addr;
+    if (!fill_socket_address(path, addr))
+        return -1;
+    // consumer 可能還沒開始 listen, 在 retry_ms 內重試
+    for (int waited_ms = 0;; waited_ms += 50) {
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd == -1)
+            return -1;
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0)
+            return fd;
+        ::close(fd);
+        if (waited_ms >= retry_ms) {
+            std::cerr << "Error: cannot connect to " << path << ": " << std::strerror(errno) << std::endl;
+            return -1;
+        }
+        ::usleep(50 * 1000);
+    }
+}
+
+}  // namespace APBSystem
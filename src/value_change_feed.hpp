@@ -0,0 +1,112 @@
+// value_change_feed.hpp
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace APBSystem {
+
+// --- 二進位 value-change feed (模擬器端直接送出已解碼的值, 不經過 VCD 文字) ---
+//
+// 串流由多個 frame 組成: FeedFrameHeader + payload
+//   SIGNAL_DEFINITION : uint32 index, int32 width, uint32 type_len, uint32 name_len, type, name
+//   END_DEFINITIONS   : 無 payload
+//   VALUE_CHANGES     : N 筆 ValueChangeRecord
+//   VALUE_CHANGES_DELTA : N 筆 DeltaValueChangeRecord, 時間為與前一筆 (包含前面的 frame) 的差值
+//   END_OF_STREAM     : 無 payload
+
+// 一筆已解碼的 value change; xmask 的 bit i 代表該位元為 x/z.
+// 超過 32 bit 的值只保留低 32 bit, 高位元中的 x/z 併入 xmask 的 bit 31.
+struct ValueChangeRecord {
+    uint64_t time_ps;
+    uint32_t signal_index;  // FEED_TIME_ONLY_INDEX 表示只推進時間 (對應沒有變化的 #timestamp)
+    uint32_t value;
+    uint32_t xmask;
+    uint32_t reserved;
+};
+const uint32_t FEED_TIME_ONLY_INDEX = 0xFFFFFFFFu;
+const uint32_t FEED_TIME_BASE_INDEX = 0xFFFFFFFEu;
+// SIGNAL_DEFINITION 的 index 上限 (接收端依 index 配置訊號表); 超過的 frame 視為格式錯誤
+const uint32_t FEED_MAX_SIGNAL_INDEX = (1u << 20) - 1;
+
+// delta 模式的 record: 16 byte (ValueChangeRecord 是 24 byte). 差值放不進 32 bit 或時間倒退時,
+// 先送一筆 FEED_TIME_BASE_INDEX record (value/xmask 為絕對時間的高/低 32 bit), 之後的差值以它為基準
+struct DeltaValueChangeRecord {
+    uint32_t time_delta_ps;
+    uint32_t signal_index;
+    uint32_t value;
+    uint32_t xmask;
+};
+
+enum class FeedFrameKind : uint32_t { SIGNAL_DEFINITION = 1,
+                                      END_DEFINITIONS = 2,
+                                      VALUE_CHANGES = 3,
+                                      END_OF_STREAM = 4,
+                                      VALUE_CHANGES_DELTA = 5 };
+
+struct FeedFrameHeader {
+    uint32_t magic;
+    uint32_t kind;
+    uint32_t payload_bytes;
+    uint32_t reserved;
+};
+const uint32_t FEED_FRAME_MAGIC = 0x44464341;  // "ACFD"
+
+// 將 VCD 的值字串 ("b1010", "1", "x" ...) 解碼成 value / xmask
+void decode_vcd_value(const char* value_ptr, std::size_t value_len, uint32_t& value, uint32_t& xmask);
+
+class ValueChangeFeedWriter {
+   public:
+    // delta_time: 批次中的時間以差值保存與傳送, 縮小緩衝區與傳輸量
+    explicit ValueChangeFeedWriter(int fd, std::size_t batch_records = 4096, bool delta_time = false);
+
+    bool define_signal(uint32_t signal_index, const std::string& type_str, int width, const std::string& name);
+    bool end_definitions();
+    bool push(const ValueChangeRecord& record);
+    // 送出剩餘的 records 與 END_OF_STREAM
+    bool finish();
+    uint64_t get_records_written() const { return m_records_written; }
+
+   private:
+    bool flush_records();
+    bool write_frame(FeedFrameKind kind, const void* payload, uint32_t payload_bytes);
+    bool write_all(const void* data, std::size_t len);
+
+    int m_fd;
+    std::size_t m_batch_limit;
+    bool m_delta_time;
+    std::vector<ValueChangeRecord> m_batch;
+    std::vector<DeltaValueChangeRecord> m_delta_batch;
+    std::size_t m_pending_time_bases = 0;  // m_delta_batch 中不算 value change 的 time base record
+    uint64_t m_last_time_ps = 0;
+    uint64_t m_records_written = 0;
+};
+
+class ValueChangeFeedReader {
+   public:
+    using SignalDefinitionCallback = std::function<void(uint32_t signal_index, const std::string& type_str, int width, const std::string& name)>;
+    using EndDefinitionsCallback = std::function<void()>;
+    using RecordBatchCallback = std::function<void(const ValueChangeRecord* records, std::size_t count)>;
+
+    explicit ValueChangeFeedReader(int fd);
+    // 讀到 END_OF_STREAM 時回傳 true; 連線中斷或格式錯誤回傳 false
+    bool run(SignalDefinitionCallback, EndDefinitionsCallback, RecordBatchCallback);
+
+   private:
+    bool read_exact(void* data, std::size_t len);
+
+    int m_fd;
+    std::vector<char> m_payload;
+    std::vector<ValueChangeRecord> m_expanded;  // delta frame 還原成絕對時間後的 records (不含 time base)
+    uint64_t m_last_time_ps = 0;
+};
+
+// --- Unix domain socket 輔助函式, 失敗時回傳 -1 ---
+int listen_unix_socket(const std::string& path);
+int accept_unix_socket(int listen_fd);
+int connect_unix_socket(const std::string& path, int retry_ms);
+
+}  // namespace APBSystem
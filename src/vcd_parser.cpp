@@ -1,21 +1,125 @@
 #include "vcd_parser.hpp"
 #include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
-#include <cstdlib>
+#include <algorithm>
+#include <cerrno>
 #include <cstring>
 #include <iostream>
 
 namespace APBSystem {
 
+uint32_t VcdScopeTable::enter(uint32_t parent, const char* name, std::size_t len) {
+    auto inserted = m_name_index.emplace(std::string(name, len), static_cast<uint32_t>(m_names.size()));
+    if (inserted.second)
+        m_names.push_back(&inserted.first->first);
+    m_nodes.push_back({parent, inserted.first->second});
+    return static_cast<uint32_t>(m_nodes.size() - 1);
+}
+
+void VcdScopeTable::append_path(uint32_t scope, std::string& out) const {
+    if (scope == ROOT)
+        return;
+    append_path(m_nodes[scope].parent, out);
+    if (!out.empty())
+        out += '.';
+    out += *m_names[m_nodes[scope].name_index];
+}
+
+void VcdScopeTable::clear() {
+    m_nodes.clear();
+    m_name_index.clear();
+    m_names.clear();
+}
+
+std::string VcdVarDefinition::hierarchical_name() const {
+    std::string full_name;
+    scopes->append_path(scope, full_name);
+    if (!full_name.empty())
+        full_name += '.';
+    full_name.append(name, name_len);
+    return full_name;
+}
+
+namespace {
+inline bool is_blank(char c) {
+    return c == ' ' || c == '\t';
+}
+inline bool keyword_equals(const char* begin, const char* end, const char* literal, std::size_t literal_len) {
+    return static_cast<std::size_t>(end - begin) == literal_len && std::memcmp(begin, literal, literal_len) == 0;
+}
+// 與 atoi 相同的規則, 但不會讀超過 end
+int parse_int_token(const char* p, const char* end) {
+    bool negative = p < end && *p == '-';
+    if (p < end && (*p == '-' || *p == '+'))
+        ++p;
+    int value = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; ++p)
+        value = value * 10 + (*p - '0');
+    return negative ? -value : value;
+}
+
+// 8 個 ASCII 位數 (little-endian 載入, 第一個字元在最低的 byte) 是否全部介於 '0'..'9'
+inline bool is_eight_digits(uint64_t chunk) {
+    return ((chunk & 0xF0F0F0F0F0F0F0F0ull) == 0x3030303030303030ull) &&
+           (((chunk + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) == 0x3030303030303030ull);
+}
+// 相鄰位數兩兩合併: 1 位數 -> 2 位數 -> 4 位數 -> 8 位數, 只需要三次乘法
+inline uint32_t eight_digits_value(uint64_t chunk) {
+    chunk = ((chunk & 0x0F0F0F0F0F0F0F0Full) * 2561) >> 8;
+    chunk = ((chunk & 0x00FF00FF00FF00FFull) * 6553601) >> 16;
+    return static_cast<uint32_t>(((chunk & 0x0000FFFF0000FFFFull) * 42949672960001ull) >> 32);
+}
+}  // namespace
+
+uint64_t VcdParser::parse_decimal_u64(const char* p, const char* end) {
+    uint64_t value = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    while (end - p >= 8) {
+        uint64_t chunk;
+        std::memcpy(&chunk, p, sizeof(chunk));
+        if (!is_eight_digits(chunk))
+            break;
+        value = value * 100000000ull + eight_digits_value(chunk);
+        p += 8;
+    }
+#endif
+    for (; p < end && static_cast<unsigned>(*p - '0') < 10u; ++p)
+        value = value * 10 + static_cast<unsigned>(*p - '0');
+    return value;
+}
+
 VcdParser::VcdParser() {}
 
+void VcdParser::set_callbacks(VarDefinitionCallback var_def_cb,
+                              TimestampCallback time_cb,
+                              ValueChangeCallback val_change_cb,
+                              EndDefinitionsCallback end_def_cb) {
+    m_var_def_cb = var_def_cb;
+    m_time_cb = time_cb;
+    m_val_change_cb = val_change_cb;
+    m_end_def_cb = end_def_cb;
+}
+
+void VcdParser::reset_stream_state() {
+    m_consumed_bytes = 0;
+    m_skip_until_offset = 0;
+    m_scopes.clear();
+    m_current_scope = VcdScopeTable::ROOT;
+    m_partial_line.clear();
+    m_stop_requested = false;
+}
+
 bool VcdParser::parse_file(const std::string& filename,
                            VarDefinitionCallback var_def_cb,
                            TimestampCallback time_cb,
                            ValueChangeCallback val_change_cb,
                            EndDefinitionsCallback end_def_cb) {
+    set_callbacks(var_def_cb, time_cb, val_change_cb, end_def_cb);
+    reset_stream_state();
     // Memory-map the file
     int fd = open(filename.c_str(), O_RDONLY);
     if (fd == -1) {
@@ -37,126 +141,261 @@ bool VcdParser::parse_file(const std::string& filename,
     if (file == MAP_FAILED)
         return false;
 
-    // Main parsing loop
-    const char* ptr = file;
-    const char* const end_ptr = file + size;
-    std::string current_scope;
+    parse_buffer(file, file + size, true);
+
+    munmap(file, size);
+    return true;
+}
+
+void VcdParser::begin_stream(VarDefinitionCallback var_def_cb,
+                             TimestampCallback time_cb,
+                             ValueChangeCallback val_change_cb,
+                             EndDefinitionsCallback end_def_cb) {
+    set_callbacks(var_def_cb, time_cb, val_change_cb, end_def_cb);
+    reset_stream_state();
+}
+
+void VcdParser::feed(const char* data, std::size_t len) {
+    const char* const end_ptr = data + len;
+    if (!m_partial_line.empty()) {
+        // 上一次留下不完整的行: 先補齊到第一個換行字元再處理
+        const char* nl = static_cast<const char*>(std::memchr(data, '\n', len));
+        if (nl == nullptr) {
+            m_partial_line.append(data, len);
+            return;
+        }
+        m_partial_line.append(data, nl + 1 - data);
+        parse_buffer(m_partial_line.data(), m_partial_line.data() + m_partial_line.size(), false);
+        m_partial_line.clear();
+        data = nl + 1;
+    }
+    const char* consumed_end = parse_buffer(data, end_ptr, false);
+    m_partial_line.assign(consumed_end, end_ptr - consumed_end);
+}
+
+void VcdParser::finish() {
+    if (!m_partial_line.empty()) {
+        parse_buffer(m_partial_line.data(), m_partial_line.data() + m_partial_line.size(), true);
+        m_partial_line.clear();
+    }
+}
+
+bool VcdParser::follow_file(const std::string& filename,
+                            const FollowOptions& options,
+                            VarDefinitionCallback var_def_cb,
+                            TimestampCallback time_cb,
+                            ValueChangeCallback val_change_cb,
+                            EndDefinitionsCallback end_def_cb,
+                            FollowPollCallback on_poll) {
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1) {
+        std::cerr << "Error: cannot open " << filename << "\n";
+        return false;
+    }
+    // inotify 只用來提早喚醒; 不支援時退回固定間隔 polling
+    int notify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (notify_fd != -1 && inotify_add_watch(notify_fd, filename.c_str(), IN_MODIFY | IN_CLOSE_WRITE) == -1) {
+        close(notify_fd);
+        notify_fd = -1;
+    }
+
+    begin_stream(var_def_cb, time_cb, val_change_cb, end_def_cb);
+    std::vector<char> buffer(options.read_chunk_bytes);
+    uint64_t file_offset = 0;
+    uint64_t idle_ms = 0;
+    bool ok = true;
+    while (true) {
+        ssize_t n = read(fd, buffer.data(), buffer.size());
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            std::cerr << "Error: read failed on " << filename << "\n";
+            ok = false;
+            break;
+        }
+        if (n > 0) {
+            feed(buffer.data(), static_cast<std::size_t>(n));
+            file_offset += n;
+            idle_ms = 0;
+            if (on_poll && !on_poll())
+                break;
+            continue;
+        }
+
+        // EOF: 檢查檔案是否被截斷 (模擬器重新開始寫)
+        struct stat sb{};
+        if (fstat(fd, &sb) == 0 && static_cast<uint64_t>(sb.st_size) < file_offset) {
+            std::cerr << "Error: " << filename << " was truncated while following\n";
+            ok = false;
+            break;
+        }
+        if (on_poll && !on_poll())
+            break;
+        if (options.idle_timeout_ms > 0 && idle_ms >= options.idle_timeout_ms)
+            break;
+        if (notify_fd != -1) {
+            struct pollfd pfd{notify_fd, POLLIN, 0};
+            if (::poll(&pfd, 1, options.poll_interval_ms) > 0) {
+                char events[4096];
+                while (read(notify_fd, events, sizeof(events)) > 0) {
+                }
+            }
+        } else {
+            usleep(options.poll_interval_ms * 1000);
+        }
+        idle_ms += options.poll_interval_ms;
+    }
+    finish();
+    if (notify_fd != -1)
+        close(notify_fd);
+    close(fd);
+    return ok;
+}
+
+const char* VcdParser::parse_buffer(const char* begin, const char* end_ptr, bool is_final) {
+    // m_consumed_bytes 是 begin 在整個 VCD 中的絕對位置
+    const uint64_t base_offset = m_consumed_bytes;
+    const char* ptr = begin;
+    if (m_skip_until_offset > base_offset) {
+        ptr = begin + std::min<uint64_t>(m_skip_until_offset - base_offset, end_ptr - begin);
+        m_consumed_bytes = base_offset + (ptr - begin);
+    }
 
     while (ptr < end_ptr) {
         // Skip leading whitespace / EOL
         while (ptr < end_ptr && (*ptr == ' ' || *ptr == '\t' || *ptr == '\r' || *ptr == '\n'))
             ++ptr;
-        if (ptr >= end_ptr)
+        if (ptr >= end_ptr) {
+            m_consumed_bytes = base_offset + (ptr - begin);
             break;
+        }
 
         // Find the end of the current line
         const char* line_start = ptr;
         const char* line_end = ptr;
         while (line_end < end_ptr && *line_end != '\n' && *line_end != '\r')
             ++line_end;
+        if (line_end == end_ptr && (!is_final || m_hold_unterminated_tail)) {
+            // 不完整的行, 等待更多資料
+            m_consumed_bytes = base_offset + (line_start - begin);
+            return line_start;
+        }
         ptr = line_end;  // Go to EOL, next loop will skip it
+        m_consumed_bytes = base_offset + ((line_end < end_ptr ? line_end + 1 : end_ptr) - begin);
 
-        // --- $keyword ---
-        if (*line_start == '$') {
-            const char* p = line_start + 1;
-            const char* keyword_start = p;
-            while (p < line_end && *p != ' ' && *p != '\t')
-                ++p;
-            std::string keyword(keyword_start, p - keyword_start);
-
-            if (keyword == "var") {
-                const char* type = p;
-                while (type < line_end && (*type == ' ' || *type == '\t'))
-                    ++type;
-                const char* type_end = type;
-                while (type_end < line_end && *type_end != ' ' && *type_end != '\t')
-                    ++type_end;
-                const char* width = type_end;
-                while (width < line_end && (*width == ' ' || *width == '\t'))
-                    ++width;
-                const char* width_end = width;
-                while (width_end < line_end && *width_end != ' ' && *width_end != '\t')
-                    ++width_end;
-                const char* id = width_end;
-                while (id < line_end && (*id == ' ' || *id == '\t'))
-                    ++id;
-                const char* id_end = id;
-                while (id_end < line_end && *id_end != ' ' && *id_end != '\t')
-                    ++id_end;
-                const char* name = id_end;
-                while (name < line_end && (*name == ' ' || *name == '\t'))
-                    ++name;
-                const char* name_end = name;
-                while (name_end < line_end && *name_end != ' ' && *name_end != '\t' && *name_end != '$')
-                    ++name_end;
-
-                std::string full_name = current_scope.empty() ? std::string(name, name_end - name) : current_scope + "." + std::string(name, name_end - name);
-                if (var_def_cb)
-                    var_def_cb(std::string(id, id_end - id), std::string(type, type_end - type), std::atoi(std::string(width, width_end - width).c_str()), full_name);
-
-            } else if (keyword == "scope") {
-                const char* name = p;
-                while (name < line_end && (*name == ' ' || *name == '\t'))
-                    ++name;
-                const char* type = name;
-                while (type < line_end && *type != ' ' && *type != '\t')
-                    ++type;
-                const char* mod_name = type;
-                while (mod_name < line_end && (*mod_name == ' ' || *mod_name == '\t'))
-                    ++mod_name;
-                const char* name_end = mod_name;
-                while (name_end < line_end && *name_end != ' ' && *name_end != '\t' && *name_end != '$')
-                    ++name_end;
-                if (!current_scope.empty())
-                    current_scope += ".";
-                current_scope.append(mod_name, name_end - mod_name);
-
-            } else if (keyword == "upscope") {
-                std::size_t pos = current_scope.find_last_of('.');
-                if (pos == std::string::npos)
-                    current_scope.clear();
-                else
-                    current_scope.erase(pos);
-
-            } else if (keyword == "enddefinitions") {
-                if (end_def_cb)
-                    end_def_cb();
-            }
-            continue;
-        }
+        process_line(line_start, line_end);
+        if (m_stop_requested)
+            return end_ptr;
 
-        // --- #timestamp ---
-        if (*line_start == '#') {
-            if (time_cb)
-                time_cb(std::strtoull(line_start + 1, nullptr, 10));
-            continue;
+        if (m_skip_until_offset > m_consumed_bytes) {
+            ptr = begin + std::min<uint64_t>(m_skip_until_offset - base_offset, end_ptr - begin);
+            m_consumed_bytes = base_offset + (ptr - begin);
         }
+    }
+    return end_ptr;
+}
 
-        // --- value-change line ---
-        const char* val_begin = line_start;
-        const char* val_end = line_end;
-        while (val_end > val_begin && (*(val_end - 1) == ' ' || *(val_end - 1) == '\t'))
-            --val_end;
-        if (val_end > val_begin && *(val_end - 1) == ' ')
-            --val_end;
-        if (val_end <= val_begin)
-            continue;
+void VcdParser::process_line(const char* line_start, const char* line_end) {
+    // --- $keyword ---
+    if (*line_start == '$') {
+        const char* p = line_start + 1;
+        const char* keyword_start = p;
+        while (p < line_end && !is_blank(*p))
+            ++p;
+        const char* keyword_end = p;
+
+        if (keyword_equals(keyword_start, keyword_end, "var", 3)) {
+            // $var <type> <width> <id> <name> [range] $end; 欄位只記錄位置, 不建立字串
+            const char* fields[4][2];
+            for (int f = 0; f < 4; ++f) {
+                while (p < line_end && is_blank(*p))
+                    ++p;
+                fields[f][0] = p;
+                while (p < line_end && !is_blank(*p) && (f < 3 || *p != '$'))
+                    ++p;
+                fields[f][1] = p;
+            }
+            if (m_var_def_cb) {
+                VcdVarDefinition definition;
+                definition.type = fields[0][0];
+                definition.type_len = fields[0][1] - fields[0][0];
+                definition.width = parse_int_token(fields[1][0], fields[1][1]);
+                definition.id = fields[2][0];
+                definition.id_len = fields[2][1] - fields[2][0];
+                definition.name = fields[3][0];
+                definition.name_len = fields[3][1] - fields[3][0];
+                definition.scope = m_current_scope;
+                definition.scopes = &m_scopes;
+                m_var_def_cb(definition);
+            }
+
+        } else if (keyword_equals(keyword_start, keyword_end, "scope", 5)) {
+            const char* name = p;
+            while (name < line_end && is_blank(*name))
+                ++name;
+            const char* type = name;
+            while (type < line_end && !is_blank(*type))
+                ++type;
+            const char* mod_name = type;
+            while (mod_name < line_end && is_blank(*mod_name))
+                ++mod_name;
+            const char* name_end = mod_name;
+            while (name_end < line_end && !is_blank(*name_end) && *name_end != '$')
+                ++name_end;
+            m_current_scope = m_scopes.enter(m_current_scope, mod_name, name_end - mod_name);
 
-        char id_char = *(val_end - 1);
-        const char* value_ptr = val_begin;
-        std::size_t value_len = val_end - val_begin;
+        } else if (keyword_equals(keyword_start, keyword_end, "upscope", 7)) {
+            m_current_scope = m_scopes.parent_of(m_current_scope);
+
+        } else if (keyword_equals(keyword_start, keyword_end, "enddefinitions", 14)) {
+            if (m_end_def_cb)
+                m_end_def_cb();
+            // Resume: 標頭之後到 offset 之間的內容已經被 checkpoint 涵蓋
+            if (m_resume_offset > m_consumed_bytes)
+                m_skip_until_offset = m_resume_offset;
+        }
+        return;
+    }
 
-        // Handle single-bit format like "0#" or "1%" where value and ID are adjacent
-        if (value_len == 0 && (id_char >= '!' && id_char <= '~')) {
-            value_len = 1;
+    // --- #timestamp ---
+    if (*line_start == '#') {
+        if (m_time_cb) {
+            const char* digits = line_start + 1;
+            while (digits < line_end && is_blank(*digits))
+                ++digits;
+            m_time_cb(parse_decimal_u64(digits, line_end));
         }
+        return;
+    }
+
+    // --- value-change line ---
+    // scalar: "<0|1|x|z><id>", vector/real: "<b|r><value> <id>"
+    const char* val_end = line_end;
+    while (val_end > line_start && (*(val_end - 1) == ' ' || *(val_end - 1) == '\t'))
+        --val_end;
+    if (val_end <= line_start)
+        return;
 
-        if (val_change_cb)
-            val_change_cb(id_char, value_ptr, value_len);
+    const char* value_ptr = line_start;
+    const char* value_end;
+    const char* id_begin;
+    char first = *line_start;
+    if (first == 'b' || first == 'B' || first == 'r' || first == 'R') {
+        value_end = line_start + 1;
+        while (value_end < val_end && *value_end != ' ' && *value_end != '\t')
+            ++value_end;
+        id_begin = value_end;
+        while (id_begin < val_end && (*id_begin == ' ' || *id_begin == '\t'))
+            ++id_begin;
+    } else {
+        value_end = line_start + 1;
+        id_begin = value_end;
     }
+    if (id_begin >= val_end)
+        return;
 
-    munmap(file, size);
-    return true;
+    if (m_val_change_cb)
+        m_val_change_cb(id_begin, val_end - id_begin, value_ptr, value_end - value_ptr);
 }
 
-}  // namespace APBSystem
\ No newline at end of file
+}  // namespace APBSystem
@@ -1,21 +1,77 @@
 // vcd_parser.hpp
 #pragma once
+#include <cstdint>
 #include <functional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace APBSystem {
 
+// $scope 階層: 每個 scope 只存 parent 與 intern 過的名稱, 完整路徑需要時才組出來
+class VcdScopeTable {
+   public:
+    static const uint32_t ROOT = 0xFFFFFFFFu;  // 最外層 (不在任何 scope 內)
+
+    uint32_t enter(uint32_t parent, const char* name, std::size_t len);
+    uint32_t parent_of(uint32_t scope) const { return scope == ROOT ? ROOT : m_nodes[scope].parent; }
+    const std::string& name_of(uint32_t scope) const { return *m_names[m_nodes[scope].name_index]; }
+    // 以 '.' 串接 scope 路徑並附加到 out
+    void append_path(uint32_t scope, std::string& out) const;
+    void clear();
+    std::size_t scope_count() const { return m_nodes.size(); }
+    std::size_t interned_name_count() const { return m_names.size(); }
+
+   private:
+    struct Node {
+        uint32_t parent;
+        uint32_t name_index;
+    };
+    std::vector<Node> m_nodes;
+    // unordered_map 的 key 在 rehash 後位址不變, m_names 直接指向它
+    std::unordered_map<std::string, uint32_t> m_name_index;
+    std::vector<const std::string*> m_names;
+};
+
+// 一行 $var 的內容; 字元指標指向原始資料, 只在 callback 期間有效
+struct VcdVarDefinition {
+    const char* id;
+    std::size_t id_len;
+    const char* type;
+    std::size_t type_len;
+    int width;
+    const char* name;  // 最後一層的名稱 (不含 scope 與位元範圍)
+    std::size_t name_len;
+    uint32_t scope;
+    const VcdScopeTable* scopes;
+
+    std::string id_string() const { return std::string(id, id_len); }
+    std::string type_string() const { return std::string(type, type_len); }
+    // "scope.sub.name"; 只有需要保留名稱的訊號才呼叫
+    std::string hierarchical_name() const;
+};
+
 class VcdParser {
    public:
-    using VarDefinitionCallback = std::function<void(const std::string& id, const std::string& type_str, int width, const std::string& name)>;
-    using TimestampCallback = std::function<void(int time)>;
+    using VarDefinitionCallback = std::function<void(const VcdVarDefinition& definition)>;
+    // 時間一律以 64 bit 傳遞, 長時間模擬的 ps 值不會截斷
+    using TimestampCallback = std::function<void(uint64_t time)>;
+    // id 與 value 都指向原始資料, 只在 callback 期間有效
     using ValueChangeCallback =
-        std::function<void(char id_char,
+        std::function<void(const char* id_begin,
+                           std::size_t id_len,
                            const char* value_begin,
                            std::size_t value_len)>;
     using EndDefinitionsCallback = std::function<void()>;
     using EndDumpvarsCallback = std::function<void()>;
+    // follow 模式每讀完一批資料 (或遇到 EOF) 時呼叫; 回傳 false 停止
+    using FollowPollCallback = std::function<bool()>;
+
+    struct FollowOptions {
+        int poll_interval_ms = 200;       // 沒有新資料時的最長等待時間
+        uint64_t idle_timeout_ms = 0;     // 檔案持續沒有成長多久後停止, 0 表示不限
+        std::size_t read_chunk_bytes = 1 << 20;
+    };
 
     VcdParser();
     bool parse_file(const std::string& filename,
@@ -23,6 +79,60 @@ class VcdParser {
                     TimestampCallback,
                     ValueChangeCallback,
                     EndDefinitionsCallback);
+
+    // --- 串流模式: 資料可以任意切塊餵入, 不完整的行會保留到下一次 feed ---
+    void begin_stream(VarDefinitionCallback,
+                      TimestampCallback,
+                      ValueChangeCallback,
+                      EndDefinitionsCallback);
+    void feed(const char* data, std::size_t len);
+    void finish();
+
+    // 持續讀取正在被寫入的 VCD (inotify 喚醒, 否則固定間隔 polling)
+    bool follow_file(const std::string& filename,
+                     const FollowOptions& options,
+                     VarDefinitionCallback,
+                     TimestampCallback,
+                     ValueChangeCallback,
+                     EndDefinitionsCallback,
+                     FollowPollCallback on_poll);
+
+    // 從 checkpoint 續跑: 仍會解析標頭 ($var / $enddefinitions), 之後直接跳到 offset 繼續
+    void set_resume_offset(std::size_t offset) { m_resume_offset = offset; }
+    // 處理完目前這一行就停止 (時間切片的 worker 到達切片結尾時呼叫)
+    void request_stop() { m_stop_requested = true; }
+    // 保存 checkpoint 的分析: 檔尾沒有換行的那一行可能還沒寫完, 不處理也不算入 consumed bytes,
+    // 留給 resume 時 (檔案已經長大) 再處理
+    void set_hold_unterminated_tail(bool hold) { m_hold_unterminated_tail = hold; }
+    // 目前已完整處理的位元組數 (可作為下一次的 resume offset)
+    std::size_t get_consumed_bytes() const { return m_consumed_bytes; }
+
+    // "#<digits>" 的數字部分; 一次處理 8 個位數, 遇到第一個非數字字元就停止 (不會讀超過 end)
+    static uint64_t parse_decimal_u64(const char* begin, const char* end);
+
+   private:
+    void set_callbacks(VarDefinitionCallback,
+                       TimestampCallback,
+                       ValueChangeCallback,
+                       EndDefinitionsCallback);
+    void reset_stream_state();
+    // 處理 [begin, end) 中完整的行, 回傳尚未處理的位置 (is_final 時處理到 end, 除非設定了 hold_unterminated_tail)
+    const char* parse_buffer(const char* begin, const char* end, bool is_final);
+    void process_line(const char* line_start, const char* line_end);
+
+    VarDefinitionCallback m_var_def_cb;
+    TimestampCallback m_time_cb;
+    ValueChangeCallback m_val_change_cb;
+    EndDefinitionsCallback m_end_def_cb;
+
+    VcdScopeTable m_scopes;
+    uint32_t m_current_scope = VcdScopeTable::ROOT;
+    std::string m_partial_line;
+    std::size_t m_resume_offset = 0;
+    std::size_t m_skip_until_offset = 0;
+    std::size_t m_consumed_bytes = 0;
+    bool m_stop_requested = false;
+    bool m_hold_unterminated_tail = false;
 };
 
 }  // namespace APBSystem
\ No newline at end of file
@@ -0,0 +1,478 @@
+// apb_bench.cpp
+// 分別量測 pipeline 每個階段的效能, 輸出 JSON 並與 baseline 比較
+#include <dirent.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "analysis_session.hpp"
+#include "apb_analyzer.hpp"
+#include "report_generator.hpp"
+#include "signal_manager.hpp"
+#include "statistics.hpp"
+#include "vcd_parser.hpp"
+
+using namespace APBSystem;
+
+// 計算每個階段呼叫 operator new 的次數; 陣列版本也一併取代, new/delete 才會成對使用 malloc/free.
+// noinline: 內嵌後 GCC 會看到 free() 配上 operator new 的指標而誤報 -Wmismatched-new-delete
+#define APB_BENCH_ALLOC_FN __attribute__((noinline))
+static std::atomic<uint64_t> g_allocation_count(0);
+
+APB_BENCH_ALLOC_FN void* operator new(std::size_t size) {
+    g_allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+APB_BENCH_ALLOC_FN void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+APB_BENCH_ALLOC_FN void operator delete(void* p) noexcept {
+    std::free(p);
+}
+APB_BENCH_ALLOC_FN void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+APB_BENCH_ALLOC_FN void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+APB_BENCH_ALLOC_FN void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+const uint64_t TRANSACTION_LIMIT = 1000000;  // 與 AnalysisSession 一致
+#ifdef __OPTIMIZE__
+const bool OPTIMIZED_BUILD = true;
+#else
+const bool OPTIMIZED_BUILD = false;  // 未最佳化的 build 比 Release 慢數倍, 結果不能和 baseline 比較
+#endif
+
+struct StageResult {
+    std::string input;
+    std::string stage;
+    std::vector<double> samples_ms;
+    double work_units = 0;  // 每次執行處理的量, 用來換算 throughput
+    std::string unit;
+    uint64_t allocations = 0;  // 最後一次執行中 operator new 的次數
+};
+
+struct VarDefinition {
+    std::string id, type_str, name;
+    int width;
+};
+
+// 一次不計時的完整解析, 把各階段需要的輸入先準備好
+struct CapturedInput {
+    std::string path;
+    std::string data;
+    std::vector<VarDefinition> definitions;
+    std::string pool;  // id 與 value 字串
+    struct Event {
+        uint64_t timestamp;
+        uint32_t id_offset, id_len, value_offset, value_len;
+    };
+    std::vector<Event> events;
+    std::vector<SignalState> edge_snapshots;
+    std::vector<TransactionInfo> completed;
+    int paddr_width = 32, pwdata_width = 32;
+};
+
+double percentile(std::vector<double> sorted, double p) {
+    std::sort(sorted.begin(), sorted.end());
+    std::size_t rank = static_cast<std::size_t>(std::ceil(p / 100.0 * sorted.size()));
+    return sorted[rank == 0 ? 0 : rank - 1];
+}
+
+std::string base_name(const std::string& path) {
+    std::size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+std::string json_escape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\')
+            out.push_back('\\');
+        out.push_back(c);
+    }
+    return out;
+}
+
+bool read_whole_file(const std::string& path, std::string& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return false;
+    std::ostringstream oss;
+    oss << in.rdbuf();
+    out = oss.str();
+    return true;
+}
+
+void collect_inputs(const std::string& path, std::vector<std::string>& out) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        std::cerr << "Warning: skipping missing input " << path << std::endl;
+        return;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        out.push_back(path);
+        return;
+    }
+    std::vector<std::string> found;
+    if (DIR* dir = opendir(path.c_str())) {
+        while (dirent* entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name.size() > 4 && name.compare(name.size() - 4, 4, ".vcd") == 0)
+                found.push_back(path + "/" + name);
+        }
+        closedir(dir);
+    }
+    std::sort(found.begin(), found.end());
+    out.insert(out.end(), found.begin(), found.end());
+}
+
+bool capture_input(const std::string& path, uint64_t max_edges, CapturedInput& in) {
+    in.path = path;
+    if (!read_whole_file(path, in.data)) {
+        std::cerr << "Error: Could not read " << path << std::endl;
+        return false;
+    }
+    SignalManager signal_manager;
+    Statistics statistics;
+    ApbAnalyzer analyzer(statistics);
+    SignalState state;
+    bool previous_pclk = false;
+    uint64_t timestamp = 0, edges = 0;
+
+    VcdParser parser;
+    parser.begin_stream(
+        [&](const VcdVarDefinition& d) {
+            in.definitions.push_back({d.id_string(), d.type_string(), d.hierarchical_name(), d.width});
+            signal_manager.register_var(d);
+        },
+        [&](uint64_t t) { timestamp = t; state.timestamp = t; },
+        [&](const char* id, std::size_t id_len, const char* value, std::size_t value_len) {
+            CapturedInput::Event e{timestamp, static_cast<uint32_t>(in.pool.size()), static_cast<uint32_t>(id_len), 0, static_cast<uint32_t>(value_len)};
+            in.pool.append(id, id_len);
+            e.value_offset = static_cast<uint32_t>(in.pool.size());
+            in.pool.append(value, value_len);
+            in.events.push_back(e);
+            if (analyzer.get_completed_transaction_count() >= TRANSACTION_LIMIT || edges >= max_edges)
+                return;
+            if (signal_manager.update_state_on_signal_change(id, id_len, value, value_len, state, previous_pclk)) {
+                in.edge_snapshots.push_back(state);
+                analyzer.analyze_on_pclk_rising_edge(state, ++edges);
+            }
+        },
+        [&]() {
+            in.paddr_width = signal_manager.get_paddr_width();
+            in.pwdata_width = signal_manager.get_pwdata_width();
+            statistics.set_bus_widths(in.paddr_width, in.pwdata_width);
+        });
+    parser.feed(in.data.data(), in.data.size());
+    parser.finish();
+    if (in.pool.size() > UINT32_MAX) {
+        std::cerr << "Error: " << path << " is too large for the benchmark capture buffer" << std::endl;
+        return false;
+    }
+    in.completed.assign(analyzer.get_completed_transactions().begin(), analyzer.get_completed_transactions().end());
+    return true;
+}
+
+// setup 不計時, body 計時; 先跑一次暖身
+StageResult run_stage(const std::string& input, const std::string& stage, int iterations,
+                      double work_units, const std::string& unit,
+                      std::function<void()> setup, std::function<void()> body) {
+    StageResult r;
+    r.input = input;
+    r.stage = stage;
+    r.work_units = work_units;
+    r.unit = unit;
+    for (int i = -1; i < iterations; ++i) {
+        if (setup)
+            setup();
+        uint64_t allocations_before = g_allocation_count.load(std::memory_order_relaxed);
+        auto start = std::chrono::steady_clock::now();
+        body();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        r.allocations = g_allocation_count.load(std::memory_order_relaxed) - allocations_before;
+        if (i >= 0)
+            r.samples_ms.push_back(elapsed.count());
+    }
+    return r;
+}
+
+volatile uint64_t g_sink;
+
+void bench_input(const CapturedInput& in, int iterations, std::vector<StageResult>& results) {
+    const std::string name = base_name(in.path);
+
+    // 1. VcdParser tokenization (callbacks 只做計數)
+    results.push_back(run_stage(name, "vcd_parser", iterations, in.data.size() / 1e6, "MB/s", nullptr, [&]() {
+        uint64_t count = 0;
+        VcdParser parser;
+        parser.begin_stream(
+            [&](const VcdVarDefinition&) { ++count; },
+            [&](uint64_t) { ++count; },
+            [&](const char*, std::size_t, const char*, std::size_t) { ++count; },
+            [&]() {});
+        parser.feed(in.data.data(), in.data.size());
+        parser.finish();
+        g_sink = count;
+    }));
+
+    // 2. parse_vcd_value_to_uint
+    results.push_back(run_stage(name, "parse_vcd_value_to_uint", iterations, static_cast<double>(in.events.size()), "values/s", nullptr, [&]() {
+        uint64_t acc = 0;
+        bool has_x = false;
+        for (const auto& e : in.events)
+            acc += SignalManager::parse_vcd_value_to_uint(in.pool.data() + e.value_offset, e.value_len, has_x) + has_x;
+        g_sink = acc;
+    }));
+
+    // 3. update_state_on_signal_change
+    SignalManager signal_manager;
+    for (const auto& d : in.definitions)
+        signal_manager.register_signal(d.id, d.type_str, d.width, d.name);
+    results.push_back(run_stage(name, "update_state_on_signal_change", iterations, static_cast<double>(in.events.size()), "changes/s", nullptr, [&]() {
+        SignalState state;
+        bool previous_pclk = false;
+        uint64_t edges = 0;
+        for (const auto& e : in.events) {
+            state.timestamp = e.timestamp;
+            edges += signal_manager.update_state_on_signal_change(in.pool.data() + e.id_offset, e.id_len,
+                                                                  in.pool.data() + e.value_offset, e.value_len,
+                                                                  state, previous_pclk);
+        }
+        g_sink = edges;
+    }));
+
+    // 4. ApbAnalyzer FSM
+    results.push_back(run_stage(name, "apb_analyzer_fsm", iterations, static_cast<double>(in.edge_snapshots.size()), "edges/s", nullptr, [&]() {
+        MonotonicArena arena;
+        Statistics statistics(&arena);
+        statistics.set_bus_widths(in.paddr_width, in.pwdata_width);
+        ApbAnalyzer analyzer(statistics);
+        for (std::size_t i = 0; i < in.edge_snapshots.size(); ++i)
+            analyzer.analyze_on_pclk_rising_edge(in.edge_snapshots[i], i + 1);
+        g_sink = analyzer.get_completed_transaction_count();
+    }));
+
+    // 5. record_*_for_corruption_analysis
+    Statistics corruption_stats;
+    auto reset_corruption_stats = [&]() {
+        corruption_stats = Statistics();
+        corruption_stats.set_bus_widths(in.paddr_width, in.pwdata_width);
+        for (const auto& t : in.completed)
+            corruption_stats.record_accessed_completer(t.target_completer);
+    };
+    results.push_back(run_stage(name, "record_for_corruption_analysis", iterations, static_cast<double>(in.completed.size()), "records/s", reset_corruption_stats, [&]() {
+        for (const auto& t : in.completed) {
+            corruption_stats.record_paddr_for_corruption_analysis(t.target_completer, t.paddr);
+            if (t.is_write())
+                corruption_stats.record_pwdata_for_corruption_analysis(t.target_completer, t.pwdata_val);
+        }
+    }));
+
+    // 6. finalize_bit_activity (每次都從同一份尚未 finalize 的資料開始)
+    const Statistics populated = corruption_stats;
+    Statistics finalize_stats;
+    results.push_back(run_stage(name, "finalize_bit_activity", iterations, 1, "runs/s", [&]() { finalize_stats = populated; }, [&]() { finalize_stats.finalize_bit_activity(); }));
+
+    // 7. ReportGenerator (完整分析後的 Statistics)
+    Statistics report_stats;
+    report_stats.set_bus_widths(in.paddr_width, in.pwdata_width);
+    ApbAnalyzer report_analyzer(report_stats);
+    for (std::size_t i = 0; i < in.edge_snapshots.size(); ++i)
+        report_analyzer.analyze_on_pclk_rising_edge(in.edge_snapshots[i], i + 1);
+    report_stats.set_total_pclk_rising_edges(in.edge_snapshots.size());
+    report_analyzer.finalize_analysis(in.edge_snapshots.empty() ? 0 : in.edge_snapshots.back().timestamp);
+    ReportGenerator report_generator;
+    results.push_back(run_stage(name, "report_generator", iterations, 1, "runs/s", nullptr, [&]() {
+        std::ostringstream oss;
+        report_generator.generate_apb_transaction_report(report_stats, oss);
+        g_sink = oss.str().size();
+    }));
+
+    // 8. 整條 pipeline (AnalysisSession, 含 finalize 與釋放)
+    results.push_back(run_stage(name, "analysis_session", iterations, in.data.size() / 1e6, "MB/s", nullptr, [&]() {
+        AnalysisSession session;
+        session.feed(in.data.data(), in.data.size());
+        session.finish();
+        g_sink = session.analyzer().get_completed_transaction_count();
+    }));
+
+    // 9. 同上, 但同一個 #time 的 value change 合併後才評估 PCLK 上升緣
+    results.push_back(run_stage(name, "analysis_session_coalesced", iterations, in.data.size() / 1e6, "MB/s", nullptr, [&]() {
+        AnalysisSession session;
+        session.set_timestamp_coalescing(TimestampCoalescing::SAMPLE_BEFORE_EDGE);
+        session.feed(in.data.data(), in.data.size());
+        session.finish();
+        g_sink = session.analyzer().get_completed_transaction_count();
+    }));
+}
+
+bool write_json(const std::string& path, const std::vector<StageResult>& results, int iterations) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "Error: Could not open output file " << path << std::endl;
+        return false;
+    }
+    // 每筆結果一行, baseline 讀取時只需逐行比對
+    out << "{\n  \"iterations\": " << iterations << ",\n  \"optimized\": " << (OPTIMIZED_BUILD ? "true" : "false")
+        << ",\n  \"results\": [\n";
+    out << std::setprecision(6);
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const StageResult& r = results[i];
+        double median = percentile(r.samples_ms, 50);
+        out << "    {\"input\": \"" << json_escape(r.input) << "\", \"stage\": \"" << r.stage
+            << "\", \"median_ms\": " << median
+            << ", \"p90_ms\": " << percentile(r.samples_ms, 90)
+            << ", \"min_ms\": " << percentile(r.samples_ms, 0)
+            << ", \"throughput\": " << (median > 0 ? r.work_units / (median / 1000.0) : 0.0)
+            << ", \"throughput_unit\": \"" << r.unit << "\", \"allocations\": " << r.allocations << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+    return true;
+}
+
+std::string extract_json_field(const std::string& line, const std::string& key) {
+    std::string pattern = "\"" + key + "\": ";
+    std::size_t pos = line.find(pattern);
+    if (pos == std::string::npos)
+        return std::string();
+    pos += pattern.size();
+    if (pos < line.size() && line[pos] == '"') {
+        std::size_t end = line.find('"', pos + 1);
+        return end == std::string::npos ? std::string() : line.substr(pos + 1, end - pos - 1);
+    }
+    std::size_t end = line.find_first_of(",}", pos);
+    return line.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+}
+
+bool load_baseline(const std::string& path, std::map<std::string, double>& baseline) {
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        std::cerr << "Error: Could not open baseline file " << path << std::endl;
+        return false;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        if (extract_json_field(line, "optimized") == "false") {
+            std::cerr << "Error: baseline " << path << " was recorded from a build without optimization" << std::endl;
+            return false;
+        }
+        std::string input = extract_json_field(line, "input");
+        std::string stage = extract_json_field(line, "stage");
+        std::string median = extract_json_field(line, "median_ms");
+        if (!input.empty() && !stage.empty() && !median.empty())
+            baseline[input + "|" + stage] = std::atof(median.c_str());
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> input_args;
+    std::string json_path, baseline_path;
+    int iterations = 21;  // 樣本太少時 p90 只是最大值
+    double threshold = 0.15;
+    double noise_floor_ms = 0.2;
+    uint64_t max_edges = 4000000;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--json" && has_value) {
+            json_path = argv[++i];
+        } else if (arg == "--baseline" && has_value) {
+            baseline_path = argv[++i];
+        } else if (arg == "--iterations" && has_value) {
+            iterations = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--threshold" && has_value) {
+            threshold = std::atof(argv[++i]);
+        } else if (arg == "--noise-floor-ms" && has_value) {
+            noise_floor_ms = std::atof(argv[++i]);
+        } else if (arg == "--max-edges" && has_value) {
+            max_edges = std::strtoull(argv[++i], nullptr, 10);
+        } else if (!arg.empty() && arg[0] == '-') {
+            std::cerr << "Error: Unknown option: " << arg << std::endl;
+            return 1;
+        } else {
+            collect_inputs(arg, input_args);
+        }
+    }
+    if (input_args.empty()) {
+        std::cerr << "Usage: " << argv[0] << " <vcd_file_or_dir>... [--iterations <n>] [--json <results.json>]\n"
+                  << "       [--baseline <baseline.json>] [--threshold <fraction>] [--noise-floor-ms <ms>] [--max-edges <n>]\n"
+                  << "Exit status: 0 no regression, 1 usage or I/O error, 2 regression against the baseline" << std::endl;
+        return 1;
+    }
+
+    if (!OPTIMIZED_BUILD) {
+        if (!baseline_path.empty()) {
+            std::cerr << "Error: apb_bench was built without optimization; rebuild with -DCMAKE_BUILD_TYPE=Release to compare against "
+                      << baseline_path << std::endl;
+            return 1;
+        }
+        std::cerr << "Warning: apb_bench was built without optimization (use -DCMAKE_BUILD_TYPE=Release); timings are not representative" << std::endl;
+    }
+
+    std::vector<StageResult> results;
+    for (const auto& path : input_args) {
+        CapturedInput captured;
+        if (!capture_input(path, max_edges, captured))
+            return 1;
+        bench_input(captured, iterations, results);
+    }
+
+    std::map<std::string, double> baseline;
+    if (!baseline_path.empty() && !load_baseline(baseline_path, baseline))
+        return 1;
+
+    int regressions = 0;
+    std::cout << std::left << std::setw(28) << "input" << std::setw(32) << "stage" << std::right
+              << std::setw(12) << "median ms" << std::setw(12) << "p90 ms" << std::setw(16) << "throughput" << std::setw(18) << "allocations"
+              << (baseline.empty() ? "" : "    vs baseline") << "\n";
+    for (const auto& r : results) {
+        double median = percentile(r.samples_ms, 50);
+        std::cout << std::left << std::setw(28) << r.input << std::setw(32) << r.stage << std::right << std::fixed
+                  << std::setprecision(3) << std::setw(12) << median << std::setw(12) << percentile(r.samples_ms, 90)
+                  << std::setprecision(1) << std::setw(16) << (median > 0 ? r.work_units / (median / 1000.0) : 0.0) << " " << std::left
+                  << std::setw(10) << r.unit << std::right << std::setw(12) << r.allocations;
+        auto it = baseline.find(r.input + "|" + r.stage);
+        if (it != baseline.end() && it->second > 0) {
+            double change = (median - it->second) / it->second;
+            // 太短的階段受雜訊影響大, 差距低於 noise floor 不算退步
+            bool regressed = change > threshold && median - it->second > noise_floor_ms;
+            regressions += regressed;
+            std::cout << "    " << std::showpos << std::setprecision(1) << change * 100.0 << "%" << std::noshowpos
+                      << (regressed ? "  REGRESSION" : "");
+        }
+        std::cout << "\n";
+    }
+
+    if (!json_path.empty() && !write_json(json_path, results, iterations))
+        return 1;
+    // 結束碼 2 專用於退步, 與參數或 I/O 錯誤 (1) 區分
+    if (regressions > 0) {
+        std::cerr << regressions << " stage(s) regressed by more than " << threshold * 100.0 << "% against " << baseline_path << std::endl;
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,181 @@
+// apb_vcd_gen.cpp
+// 產生合成 APB VCD 與對應的預期報表, 作為大型輸入的 benchmark 與回歸測試資料
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "apb_vcd_generator.hpp"
+
+using namespace APBSystem;
+
+namespace {
+
+void print_usage(const char* prog) {
+    std::cerr << "Usage: " << prog << " -o <output_vcd_file> [options]\n"
+              << "  --expected <file>        write the report APB_Recognizer should produce\n"
+              << "  --seed <n>               random seed (default 1)\n"
+              << "  --transactions <n>       number of transactions (default 10000)\n"
+              << "  --size <bytes>[K|M|G]    stop generating once the VCD reaches this size\n"
+              << "  --utilization <0..1>     fraction of pclk edges with PSEL high (default 0.3)\n"
+              << "  --write-ratio <0..1>     fraction of writes (default 0.4)\n"
+              << "  --wait-ratio <0..1>      fraction of transactions with wait states (default 0.2)\n"
+              << "  --max-wait <n>           max wait states per transaction (default 4)\n"
+              << "  --signals <n>            total signal count, extra ones are filler (default 9)\n"
+              << "  --filler-activity <0..1> toggle probability per filler per cycle (default 0.05)\n"
+              << "  --completers <list>      subset of uart,gpio,spi (default all)\n"
+              << "  --timeouts <n> --out-of-range <n> --mirroring <n>   spread evenly over --transactions\n"
+              << "  --short <uart|gpio|spi>:<a|d><bit>   tie bit+1 to bit, e.g. gpio:d7 or uart:a3\n"
+              << "  --reset-cycles <n>       pclk cycles held in reset (default 20)" << std::endl;
+}
+
+uint64_t parse_size(const std::string& s) {
+    char* end = nullptr;
+    uint64_t v = std::strtoull(s.c_str(), &end, 10);
+    switch (end ? *end : '\0') {
+        case 'G':
+        case 'g':
+            return v << 30;
+        case 'M':
+        case 'm':
+            return v << 20;
+        case 'K':
+        case 'k':
+            return v << 10;
+        default:
+            return v;
+    }
+}
+
+bool parse_completer(const std::string& s, CompleterID& id) {
+    if (s == "uart")
+        id = CompleterID::UART;
+    else if (s == "gpio")
+        id = CompleterID::GPIO;
+    else if (s == "spi")
+        id = CompleterID::SPI_MASTER;
+    else
+        return false;
+    return true;
+}
+
+bool parse_short(const std::string& s, ShortInjection& out) {
+    std::size_t colon = s.find(':');
+    if (colon == std::string::npos || colon + 1 >= s.size() || !parse_completer(s.substr(0, colon), out.completer))
+        return false;
+    char kind = s[colon + 1];
+    if (kind != 'a' && kind != 'd')
+        return false;
+    out.on_paddr = (kind == 'a');
+    // bit 編號只能是十進位數字, 空的或後面多出字元 (uart:d, uart:dx, gpio:d7x) 都不接受
+    const char* digits = s.c_str() + colon + 2;
+    if (*digits < '0' || *digits > '9')
+        return false;
+    char* end = nullptr;
+    errno = 0;
+    long bit = std::strtol(digits, &end, 10);
+    if (errno != 0 || *end != '\0')
+        return false;
+    out.bit = static_cast<int>(std::min<long>(bit, 64));
+    // 分析器只檢查 a0-a11 與 d0-d31 的相鄰位元
+    return out.bit >= 0 && out.bit < (out.on_paddr ? 11 : 31);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    VcdGeneratorConfig config;
+    std::string output_path, expected_path;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "-o" && has_value) {
+            output_path = argv[++i];
+        } else if (arg == "--expected" && has_value) {
+            expected_path = argv[++i];
+        } else if (arg == "--seed" && has_value) {
+            config.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--transactions" && has_value) {
+            config.transactions = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--size" && has_value) {
+            config.target_bytes = parse_size(argv[++i]);
+            if (config.transactions == VcdGeneratorConfig().transactions)
+                config.transactions = UINT64_MAX;
+        } else if (arg == "--utilization" && has_value) {
+            config.utilization = std::atof(argv[++i]);
+        } else if (arg == "--write-ratio" && has_value) {
+            config.write_ratio = std::atof(argv[++i]);
+        } else if (arg == "--wait-ratio" && has_value) {
+            config.wait_ratio = std::atof(argv[++i]);
+        } else if (arg == "--max-wait" && has_value) {
+            config.max_wait_cycles = std::atoi(argv[++i]);
+        } else if (arg == "--signals" && has_value) {
+            config.signal_count = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--filler-activity" && has_value) {
+            config.filler_activity = std::atof(argv[++i]);
+        } else if (arg == "--completers" && has_value) {
+            std::string list = std::string(argv[++i]) + ",";
+            config.use_uart = config.use_gpio = config.use_spi = false;
+            for (std::size_t pos = 0, next; (next = list.find(',', pos)) != std::string::npos; pos = next + 1) {
+                CompleterID id;
+                if (!parse_completer(list.substr(pos, next - pos), id)) {
+                    std::cerr << "Error: Unknown completer in --completers: " << list << std::endl;
+                    return 1;
+                }
+                (id == CompleterID::UART ? config.use_uart : id == CompleterID::GPIO ? config.use_gpio : config.use_spi) = true;
+            }
+        } else if (arg == "--timeouts" && has_value) {
+            config.timeouts = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--out-of-range" && has_value) {
+            config.out_of_range = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--mirroring" && has_value) {
+            config.mirroring = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--short" && has_value) {
+            ShortInjection s;
+            if (!parse_short(argv[++i], s)) {
+                std::cerr << "Error: Invalid --short value: " << argv[i] << std::endl;
+                return 1;
+            }
+            config.shorts.push_back(s);
+        } else if (arg == "--reset-cycles" && has_value) {
+            config.reset_cycles = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            std::cerr << "Error: Unknown option: " << arg << std::endl;
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (output_path.empty()) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    std::FILE* vcd_out = output_path == "-" ? stdout : std::fopen(output_path.c_str(), "wb");
+    if (!vcd_out) {
+        std::cerr << "Error: Could not open output file " << output_path << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    std::ofstream expected_out;
+    if (!expected_path.empty()) {
+        expected_out.open(expected_path);
+        if (!expected_out.is_open()) {
+            std::cerr << "Error: Could not open expected report file " << expected_path << std::endl;
+            return 1;
+        }
+    }
+
+    VcdGeneratorResult result;
+    bool ok = generate_apb_vcd(config, vcd_out, expected_path.empty() ? nullptr : &expected_out, result);
+    if (vcd_out != stdout)
+        ok = (std::fclose(vcd_out) == 0) && ok;
+    if (!ok) {
+        std::cerr << "Error: Failed to write " << output_path << std::endl;
+        return 1;
+    }
+    std::cerr << "Generated " << result.transactions << " transactions, " << result.pclk_edges << " pclk edges, "
+              << result.bytes_written << " bytes" << std::endl;
+    return 0;
+}
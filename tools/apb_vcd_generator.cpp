@@ -0,0 +1,605 @@
+// apb_vcd_generator.cpp
+#include "apb_vcd_generator.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <map>
+#include <set>
+#include <sstream>
+#include <unordered_map>
+
+namespace APBSystem {
+
+namespace {
+
+const uint64_t PCLK_PERIOD_PS = 10000;
+const uint64_t TIMEOUT_ACCESS_CYCLES = 1000;
+const uint32_t APB_SIGNAL_COUNT = 9;
+const uint32_t NORMAL_OFFSET_LIMIT = 0x800;  // 一般交易只用視窗前半, 後半保留給 mirroring 注入
+
+enum ApbSignalIndex { SIG_CLK,
+                      SIG_RST_N,
+                      SIG_PADDR,
+                      SIG_PWDATA,
+                      SIG_PWRITE,
+                      SIG_PSEL,
+                      SIG_PENABLE,
+                      SIG_PREADY,
+                      SIG_PRDATA };
+
+struct BusState {
+    bool presetn = false;
+    uint32_t paddr = 0;
+    uint32_t pwdata = 0;
+    bool pwrite = false;
+    bool psel = false;
+    bool penable = false;
+    bool pready = false;
+    uint32_t prdata = 0;
+};
+
+struct PlannedTransaction {
+    bool is_write = false;
+    CompleterID completer = CompleterID::UART;
+    uint32_t paddr = 0;
+    uint32_t pwdata = 0;
+    uint32_t prdata = 0;
+    int wait_cycles = 0;
+    bool timeout = false;
+};
+
+uint32_t completer_base(CompleterID id) {
+    switch (id) {
+        case CompleterID::UART:
+            return UART_BASE_ADDR;
+        case CompleterID::GPIO:
+            return GPIO_BASE_ADDR;
+        case CompleterID::SPI_MASTER:
+            return SPI_MASTER_BASE_ADDR;
+        default:
+            return 0x1A104000;
+    }
+}
+
+uint32_t apply_short(uint32_t value, int bit) {
+    uint32_t low = (value >> bit) & 1u;
+    return (value & ~(1u << (bit + 1))) | (low << (bit + 1));
+}
+
+// --- 參考模型: 依照 APB_Recognizer 的規則計算報表內容 ---
+struct PairEvidence {
+    uint32_t independent = 0;  // bit i: (i, i+1) 出現過 01 或 10
+    uint32_t both_zero = 0;
+    uint32_t both_one = 0;
+    void record(uint32_t v) {
+        uint32_t next = v >> 1;
+        independent |= v ^ next;
+        both_zero |= ~v & ~next;
+        both_one |= v & next;
+    }
+    // 只有恰好一組候選時才判定為短路, 回傳較低的 bit, 否則 -1
+    int shorted_pair(int pair_count) const {
+        int found = -1, candidates = 0;
+        for (int i = 0; i < pair_count; ++i) {
+            bool candidate = !((independent >> i) & 1u) && ((both_zero >> i) & 1u) && ((both_one >> i) & 1u);
+            if (candidate) {
+                found = i;
+                candidates++;
+            }
+        }
+        return candidates == 1 ? found : -1;
+    }
+};
+
+struct ReferenceModel {
+    uint64_t read_no_wait = 0, read_with_wait = 0, write_no_wait = 0, write_with_wait = 0;
+    uint64_t read_edges = 0, write_edges = 0;
+    uint64_t bus_active_edges = 0;
+    uint64_t first_valid_edge = 0;
+    uint64_t completed = 0;
+    uint64_t frozen_at_edge = 0;  // 達到 transaction_limit 的那個 edge, 0 表示沒有
+    std::vector<CompleterID> accessed;
+    std::map<CompleterID, PairEvidence> paddr_evidence, pwdata_evidence;
+    std::vector<OutOfRangeAccessDetail> out_of_range;
+    std::vector<TransactionTimeoutDetail> timeouts;
+    std::vector<DataMirroringDetail> mirroring;
+    std::unordered_map<uint64_t, std::pair<uint32_t, uint64_t>> shadow;  // (completer, addr) -> (data, time)
+    std::unordered_map<uint32_t, ReverseWriteInfo> reverse;
+
+    static uint64_t shadow_key(CompleterID c, uint32_t addr) {
+        return (static_cast<uint64_t>(c) << 32) | addr;
+    }
+};
+
+class Generator {
+   public:
+    Generator(const VcdGeneratorConfig& config, std::FILE* out)
+        : m_cfg(config), m_out(out), m_rng(config.seed), m_filler_rng(config.seed ^ 0x5DEECE66DULL) {
+        m_filler_count = config.signal_count > APB_SIGNAL_COUNT ? config.signal_count - APB_SIGNAL_COUNT : 0;
+        m_filler_values.assign(m_filler_count, 0);
+        if (config.use_uart)
+            m_completers.push_back(CompleterID::UART);
+        if (config.use_gpio)
+            m_completers.push_back(CompleterID::GPIO);
+        if (config.use_spi)
+            m_completers.push_back(CompleterID::SPI_MASTER);
+        if (m_completers.empty())
+            m_completers.push_back(CompleterID::UART);
+        m_next_filler_event = m_filler_count > 0 ? geometric(config.filler_activity) : UINT64_MAX;
+    }
+
+    bool run(VcdGeneratorResult& result);
+    void write_expected_report(std::ostream& out) const;
+
+   private:
+    uint64_t geometric(double p) {
+        if (p >= 1.0)
+            return 0;
+        if (p <= 0.0)
+            return UINT64_MAX / 2;
+        double u = 1.0 - m_filler_rng.uniform();  // (0, 1]
+        return static_cast<uint64_t>(std::floor(std::log(u) / std::log(1.0 - p)));
+    }
+    bool is_wide_filler(uint32_t i) const { return i % 8 == 7; }
+
+    void put(const char* s) { m_buf.append(s); }
+    void put_u64(uint64_t v) {
+        char tmp[24];
+        int n = 0;
+        do {
+            tmp[n++] = static_cast<char>('0' + v % 10);
+            v /= 10;
+        } while (v);
+        while (n)
+            m_buf.push_back(tmp[--n]);
+    }
+    void put_scalar(bool v, uint32_t index) {
+        m_buf.push_back(v ? '1' : '0');
+        m_buf.append(m_ids[index]);
+        m_buf.push_back('\n');
+    }
+    void put_vector(uint32_t v, uint32_t index) {
+        m_buf.push_back('b');
+        int top = 31;
+        while (top > 0 && !((v >> top) & 1u))
+            --top;
+        for (int b = top; b >= 0; --b)
+            m_buf.push_back(((v >> b) & 1u) ? '1' : '0');
+        m_buf.push_back(' ');
+        m_buf.append(m_ids[index]);
+        m_buf.push_back('\n');
+    }
+    bool flush(bool force) {
+        if (!force && m_buf.size() < (1u << 20))
+            return true;
+        if (!m_buf.empty() && std::fwrite(m_buf.data(), 1, m_buf.size(), m_out) != m_buf.size())
+            return false;
+        m_bytes_written += m_buf.size();
+        m_buf.clear();
+        return true;
+    }
+    uint64_t bytes_so_far() const { return m_bytes_written + m_buf.size(); }
+
+    void write_header();
+    // 輸出下一個 pclk 上升緣; next 會在再下一個上升緣被取樣
+    void advance(const BusState& next);
+    void write_bus_diff(const BusState& next);
+    void write_filler_changes();
+
+    PlannedTransaction plan_transaction(uint64_t remaining);
+    uint32_t pick_offset(CompleterID c, bool on_paddr_short_allowed);
+    void run_transaction(const PlannedTransaction& t);
+    void model_completion(const PlannedTransaction& t, uint64_t completion_edge);
+    uint64_t edge_time(uint64_t edge) const { return PCLK_PERIOD_PS / 2 + PCLK_PERIOD_PS * (edge - 1); }
+    uint64_t idle_gap();
+
+    const VcdGeneratorConfig& m_cfg;
+    std::FILE* m_out;
+    DeterministicRng m_rng;
+    DeterministicRng m_filler_rng;
+    std::string m_buf;
+    uint64_t m_bytes_written = 0;
+    std::vector<std::string> m_ids;
+    uint32_t m_filler_count = 0;
+    std::vector<uint32_t> m_filler_values;
+    uint64_t m_next_filler_event = 0;  // 在 (cycle * filler_count + index) 空間中的下一個變化
+    std::vector<CompleterID> m_completers;
+
+    BusState m_state;
+    uint64_t m_edge = 0;
+    uint64_t m_remaining_timeouts = 0, m_remaining_oor = 0, m_remaining_mirror = 0;
+    std::vector<std::pair<uint32_t, uint32_t>> m_recent_writes;  // (addr, data)
+    ReferenceModel m_model;
+};
+
+void Generator::write_header() {
+    m_ids.resize(APB_SIGNAL_COUNT + m_filler_count);
+    for (uint32_t i = 0; i < m_ids.size(); ++i)
+        m_ids[i] = make_vcd_identifier(i);
+
+    put("$date\n    generated by apb_vcd_gen (seed ");
+    put_u64(m_cfg.seed);
+    put(")\n$end\n$version\n    apb_vcd_gen\n$end\n$timescale\n    1 ps\n$end\n\n$scope module test $end\n\n$scope module apb_if $end\n");
+    const char* names[APB_SIGNAL_COUNT] = {"clk", "rst_n", "paddr [31:0]", "pwdata [31:0]", "pwrite", "psel", "penable", "pready", "prdata [31:0]"};
+    const char* kinds[APB_SIGNAL_COUNT] = {"wire", "wire", "reg", "reg", "reg", "reg", "reg", "reg", "reg"};
+    for (uint32_t i = 0; i < APB_SIGNAL_COUNT; ++i) {
+        bool wide = (i == SIG_PADDR || i == SIG_PWDATA || i == SIG_PRDATA);
+        put("$var ");
+        put(kinds[i]);
+        put(wide ? " 32 " : " 1 ");
+        m_buf.append(m_ids[i]);
+        put(" ");
+        put(names[i]);
+        put(" $end\n");
+    }
+    put("$upscope $end\n");
+    if (m_filler_count > 0) {
+        put("\n$scope module filler $end\n");
+        for (uint32_t i = 0; i < m_filler_count; ++i) {
+            put(is_wide_filler(i) ? "$var reg 16 " : "$var wire 1 ");
+            m_buf.append(m_ids[APB_SIGNAL_COUNT + i]);
+            put(" f");
+            put_u64(i);
+            put(is_wide_filler(i) ? " [15:0] $end\n" : " $end\n");
+            flush(false);
+        }
+        put("$upscope $end\n");
+    }
+    put("\n$upscope $end\n\n$enddefinitions $end\n$dumpvars\n");
+    put_scalar(false, SIG_CLK);
+    put_scalar(false, SIG_RST_N);
+    put_vector(0, SIG_PADDR);
+    put_vector(0, SIG_PWDATA);
+    put_scalar(false, SIG_PWRITE);
+    put_scalar(false, SIG_PSEL);
+    put_scalar(false, SIG_PENABLE);
+    put_scalar(false, SIG_PREADY);
+    put_vector(0, SIG_PRDATA);
+    for (uint32_t i = 0; i < m_filler_count; ++i) {
+        if (is_wide_filler(i))
+            put_vector(0, APB_SIGNAL_COUNT + i);
+        else
+            put_scalar(false, APB_SIGNAL_COUNT + i);
+        flush(false);
+    }
+    put("$end\n");
+}
+
+void Generator::write_bus_diff(const BusState& next) {
+    if (next.presetn != m_state.presetn)
+        put_scalar(next.presetn, SIG_RST_N);
+    if (next.psel != m_state.psel)
+        put_scalar(next.psel, SIG_PSEL);
+    if (next.pwrite != m_state.pwrite)
+        put_scalar(next.pwrite, SIG_PWRITE);
+    if (next.paddr != m_state.paddr)
+        put_vector(next.paddr, SIG_PADDR);
+    if (next.pwdata != m_state.pwdata)
+        put_vector(next.pwdata, SIG_PWDATA);
+    if (next.penable != m_state.penable)
+        put_scalar(next.penable, SIG_PENABLE);
+    if (next.prdata != m_state.prdata)
+        put_vector(next.prdata, SIG_PRDATA);
+    if (next.pready != m_state.pready)
+        put_scalar(next.pready, SIG_PREADY);
+    m_state = next;
+}
+
+void Generator::write_filler_changes() {
+    if (m_filler_count == 0)
+        return;
+    const uint64_t cycle_begin = (m_edge - 1) * m_filler_count;
+    const uint64_t cycle_end = cycle_begin + m_filler_count;
+    while (m_next_filler_event < cycle_end) {
+        uint32_t i = static_cast<uint32_t>(m_next_filler_event - cycle_begin);
+        if (is_wide_filler(i)) {
+            m_filler_values[i] = m_filler_rng.next_u32() & 0xFFFFu;
+            put_vector(m_filler_values[i], APB_SIGNAL_COUNT + i);
+        } else {
+            m_filler_values[i] ^= 1u;
+            put_scalar(m_filler_values[i] != 0, APB_SIGNAL_COUNT + i);
+        }
+        m_next_filler_event += 1 + geometric(m_cfg.filler_activity);
+    }
+}
+
+void Generator::advance(const BusState& next) {
+    ++m_edge;
+    const uint64_t t = edge_time(m_edge);
+    m_buf.push_back('#');
+    put_u64(t);
+    m_buf.push_back('\n');
+    put_scalar(true, SIG_CLK);
+    write_bus_diff(next);
+    m_buf.push_back('#');
+    put_u64(t + PCLK_PERIOD_PS / 2);
+    m_buf.push_back('\n');
+    put_scalar(false, SIG_CLK);
+    write_filler_changes();
+    flush(false);
+}
+
+uint64_t Generator::idle_gap() {
+    double u = std::min(std::max(m_cfg.utilization, 0.0), 1.0);
+    if (u >= 1.0)
+        return 0;
+    double busy = 2.0 + m_cfg.wait_ratio * (1.0 + m_cfg.max_wait_cycles) / 2.0;
+    double mean_idle = busy * (1.0 - u) / std::max(u, 1e-6);
+    double q = 1.0 / (mean_idle + 1.0);
+    double r = 1.0 - m_rng.uniform();
+    return static_cast<uint64_t>(std::floor(std::log(r) / std::log(1.0 - q)));
+}
+
+uint32_t Generator::pick_offset(CompleterID c, bool is_write) {
+    (void)is_write;
+    // 大部分存取集中在 64 個暫存器, 讓讀寫互相命中
+    uint32_t offset = m_rng.chance(0.8) ? static_cast<uint32_t>(m_rng.below(64)) * 4
+                                        : static_cast<uint32_t>(m_rng.below(NORMAL_OFFSET_LIMIT / 4)) * 4;
+    uint32_t paddr = completer_base(c) + offset;
+    for (const auto& s : m_cfg.shorts) {
+        if (s.on_paddr && s.completer == c)
+            paddr = apply_short(paddr, s.bit);
+    }
+    return paddr;
+}
+
+PlannedTransaction Generator::plan_transaction(uint64_t remaining) {
+    PlannedTransaction t;
+    t.completer = m_completers[m_rng.below(m_completers.size())];
+    t.is_write = m_rng.chance(m_cfg.write_ratio);
+    t.wait_cycles = (m_cfg.max_wait_cycles > 0 && m_rng.chance(m_cfg.wait_ratio)) ? 1 + static_cast<int>(m_rng.below(m_cfg.max_wait_cycles)) : 0;
+
+    // 注入的錯誤平均分散在整個交易序列中
+    if (m_remaining_timeouts > 0 && m_rng.below(remaining) < m_remaining_timeouts) {
+        m_remaining_timeouts--;
+        t.timeout = true;
+        t.paddr = pick_offset(t.completer, t.is_write);
+        t.pwdata = m_rng.next_u32();
+        return t;
+    }
+    if (m_remaining_oor > 0 && m_rng.below(remaining) < m_remaining_oor) {
+        m_remaining_oor--;
+        t.completer = CompleterID::UNKNOWN_COMPLETER;
+        t.paddr = 0x1A104000 + static_cast<uint32_t>(m_rng.below(1024)) * 4;
+        t.pwdata = m_rng.next_u32();
+        t.prdata = m_rng.next_u32();
+        return t;
+    }
+    if (m_remaining_mirror > 0 && !m_recent_writes.empty() && m_rng.below(remaining) < m_remaining_mirror) {
+        m_remaining_mirror--;
+        const auto& w = m_recent_writes[m_rng.below(m_recent_writes.size())];
+        t.is_write = false;
+        t.paddr = completer_base(t.completer) + NORMAL_OFFSET_LIMIT + static_cast<uint32_t>(m_rng.below(NORMAL_OFFSET_LIMIT / 4)) * 4;
+        t.prdata = w.second;
+        return t;
+    }
+
+    t.paddr = pick_offset(t.completer, t.is_write);
+    if (t.is_write) {
+        t.pwdata = m_rng.next_u32();
+        for (const auto& s : m_cfg.shorts) {
+            if (!s.on_paddr && s.completer == t.completer)
+                t.pwdata = apply_short(t.pwdata, s.bit);
+        }
+        if (m_recent_writes.size() < 256)
+            m_recent_writes.push_back(std::make_pair(t.paddr, t.pwdata));
+        else
+            m_recent_writes[m_rng.below(256)] = std::make_pair(t.paddr, t.pwdata);
+    } else {
+        // 讀取已寫入的位址時回傳最後寫入的值 (一致的記憶體), 否則回傳亂數
+        auto it = m_model.shadow.find(ReferenceModel::shadow_key(t.completer, t.paddr));
+        t.prdata = it != m_model.shadow.end() ? it->second.first : m_rng.next_u32();
+    }
+    return t;
+}
+
+void Generator::model_completion(const PlannedTransaction& t, uint64_t completion_edge) {
+    ReferenceModel& m = m_model;
+    const uint64_t ts = edge_time(completion_edge);
+    const bool valid = t.completer != CompleterID::UNKNOWN_COMPLETER;
+    m.completed++;
+    if (valid && std::find(m.accessed.begin(), m.accessed.end(), t.completer) == m.accessed.end())
+        m.accessed.push_back(t.completer);
+    if (valid) {
+        m.paddr_evidence[t.completer].record(t.paddr);
+        if (t.is_write)
+            m.pwdata_evidence[t.completer].record(t.pwdata);
+        else
+            m.pwdata_evidence[t.completer];
+    } else {
+        m.out_of_range.push_back({ts, t.paddr});
+    }
+    const uint64_t duration = 2 + t.wait_cycles;
+    if (t.is_write) {
+        (t.wait_cycles > 0 ? m.write_with_wait : m.write_no_wait)++;
+        m.write_edges += duration;
+    } else {
+        (t.wait_cycles > 0 ? m.read_with_wait : m.read_no_wait)++;
+        m.read_edges += duration;
+    }
+    if (!valid)
+        return;
+    if (t.is_write) {
+        m.shadow[ReferenceModel::shadow_key(t.completer, t.paddr)] = std::make_pair(t.pwdata, ts);
+        m.reverse[t.pwdata] = {t.paddr, ts};
+    } else if (t.paddr != 0x1A101008 && t.paddr != 0x1A100014 &&
+               m.shadow.find(ReferenceModel::shadow_key(t.completer, t.paddr)) == m.shadow.end()) {
+        auto it = m.reverse.find(t.prdata);
+        if (it != m.reverse.end() && it->second.address != t.paddr)
+            m.mirroring.push_back({ts, t.paddr, t.prdata, it->second.address, it->second.timestamp});
+    }
+}
+
+void Generator::run_transaction(const PlannedTransaction& t) {
+    BusState setup = m_state;
+    setup.psel = true;
+    setup.penable = false;
+    setup.pready = false;
+    setup.pwrite = t.is_write;
+    setup.paddr = t.paddr;
+    setup.pwdata = t.is_write ? t.pwdata : 0;
+    advance(setup);
+    const uint64_t setup_edge = m_edge + 1;
+    const bool counting = m_model.frozen_at_edge == 0;
+
+    BusState access = setup;
+    access.penable = true;
+    if (t.timeout) {
+        for (uint64_t i = 0; i < TIMEOUT_ACCESS_CYCLES; ++i)
+            advance(access);
+        if (counting) {
+            m_model.bus_active_edges += TIMEOUT_ACCESS_CYCLES;
+            m_model.timeouts.push_back({edge_time(setup_edge), t.paddr});
+        }
+        return;
+    }
+    for (int i = 0; i < t.wait_cycles; ++i)
+        advance(access);
+    access.pready = true;
+    if (!t.is_write)
+        access.prdata = t.prdata;
+    advance(access);
+    const uint64_t completion_edge = m_edge + 1;
+    if (counting) {
+        m_model.bus_active_edges += 2 + t.wait_cycles;
+        model_completion(t, completion_edge);
+        if (m_model.completed >= m_cfg.transaction_limit)
+            m_model.frozen_at_edge = completion_edge;
+    }
+}
+
+bool Generator::run(VcdGeneratorResult& result) {
+    m_remaining_timeouts = std::min(m_cfg.timeouts, m_cfg.transactions);
+    m_remaining_oor = std::min(m_cfg.out_of_range, m_cfg.transactions);
+    m_remaining_mirror = std::min(m_cfg.mirroring, m_cfg.transactions);
+    write_header();
+
+    BusState idle;
+    for (uint64_t i = 1; i < std::max<uint64_t>(m_cfg.reset_cycles, 1); ++i)
+        advance(idle);
+    idle.presetn = true;
+    advance(idle);
+    m_model.first_valid_edge = m_edge + 1;
+
+    uint64_t generated = 0;
+    while (generated < m_cfg.transactions && (m_cfg.target_bytes == 0 || bytes_so_far() < m_cfg.target_bytes)) {
+        uint64_t gap = idle_gap();
+        for (uint64_t i = 0; i < gap; ++i)
+            advance(idle);
+        run_transaction(plan_transaction(m_cfg.transactions - generated));
+        generated++;
+        if (!flush(false))
+            return false;
+    }
+    for (int i = 0; i < 10; ++i)
+        advance(idle);
+    if (!flush(true))
+        return false;
+    result.bytes_written = m_bytes_written;
+    result.transactions = generated;
+    result.pclk_edges = m_edge;
+    return true;
+}
+
+void Generator::write_expected_report(std::ostream& out) const {
+    const ReferenceModel& m = m_model;
+    const uint64_t total_edges = m.frozen_at_edge != 0 ? m.frozen_at_edge : m_edge;
+    const uint64_t counted_edges = (m.first_valid_edge > 0 && m.first_valid_edge <= total_edges) ? total_edges - m.first_valid_edge + 1 : 0;
+    const uint64_t reads = m.read_no_wait + m.read_with_wait;
+    const uint64_t writes = m.write_no_wait + m.write_with_wait;
+
+    out << "Number of Read Transactions with no wait states: " << m.read_no_wait << "\n";
+    out << "Number of Read Transactions with wait states: " << m.read_with_wait << "\n";
+    out << "Number of Write Transactions with no wait states: " << m.write_no_wait << "\n";
+    out << "Number of Write Transactions with wait states: " << m.write_with_wait << "\n";
+    out << std::fixed << std::setprecision(2);
+    out << "Average Read Cycle: " << (reads == 0 ? 0.0 : static_cast<double>(m.read_edges) / reads) << " cycles\n";
+    out << "Average Write Cycle: " << (writes == 0 ? 0.0 : static_cast<double>(m.write_edges) / writes) << " cycles\n";
+    out << "Bus Utilization: " << (counted_edges == 0 ? 0.0 : static_cast<double>(m.bus_active_edges) / counted_edges * 100.0) << "%\n";
+    out << std::defaultfloat << std::setprecision(0);
+    out << "Number of Idle Cycles: " << (counted_edges < m.bus_active_edges ? 0 : counted_edges - m.bus_active_edges) << "\n";
+    out << "Number of Completer: " << m.accessed.size() << "\n";
+    out << std::fixed << std::setprecision(2);
+    out << "CPU Elapsed Time: " << 0.0 << " ms\n";
+    out << std::defaultfloat << std::setprecision(6);
+
+    out << "\nNumber of Transactions with Timeout: " << m.timeouts.size() << "\n";
+    out << "Number of Out-of-Range Accesses: " << m.out_of_range.size() << "\n";
+    out << "Number of Mirrored Transactions: " << m.mirroring.size() << "\n";
+    out << "Number of Read-Write Overlap Errors: " << 0;
+
+    const std::pair<int, CompleterID> order[] = {{1, CompleterID::UART}, {2, CompleterID::GPIO}, {3, CompleterID::SPI_MASTER}};
+    for (const auto& entry : order) {
+        if (std::find(m.accessed.begin(), m.accessed.end(), entry.second) == m.accessed.end())
+            continue;
+        auto paddr_it = m.paddr_evidence.find(entry.second);
+        auto pwdata_it = m.pwdata_evidence.find(entry.second);
+        int paddr_short = paddr_it->second.shorted_pair(11);
+        int pwdata_short = pwdata_it->second.shorted_pair(31);
+        const char prefixes[2] = {'a', 'd'};
+        const int shorts[2] = {paddr_short, pwdata_short};
+        const char* titles[2] = {" PADDR Connections", " PWDATA Connections"};
+        for (int k = 0; k < 2; ++k) {
+            out << "\n\nCompleter " << entry.first << titles[k];
+            for (int j = 31; j >= 0; --j) {
+                out << "\n" << prefixes[k] << std::setw(2) << std::setfill('0') << j << ": ";
+                if (shorts[k] >= 0 && (j == shorts[k] || j == shorts[k] + 1)) {
+                    std::ostringstream oss;
+                    oss << "Connected with " << prefixes[k] << (j == shorts[k] ? shorts[k] + 1 : shorts[k]);
+                    out << oss.str();
+                } else {
+                    out << "Correct";
+                }
+            }
+        }
+    }
+
+    struct ErrorLogEntry {
+        uint64_t timestamp;
+        std::string message;
+        bool operator<(const ErrorLogEntry& other) const { return timestamp < other.timestamp; }
+    };
+    auto hex = [](uint32_t v) {
+        std::ostringstream oss;
+        oss << std::hex << v;
+        return oss.str();
+    };
+    std::vector<ErrorLogEntry> errors;
+    for (const auto& d : m.out_of_range)
+        errors.push_back({d.timestamp, "Out-of-Range Access -> PADDR 0x" + hex(d.paddr)});
+    for (const auto& d : m.timeouts)
+        errors.push_back({d.start_timestamp, "Timeout Occurred -> Transaction Stalled at PADDR 0x" + hex(d.paddr)});
+    for (const auto& d : m.mirroring) {
+        errors.push_back({d.original_write_time, "Address Mirroring -> Write at PADDR 0x" + hex(d.original_write_addr) + " also reflected at PADDR 0x" + hex(d.mirrored_addr)});
+        errors.push_back({d.read_timestamp, "Data Mirroring -> Value 0x" + hex(d.data_value) + " written at PADDR 0x" + hex(d.original_write_addr) + " also found at PADDR 0x" + hex(d.mirrored_addr)});
+    }
+    std::sort(errors.begin(), errors.end());
+    out << "\n";
+    for (const auto& e : errors)
+        out << "[#" << e.timestamp << "] " << e.message << "\n";
+}
+
+}  // namespace
+
+std::string make_vcd_identifier(uint32_t index) {
+    std::string id;
+    do {
+        id.push_back(static_cast<char>('!' + index % 94));
+        index /= 94;
+    } while (index-- > 0);
+    return id;
+}
+
+bool generate_apb_vcd(const VcdGeneratorConfig& config,
+                      std::FILE* vcd_out,
+                      std::ostream* expected_report_out,
+                      VcdGeneratorResult& result) {
+    Generator generator(config, vcd_out);
+    if (!generator.run(result))
+        return false;
+    if (expected_report_out)
+        generator.write_expected_report(*expected_report_out);
+    return true;
+}
+
+}  // namespace APBSystem
@@ -0,0 +1,75 @@
+// apb_vcd_generator.hpp
+// 產生可重現 (seeded) 的合成 APB VCD, 同時用獨立的參考模型算出預期報表
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "apb_types.hpp"
+
+namespace APBSystem {
+
+// 在某個 completer 上把 bit 與 bit+1 短路 (bit+1 永遠等於 bit)
+struct ShortInjection {
+    CompleterID completer = CompleterID::UART;
+    bool on_paddr = false;  // false: PWDATA, true: PADDR (只允許 a0-a10)
+    int bit = 0;
+};
+
+struct VcdGeneratorConfig {
+    uint64_t seed = 1;
+    uint64_t transactions = 10000;      // 要產生的交易數 (含注入的錯誤交易)
+    uint64_t target_bytes = 0;          // >0 時輸出超過此大小就停止產生新交易
+    double utilization = 0.3;           // 交易佔用的 pclk 比例 (reset 之後)
+    double write_ratio = 0.4;
+    double wait_ratio = 0.2;            // 有 wait state 的交易比例
+    int max_wait_cycles = 4;
+    uint32_t signal_count = 9;          // 總訊號數, 超過 9 個 APB 訊號的部分是 filler
+    double filler_activity = 0.05;      // 每個 filler 訊號每個 cycle 變化的機率
+    bool use_uart = true;
+    bool use_gpio = true;
+    bool use_spi = true;
+    uint64_t timeouts = 0;              // PREADY 一直不拉起, 超過 1000 cycles
+    uint64_t out_of_range = 0;          // PADDR 不在任何 completer 範圍內
+    uint64_t mirroring = 0;             // 讀取從未寫入的位址, 卻回傳別的位址寫入的資料
+    std::vector<ShortInjection> shorts;
+    uint64_t reset_cycles = 20;
+    uint64_t transaction_limit = 1000000;  // 與 APB_Recognizer 的上限一致
+};
+
+struct VcdGeneratorResult {
+    uint64_t bytes_written = 0;
+    uint64_t transactions = 0;
+    uint64_t pclk_edges = 0;
+};
+
+// 以 splitmix64 產生亂數, 讓同一個 seed 在任何平台都得到相同的輸出
+class DeterministicRng {
+   public:
+    explicit DeterministicRng(uint64_t seed) : m_state(seed) {}
+    uint64_t next() {
+        uint64_t z = (m_state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+    uint32_t next_u32() { return static_cast<uint32_t>(next() >> 32); }
+    uint64_t below(uint64_t bound) { return bound == 0 ? 0 : next() % bound; }
+    double uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+    bool chance(double p) { return uniform() < p; }
+
+   private:
+    uint64_t m_state;
+};
+
+bool generate_apb_vcd(const VcdGeneratorConfig& config,
+                      std::FILE* vcd_out,
+                      std::ostream* expected_report_out,
+                      VcdGeneratorResult& result);
+
+// 產生合成 VCD 用的 VCD id (base-94, '!'..'~')
+std::string make_vcd_identifier(uint32_t index);
+
+}  // namespace APBSystem
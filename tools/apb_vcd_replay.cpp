@@ -0,0 +1,78 @@
+// apb_vcd_replay.cpp
+// 模擬器的替身: 把 .vcd 轉成二進位 value-change feed 送到 APB_Recognizer --feed-listen
+#include <unistd.h>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include "value_change_feed.hpp"
+#include "vcd_parser.hpp"
+
+using namespace APBSystem;
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <input_vcd_file> <socket_path> [--batch <records>] [--connect-timeout-ms <ms>] [--delta-time]" << std::endl;
+        return 1;
+    }
+    std::string vcd_file_path = argv[1];
+    std::string socket_path = argv[2];
+    std::size_t batch_records = 4096;
+    int connect_timeout_ms = 5000;
+    bool delta_time = false;
+    for (int i = 3; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--batch" && i + 1 < argc) {
+            batch_records = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--connect-timeout-ms" && i + 1 < argc) {
+            connect_timeout_ms = std::atoi(argv[++i]);
+        } else if (arg == "--delta-time") {
+            delta_time = true;
+        } else {
+            std::cerr << "Error: Unknown option: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    int fd = connect_unix_socket(socket_path, connect_timeout_ms);
+    if (fd == -1)
+        return 1;
+
+    auto start_time = std::chrono::steady_clock::now();
+    ValueChangeFeedWriter writer(fd, batch_records, delta_time);
+    std::unordered_map<std::string, uint32_t> index_by_vcd_id;
+    uint64_t current_time = 0;
+    bool ok = true;
+
+    VcdParser parser;
+    bool parse_ok = parser.parse_file(
+        vcd_file_path,
+        [&](const VcdVarDefinition& definition) {
+            std::string id_code = definition.id_string();
+            auto it = index_by_vcd_id.find(id_code);
+            uint32_t index = it != index_by_vcd_id.end() ? it->second : static_cast<uint32_t>(index_by_vcd_id.size());
+            index_by_vcd_id[id_code] = index;
+            ok = ok && writer.define_signal(index, definition.type_string(), definition.width, definition.hierarchical_name());
+        },
+        [&](uint64_t vcd_time_ps) {
+            current_time = vcd_time_ps;
+            ok = ok && writer.push({current_time, FEED_TIME_ONLY_INDEX, 0, 0, 0});
+        },
+        [&](const char* id, std::size_t id_len, const char* value_ptr, std::size_t value_len) {
+            auto it = index_by_vcd_id.find(std::string(id, id_len));
+            if (it == index_by_vcd_id.end())
+                return;
+            ValueChangeRecord record{current_time, it->second, 0, 0, 0};
+            decode_vcd_value(value_ptr, value_len, record.value, record.xmask);
+            ok = ok && writer.push(record);
+        },
+        [&]() { ok = ok && writer.end_definitions(); });
+    ok = ok && parse_ok && writer.finish();
+    close(fd);
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+    std::cerr << "Replayed " << writer.get_records_written() << " records in " << elapsed.count() * 1000.0 << " ms ("
+              << (elapsed.count() > 0 ? writer.get_records_written() / elapsed.count() : 0.0) << " records/s)" << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,460 @@
+// apb_vcd_to_fst.cpp
+// 把 .vcd 轉成 GTKWave FST, 用來在沒有 vcd2fst 的環境產生 FST 測試輸入
+// 輸出 VCDATA_DYN_ALIAS2 block + geometry + gzip hierarchy (與 fstapi 相同的佈局)
+#include <zlib.h>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "fst_reader.hpp"
+#include "lz4_block.hpp"
+#include "vcd_parser.hpp"
+
+using namespace APBSystem;
+
+namespace {
+
+typedef std::vector<unsigned char> Bytes;
+
+void put_varint(Bytes& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<unsigned char>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<unsigned char>(v));
+}
+
+void put_svarint(Bytes& out, int64_t v) {
+    for (;;) {
+        unsigned char b = v & 0x7F;
+        v >>= 7;
+        if ((v == 0 && !(b & 0x40)) || (v == -1 && (b & 0x40))) {
+            out.push_back(b);
+            return;
+        }
+        out.push_back(b | 0x80);
+    }
+}
+
+void put_be64(Bytes& out, uint64_t v) {
+    for (int shift = 56; shift >= 0; shift -= 8)
+        out.push_back(static_cast<unsigned char>(v >> shift));
+}
+
+Bytes zlib_compress(const Bytes& src) {
+    uLongf len = compressBound(static_cast<uLong>(src.size()));
+    Bytes out(len);
+    if (compress2(out.data(), &len, src.data(), static_cast<uLong>(src.size()), 4) != Z_OK)
+        return src;
+    out.resize(len);
+    return out;
+}
+
+Bytes gzip_compress(const Bytes& src) {
+    z_stream zs;
+    std::memset(&zs, 0, sizeof(zs));
+    Bytes out(compressBound(static_cast<uLong>(src.size())) + 64);
+    deflateInit2(&zs, 4, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+    zs.next_in = const_cast<unsigned char*>(src.data());
+    zs.avail_in = static_cast<uInt>(src.size());
+    zs.next_out = out.data();
+    zs.avail_out = static_cast<uInt>(out.size());
+    deflate(&zs, Z_FINISH);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    return out;
+}
+
+struct FstSignal {
+    uint32_t width;
+    bool is_real;
+    uint64_t frame_offset;
+    uint64_t last_time_index;
+    Bytes wave;
+};
+
+class FstFileWriter {
+   public:
+    FstFileWriter(std::FILE* out, std::size_t block_bytes, bool lz4_pack)
+        : m_out(out), m_block_bytes(block_bytes), m_lz4_pack(lz4_pack) {}
+
+    void define(const VcdVarDefinition& definition) {
+        std::string id = definition.id_string();
+        // scope 轉換: 收回到共同的祖先, 再進入新的 scope
+        std::vector<uint32_t> chain;
+        for (uint32_t s = definition.scope; s != VcdScopeTable::ROOT; s = definition.scopes->parent_of(s))
+            chain.insert(chain.begin(), s);
+        std::size_t common = 0;
+        while (common < chain.size() && common < m_open_scopes.size() && chain[common] == m_open_scopes[common])
+            ++common;
+        while (m_open_scopes.size() > common) {
+            m_hierarchy.push_back(FST_ST_VCD_UPSCOPE);
+            m_open_scopes.pop_back();
+        }
+        for (std::size_t i = common; i < chain.size(); ++i) {
+            m_hierarchy.push_back(FST_ST_VCD_SCOPE);
+            m_hierarchy.push_back(0);  // module
+            put_cstring(definition.scopes->name_of(chain[i]));
+            put_cstring("");
+            m_open_scopes.push_back(chain[i]);
+            m_scope_count++;
+        }
+
+        std::string type = definition.type_string();
+        uint8_t var_type = fst_var_type_from_name(type);
+        m_hierarchy.push_back(var_type);
+        m_hierarchy.push_back(0);  // direction: implicit
+        put_cstring(std::string(definition.name, definition.name_len));
+        put_varint(m_hierarchy, static_cast<uint64_t>(definition.width));
+        auto it = m_handle_by_id.find(id);
+        if (it != m_handle_by_id.end()) {
+            put_varint(m_hierarchy, it->second + 1);  // alias
+        } else {
+            put_varint(m_hierarchy, 0);
+            m_handle_by_id[id] = static_cast<uint32_t>(m_signals.size());
+            bool is_real = type == "real" || type == "realtime" || type == "shortreal";
+            m_signals.push_back({is_real ? 8u : static_cast<uint32_t>(std::max(definition.width, 0)), is_real, 0, 0, Bytes()});
+        }
+        m_var_count++;
+    }
+
+    void end_definitions() {
+        if (m_defined)
+            return;
+        m_defined = true;
+        while (!m_open_scopes.empty()) {
+            m_hierarchy.push_back(FST_ST_VCD_UPSCOPE);
+            m_open_scopes.pop_back();
+        }
+        uint64_t offset = 0;
+        for (FstSignal& s : m_signals) {
+            s.frame_offset = offset;
+            offset += s.width;
+        }
+        m_current.assign(static_cast<std::size_t>(offset), 'x');
+        for (FstSignal& s : m_signals) {
+            if (s.is_real)
+                std::memset(&m_current[s.frame_offset], 0, 8);
+        }
+        write_header();  // 先佔位, 結束時重寫
+    }
+
+    void timestamp(uint64_t time) {
+        end_definitions();
+        if (!m_seen_time) {
+            m_seen_time = true;
+            m_start_time = time;
+            m_frame = m_current;
+        } else if (m_pending_bytes >= m_block_bytes) {
+            flush_block();
+            m_frame = m_current;
+        }
+        m_times.push_back(time);
+        m_end_time = time;
+    }
+
+    void value_change(const char* id, std::size_t id_len, const char* value, std::size_t value_len) {
+        auto it = m_handle_by_id.find(std::string(id, id_len));
+        if (it == m_handle_by_id.end() || value_len == 0)
+            return;
+        end_definitions();
+        FstSignal& s = m_signals[it->second];
+        unsigned char* slot = m_current.data() + s.frame_offset;
+        if (s.is_real) {
+            double d = std::strtod(std::string(value + 1, value_len - 1).c_str(), nullptr);
+            std::memcpy(slot, &d, 8);
+        } else {
+            normalize_bits(value, value_len, s.width, slot);
+        }
+        if (!m_seen_time)
+            return;  // 第一個 #time 之前 ($dumpvars) 的值直接進入 frame
+        const uint64_t time_index = m_times.size() - 1;
+        const uint64_t delta = time_index - s.last_time_index;
+        s.last_time_index = time_index;
+        const std::size_t before = s.wave.size();
+        if (s.is_real) {
+            put_varint(s.wave, delta << 1);
+            s.wave.insert(s.wave.end(), slot, slot + 8);
+        } else if (s.width == 1) {
+            if (slot[0] == '0' || slot[0] == '1') {
+                put_varint(s.wave, (delta << 2) | (static_cast<uint64_t>(slot[0] == '1') << 1));
+            } else {
+                const char* code = std::strchr("xzhuwl-?", slot[0]);
+                uint64_t index = code != nullptr && *code ? static_cast<uint64_t>(code - "xzhuwl-?") : 7;
+                put_varint(s.wave, (delta << 4) | (index << 1) | 1);
+            }
+        } else {
+            bool binary = true;
+            for (uint32_t i = 0; i < s.width && binary; ++i)
+                binary = slot[i] == '0' || slot[i] == '1';
+            if (binary) {
+                put_varint(s.wave, delta << 1);
+                unsigned char acc = 0;
+                int shift = 7;
+                for (uint32_t i = 0; i < s.width; ++i) {
+                    acc |= static_cast<unsigned char>((slot[i] & 1) << shift);
+                    if (--shift < 0) {
+                        s.wave.push_back(acc);
+                        acc = 0;
+                        shift = 7;
+                    }
+                }
+                if (shift != 7)
+                    s.wave.push_back(acc);
+            } else {
+                put_varint(s.wave, (delta << 1) | 1);
+                s.wave.insert(s.wave.end(), slot, slot + s.width);
+            }
+        }
+        m_pending_bytes += s.wave.size() - before;
+    }
+
+    bool finish() {
+        end_definitions();
+        if (!m_seen_time)
+            timestamp(0);
+        flush_block();
+        write_geometry();
+        write_hierarchy();
+        std::fflush(m_out);
+        std::rewind(m_out);
+        write_header();
+        return std::ferror(m_out) == 0;
+    }
+
+    uint64_t get_block_count() const { return m_block_count; }
+
+   private:
+    void put_cstring(const std::string& s) {
+        m_hierarchy.insert(m_hierarchy.end(), s.begin(), s.end());
+        m_hierarchy.push_back(0);
+    }
+
+    // VCD 的向量值可以省略前導位元: 最高位是 0/1 時補 0, 是 x/z 時補同一個字元
+    static void normalize_bits(const char* value, std::size_t len, uint32_t width, unsigned char* slot) {
+        if (len > 0 && (value[0] == 'b' || value[0] == 'B')) {
+            ++value;
+            --len;
+        }
+        if (len == 0) {
+            std::memset(slot, 'x', width);
+            return;
+        }
+        if (len >= width) {
+            for (uint32_t i = 0; i < width; ++i)
+                slot[i] = static_cast<unsigned char>(std::tolower(value[len - width + i]));
+            return;
+        }
+        char first = static_cast<char>(std::tolower(value[0]));
+        char pad = (first == 'x' || first == 'z') ? first : '0';
+        std::size_t pad_len = width - len;
+        std::memset(slot, pad, pad_len);
+        for (std::size_t i = 0; i < len; ++i)
+            slot[pad_len + i] = static_cast<unsigned char>(std::tolower(value[i]));
+    }
+
+    void write_block(uint8_t type, const Bytes& body) {
+        Bytes head;
+        head.push_back(type);
+        put_be64(head, body.size() + 8);
+        std::fwrite(head.data(), 1, head.size(), m_out);
+        std::fwrite(body.data(), 1, body.size(), m_out);
+    }
+
+    void write_header() {
+        Bytes body;
+        put_be64(body, m_start_time);
+        put_be64(body, m_end_time);
+        const double endian_test = FST_ENDIAN_TEST;
+        const unsigned char* e = reinterpret_cast<const unsigned char*>(&endian_test);
+        body.insert(body.end(), e, e + 8);
+        put_be64(body, m_current.size());  // writer memory
+        put_be64(body, m_scope_count);
+        put_be64(body, m_var_count);
+        put_be64(body, m_signals.size());
+        put_be64(body, m_block_count);
+        body.push_back(static_cast<unsigned char>(-12));  // 1 ps
+        char version[128] = "apb_vcd_to_fst";
+        body.insert(body.end(), version, version + sizeof(version));
+        char date[119] = {0};
+        std::time_t now = std::time(nullptr);
+        std::strftime(date, sizeof(date), "%a %b %d %H:%M:%S %Y", std::localtime(&now));
+        body.insert(body.end(), date, date + sizeof(date));
+        body.push_back(0);  // file type: verilog
+        put_be64(body, 0);  // timezero
+        write_block(FST_BL_HDR, body);
+    }
+
+    void flush_block() {
+        if (m_times.empty())
+            return;
+        Bytes body;
+        put_be64(body, m_times.front());
+        put_be64(body, m_times.back());
+        put_be64(body, m_frame.size() + m_pending_bytes);
+
+        Bytes frame_data = zlib_compress(m_frame);
+        if (frame_data.size() >= m_frame.size())
+            frame_data = m_frame;
+        put_varint(body, m_frame.size());
+        put_varint(body, frame_data.size());
+        put_varint(body, m_signals.size());
+        body.insert(body.end(), frame_data.begin(), frame_data.end());
+
+        put_varint(body, m_signals.size());
+        const std::size_t vc_start = body.size();
+        body.push_back(m_lz4_pack ? '4' : 'Z');
+        Bytes chain;
+        uint64_t previous_position = 0, zero_run = 0;
+        for (FstSignal& s : m_signals) {
+            if (s.wave.empty()) {
+                zero_run++;
+                continue;
+            }
+            if (zero_run) {
+                put_varint(chain, zero_run << 1);
+                zero_run = 0;
+            }
+            const uint64_t position = body.size() - vc_start;
+            put_svarint(chain, static_cast<int64_t>(((position - previous_position) << 1) | 1));
+            previous_position = position;
+            Bytes packed;
+            if (s.wave.size() > 32 && m_lz4_pack)
+                lz4_compress(s.wave.data(), s.wave.size(), packed);
+            else if (s.wave.size() > 32)
+                packed = zlib_compress(s.wave);
+            if (!packed.empty() && packed.size() < s.wave.size()) {
+                put_varint(body, s.wave.size());
+                body.insert(body.end(), packed.begin(), packed.end());
+            } else {
+                put_varint(body, 0);
+                body.insert(body.end(), s.wave.begin(), s.wave.end());
+            }
+            s.wave.clear();
+            s.last_time_index = 0;
+        }
+        if (zero_run)
+            put_varint(chain, zero_run << 1);
+        body.insert(body.end(), chain.begin(), chain.end());
+        put_be64(body, chain.size());
+
+        Bytes times;
+        uint64_t previous_time = 0;
+        for (uint64_t t : m_times) {
+            put_varint(times, t - previous_time);
+            previous_time = t;
+        }
+        Bytes time_data = zlib_compress(times);
+        if (time_data.size() >= times.size())
+            time_data = times;
+        body.insert(body.end(), time_data.begin(), time_data.end());
+        put_be64(body, times.size());
+        put_be64(body, time_data.size());
+        put_be64(body, m_times.size());
+        write_block(FST_BL_VCDATA_DYN_ALIAS2, body);
+
+        m_times.clear();
+        m_pending_bytes = 0;
+        m_block_count++;
+    }
+
+    void write_geometry() {
+        Bytes table;
+        for (const FstSignal& s : m_signals)
+            put_varint(table, s.is_real ? 0 : (s.width == 0 ? 0xFFFFFFFFu : s.width));
+        Bytes data = zlib_compress(table);
+        if (data.size() >= table.size())
+            data = table;
+        Bytes body;
+        put_be64(body, table.size());
+        put_be64(body, m_signals.size());
+        body.insert(body.end(), data.begin(), data.end());
+        write_block(FST_BL_GEOM, body);
+    }
+
+    void write_hierarchy() {
+        Bytes data = gzip_compress(m_hierarchy);
+        Bytes body;
+        put_be64(body, m_hierarchy.size());
+        body.insert(body.end(), data.begin(), data.end());
+        write_block(FST_BL_HIER, body);
+    }
+
+    std::FILE* m_out;
+    std::size_t m_block_bytes;
+    bool m_lz4_pack;
+    std::unordered_map<std::string, uint32_t> m_handle_by_id;
+    std::vector<FstSignal> m_signals;
+    std::vector<uint32_t> m_open_scopes;
+    Bytes m_hierarchy;
+    Bytes m_current;  // 所有訊號目前的值 (frame 佈局)
+    Bytes m_frame;    // 目前 block 開始時的值
+    std::vector<uint64_t> m_times;
+    std::size_t m_pending_bytes = 0;
+    bool m_defined = false;
+    bool m_seen_time = false;
+    uint64_t m_start_time = 0;
+    uint64_t m_end_time = 0;
+    uint64_t m_scope_count = 0;
+    uint64_t m_var_count = 0;
+    uint64_t m_block_count = 0;
+};
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <input_vcd_file> <output_fst_file> [--block-bytes <n>] [--pack zlib|lz4]" << std::endl;
+        return 1;
+    }
+    std::string vcd_file_path = argv[1];
+    std::string fst_file_path = argv[2];
+    std::size_t block_bytes = 4 << 20;
+    bool lz4_pack = false;
+    for (int i = 3; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--block-bytes" && i + 1 < argc) {
+            block_bytes = std::max<std::size_t>(1, std::strtoull(argv[++i], nullptr, 10));
+        } else if (arg == "--pack" && i + 1 < argc) {
+            std::string pack = argv[++i];
+            if (pack != "zlib" && pack != "lz4") {
+                std::cerr << "Error: --pack must be zlib or lz4" << std::endl;
+                return 1;
+            }
+            lz4_pack = pack == "lz4";
+        } else {
+            std::cerr << "Error: Unknown option: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    std::FILE* out = std::fopen(fst_file_path.c_str(), "wb");
+    if (out == nullptr) {
+        std::cerr << "Error: Could not open output file: " << fst_file_path << std::endl;
+        return 1;
+    }
+    auto start_time = std::chrono::steady_clock::now();
+    FstFileWriter writer(out, block_bytes, lz4_pack);
+    VcdParser parser;
+    bool ok = parser.parse_file(
+        vcd_file_path,
+        [&](const VcdVarDefinition& definition) { writer.define(definition); },
+        [&](uint64_t time) { writer.timestamp(time); },
+        [&](const char* id, std::size_t id_len, const char* value, std::size_t value_len) {
+            writer.value_change(id, id_len, value, value_len);
+        },
+        [&]() { writer.end_definitions(); });
+    ok = ok && writer.finish();
+    ok = std::fclose(out) == 0 && ok;
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+    std::cerr << "Wrote " << writer.get_block_count() << " value change blocks in " << elapsed.count() * 1000.0 << " ms" << std::endl;
+    return ok ? 0 : 1;
+}